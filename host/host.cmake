@@ -0,0 +1,123 @@
+# umac_bench:  headless Linux build of the main loop, for benchmarking
+#
+# Included by the top-level CMakeLists.txt when configured with
+# -DHOST_BUILD=ON (in place of the SDK/firmware build):
+#
+#       cmake -S . -B build-host -DHOST_BUILD=ON
+#       cmake --build build-host
+#       UMAC_BENCH_SECONDS=20 ./build-host/umac_bench
+#
+# This builds src/main.c and umac against the stand-in SDK headers in
+# host/include; see host_hal.c.
+#
+# MIT License
+#
+# Copyright (c) 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+project(umac_bench C)
+
+# The firmware's -O3, but umac is built for a host (not -DPICO), with
+# Musashi's instruction hook counting instructions:
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -O3 -DMUSASHI_CNF=\\\"host_m68kconf.h\\\" -DUMAC_MEMSIZE=${MEMSIZE}")
+
+add_compile_definitions(HOST_BUILD=1 VIDEO_BPP=1 VSYNC_MAX_BACKLOG=${VSYNC_MAX_BACKLOG}
+  INPUT_RING_SIZE=${INPUT_RING_SIZE})
+if (USE_VGA_RES)
+   add_compile_definitions(USE_VGA_RES=1 DISP_WIDTH=640 DISP_HEIGHT=480)
+else()
+   add_compile_definitions(DISP_WIDTH=512 DISP_HEIGHT=342)
+endif()
+if (USE_TURBO)
+   add_compile_definitions(USE_TURBO=1)
+endif()
+if (USE_PROFILE)
+   add_compile_definitions(USE_PROFILE=1)
+   set(EXTRA_PROFILE_SRC src/profile.c)
+endif()
+# There's room to count every opcode without collisions:
+if (USE_OPCOUNT)
+   add_compile_definitions(USE_OPCOUNT=1 OPCOUNT_BITS=16)
+   list(APPEND EXTRA_PROFILE_SRC src/opcount.c)
+endif()
+if (USE_TRAPS)
+   add_compile_definitions(USE_TRAPS=1)
+   set(EXTRA_TRAPS_SRC src/traps.c src/blit.c)
+endif()
+if (USE_MEMMAP)
+   add_compile_definitions(USE_MEMMAP=1)
+   set(EXTRA_MEMMAP_SRC src/memmap.c)
+endif()
+if (USE_IDLE)
+   add_compile_definitions(USE_IDLE=1)
+   set(EXTRA_IDLE_SRC src/idle.c)
+endif()
+if (USE_DEVCHAN)
+   # "Core 0" is a thread
+   add_compile_definitions(USE_DEVCHAN=1)
+   set(EXTRA_DEVCHAN_SRC src/devchan.c)
+   find_package(Threads REQUIRED)
+   set(EXTRA_DEVCHAN_LIB Threads::Threads)
+endif()
+if (USE_DISCZ)
+   add_compile_definitions(USE_DISCZ=1 DISCZ_CACHE_KB=${DISCZ_CACHE_KB})
+   set(EXTRA_DISCZ_SRC src/discz.c)
+endif()
+
+add_executable(umac_bench
+  src/main.c
+  src/vsync.c
+  src/emu_sched.c
+  src/input.c
+  src/pointer.c
+  src/stats.c
+  src/console.c
+  src/hud.c
+  src/fbcap.c
+  host/host_hal.c
+  ${EXTRA_PROFILE_SRC}
+  ${EXTRA_TRAPS_SRC}
+  ${EXTRA_MEMMAP_SRC}
+  ${EXTRA_IDLE_SRC}
+  ${EXTRA_DEVCHAN_SRC}
+  ${EXTRA_DISCZ_SRC}
+
+  ${UMAC_SOURCES}
+  )
+
+add_custom_command(OUTPUT ${UMAC_MUSASHI_PATH}/m68kops.c
+  COMMAND echo "*** Preparing umac source ***"
+  COMMAND make -C ${UMAC_PATH} prepare
+  )
+add_custom_target(prepare_umac
+  DEPENDS ${UMAC_MUSASHI_PATH}/m68kops.c
+  )
+add_dependencies(umac_bench prepare_umac)
+
+# umac's include directory must come before Musashi's, for host_m68kconf.h:
+target_include_directories(umac_bench PRIVATE
+  ${CMAKE_CURRENT_LIST_DIR}/include
+  ${CMAKE_CURRENT_LIST_DIR}/host
+  ${CMAKE_CURRENT_LIST_DIR}/host/include
+  ${UMAC_INCLUDE_PATHS}
+  incbin
+  )
+
+target_link_libraries(umac_bench m ${EXTRA_DEVCHAN_LIB})
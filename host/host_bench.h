@@ -0,0 +1,53 @@
+/*
+ * umac_bench: headless host build of the main loop
+ *
+ * main.c calls these (when built with HOST_BUILD) to count the work done;
+ * see host_hal.c.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+#include <inttypes.h>
+
+#include "emu_sched.h"
+
+/* Incremented for every 68K instruction, by Musashi's instruction hook
+ * (see host_m68kconf.h):
+ */
+extern uint64_t host_bench_insns;
+
+/* Call after each umac_loop(); this advances the (virtual) time, and
+ * ends the run once enough has been emulated.
+ */
+void    host_bench_loop(void);
+
+/* Call for each vsync delivered to the guest, after sched_frame() */
+void    host_bench_vsync(const sched_t *s);
+
+/* Runs entry in a thread of its own, as core 0 (USE_DEVCHAN) */
+void    host_bench_thread(void (*entry)(void));
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * umac_bench: host stand-ins for the hardware, and benchmark reporting
+ *
+ * main.c is built for a host against the stub SDK headers in include/, with
+ * these stand-ins for video, USB input and time.  It runs headless until
+ * UMAC_BENCH_SECONDS (default 10) of 68K time have been emulated, then
+ * reports the host time taken, 68K instructions/sec, umac_loop() calls and
+ * vsyncs.
+ *
+ * Time is virtual:  each umac_loop() call advances the wall clock by the
+ * time a quantum of 68K cycles takes on a modelled host that emulates at
+ * UMAC_BENCH_SPEED (default 1) times a real 7.8336MHz 68000, and each idle
+ * poll by a few us.  The video frame count (so guest vsync) follows the
+ * wall clock at 60Hz.  So the guest does the same work on every run,
+ * however fast the host is, and runs can be compared.  The modelled speed
+ * exercises the scheduler's pacing:  with USE_TURBO off, a speed above 1
+ * should give slack every frame, and below 1, overruns.  A sleep (with
+ * USE_IDLE) lasts until the next frame, as the video IRQ would end it.
+ *
+ * The trace is a hash of the 68K's PC after every umac_loop(), so shows
+ * whether two runs took the same path, e.g. with the disc backends on a
+ * "core 0" thread (USE_DEVCHAN) or not.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <inttypes.h>
+#if USE_DEVCHAN
+#include <pthread.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hardware/clocks.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include "host_bench.h"
+#include "stats.h"
+#include "video.h"
+#include "m68k.h"
+#if USE_PROFILE
+#include "profile.h"
+#endif
+#if USE_OPCOUNT
+#include "opcount.h"
+#endif
+#if USE_TRAPS
+#include "traps.h"
+#endif
+#if USE_IDLE
+#include "idle.h"
+#endif
+
+#ifndef UMAC_EXECLOOP_QUANTUM
+/* 68000 cycles executed per umac_loop() call (umac's execution quantum) */
+#define UMAC_EXECLOOP_QUANTUM   5000
+#endif
+#define MAC_CLOCK_HZ            SCHED_CLOCK_HZ
+#define VIDEO_FRAME_HZ          60
+#define IDLE_POLL_NS            5000
+
+uint64_t host_bench_insns = 0;
+
+static uint64_t bench_cycles = 0;       /* 68K cycles executed */
+static uint64_t bench_cycles_limit = 0;
+static uint64_t bench_wall_ns = 0;      /* Virtual wall clock */
+static uint64_t bench_loop_ns;          /* ...advanced per umac_loop() */
+static uint64_t bench_loops = 0;
+static uint64_t bench_vsyncs = 0;
+static uint64_t bench_idle_polls = 0;
+static uint64_t bench_sleeps = 0;
+static uint64_t bench_sleep_ns = 0;
+static uint32_t bench_trace = 2166136261u;
+static int64_t bench_slack_us = 0;
+static const sched_t *bench_sched = NULL;
+static struct timespec bench_t0;
+
+static uint32_t sys_khz = 125000;
+
+////////////////////////////////////////////////////////////////////////////////
+// Time, clocks, cores
+
+static uint64_t virtual_us(void)
+{
+        return bench_wall_ns / 1000;
+}
+
+absolute_time_t get_absolute_time(void)
+{
+        return virtual_us();
+}
+
+uint32_t        time_us_32(void)
+{
+        return (uint32_t)virtual_us();
+}
+
+uint64_t        time_us_64(void)
+{
+        return virtual_us();
+}
+
+uint32_t        stats_clock(void)
+{
+        /* Cycles of the (notional) system clock */
+        return bench_wall_ns * sys_khz / 1000000;
+}
+
+void    tight_loop_contents(void)
+{
+        /* An idle poll (waiting for real time to catch up) */
+        bench_wall_ns += IDLE_POLL_NS;
+        bench_idle_polls++;
+}
+
+void    __wfe(void)
+{
+        /* Until the next video frame (the first ns of it) */
+        uint64_t frame = video_get_frame_count() + 1;
+        uint64_t next = (frame * 1000000000 + VIDEO_FRAME_HZ - 1) / VIDEO_FRAME_HZ;
+
+        bench_sleep_ns += next - bench_wall_ns;
+        bench_wall_ns = next;
+        bench_sleeps++;
+}
+
+bool            set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+        (void)required;
+        sys_khz = freq_khz;
+        return true;
+}
+
+uint32_t        clock_get_hz(enum clock_index clk)
+{
+        (void)clk;
+        return sys_khz * 1000;
+}
+
+#if USE_DEVCHAN
+static void     *bench_thread(void *entry)
+{
+        ((void (*)(void))entry)();
+        return NULL;
+}
+
+void    host_bench_thread(void (*entry)(void))
+{
+        pthread_t t;
+
+        if (pthread_create(&t, NULL, bench_thread, (void *)entry) != 0) {
+                perror("umac_bench: pthread_create");
+                exit(1);
+        }
+}
+#endif
+
+void    multicore_launch_core1(void (*entry)(void))
+{
+        /* Core 1 runs the emulator until the benchmark ends */
+        const char *s = getenv("UMAC_BENCH_SECONDS");
+        unsigned int secs = s ? atoi(s) : 10;
+        const char *sp = getenv("UMAC_BENCH_SPEED");
+        double speed = sp ? atof(sp) : 1.0;
+
+        bench_cycles_limit = (uint64_t)(secs ? secs : 1) * MAC_CLOCK_HZ;
+        if (speed <= 0)
+                speed = 1.0;
+#if USE_OPCOUNT
+        const char *tr = getenv("UMAC_BENCH_TRACE_LEN");
+        if (getenv("UMAC_BENCH_TRACE"))
+                opcount_trace_start(tr ? atoi(tr) : 1000000);
+#endif
+        bench_loop_ns = UMAC_EXECLOOP_QUANTUM * 1e9 / MAC_CLOCK_HZ / speed;
+        clock_gettime(CLOCK_MONOTONIC, &bench_t0);
+        entry();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Video and input:  there's no display, and no USB
+
+static const char *video_mode = "none";
+
+void    video_init(uint32_t *framebuffer, const char *mode)
+{
+        (void)framebuffer;
+        if (mode)
+                video_mode = mode;
+}
+
+void    video_set_framebuffer(uint32_t *framebuffer)
+{
+        (void)framebuffer;
+}
+
+uint32_t        video_get_frame_count()
+{
+        return bench_wall_ns * VIDEO_FRAME_HZ / 1000000000;
+}
+
+const char      *video_get_mode()
+{
+        return video_mode;
+}
+
+void    hid_app_task(void)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmark
+
+static double   host_secs(void)
+{
+        struct timespec t;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (t.tv_sec - bench_t0.tv_sec) + (t.tv_nsec - bench_t0.tv_nsec) / 1e9;
+}
+
+static void     bench_report(void)
+{
+        double secs = host_secs();
+        double emu_secs = (double)bench_cycles / MAC_CLOCK_HZ;
+        uint64_t insns = host_bench_insns;
+
+        double wall_secs = bench_wall_ns / 1e9;
+
+        printf("\numac_bench: %.1fs of 68K time in %.2fs (%.2fx real time)\n",
+               emu_secs, secs, emu_secs / secs);
+        printf("  68K instructions: %" PRIu64 " (%.2fM/s, %.2f cycles each)\n",
+               insns, insns / secs / 1e6, insns ? (double)bench_cycles / insns : 0.0);
+        printf("  umac_loop() calls: %" PRIu64 " (%.0f/s)\n", bench_loops, bench_loops / secs);
+        printf("  vsyncs: %" PRIu64 " (%.1f per emulated second)\n",
+               bench_vsyncs, bench_vsyncs / emu_secs);
+        printf("  trace: %08x\n", bench_trace);
+        if (!bench_sched)
+                return;
+        printf("  sched: %s, %.1fs virtual wall time, %" PRIu64 " idle polls, batch %u\n",
+               bench_sched->mode == SCHED_TURBO ? "turbo" : "real-time", wall_secs,
+               bench_idle_polls, bench_sched->batch);
+        printf("  frames: %u, %u overrun, mean slack %.2fms, %.1fms lag given up\n",
+               bench_sched->frames, bench_sched->overruns,
+               bench_vsyncs ? (double)bench_slack_us / bench_vsyncs / 1000 : 0.0,
+               bench_sched->lost_us / 1000.0);
+
+        /* Time accounting, by the virtual clock: */
+        stats_acc_t now[STATS_NUM], zero[STATS_NUM] = { 0 };
+        stats_snapshot(now);
+        stats_report(now, zero, virtual_us(), clock_get_hz(clk_sys));
+#if USE_PROFILE
+        profile_dump(bench_loop_ns / 1000);
+#endif
+#if USE_OPCOUNT
+        opcount_dump();
+        const char *trace = getenv("UMAC_BENCH_TRACE");
+        FILE *f = trace ? fopen(trace, "wb") : NULL;
+        if (f) {
+                opcount_trace_write(f);
+                fclose(f);
+        }
+#endif
+#if USE_TRAPS
+        traps_dump();
+#endif
+#if USE_IDLE
+        printf("  idle: %u of %u quanta cut short, %u of %u event calls null, "
+               "%" PRIu64 " sleeps (%.1fs)\n",
+               (unsigned int)idle_stats.idle, (unsigned int)idle_stats.quanta,
+               (unsigned int)idle_stats.nulls, (unsigned int)idle_stats.calls,
+               bench_sleeps, bench_sleep_ns / 1e9);
+#endif
+}
+
+void    host_bench_loop(void)
+{
+        bench_loops++;
+        bench_cycles += UMAC_EXECLOOP_QUANTUM;
+        bench_wall_ns += bench_loop_ns;
+        bench_trace = (bench_trace ^ m68k_get_reg(NULL, M68K_REG_PC)) * 16777619u;
+#if USE_PROFILE
+        /* Sampled once per quantum, rather than on core 0's timer */
+        profile_sample(m68k_get_reg(NULL, M68K_REG_PC));
+#endif
+        if (bench_cycles >= bench_cycles_limit) {
+                bench_report();
+                exit(0);
+        }
+}
+
+void    host_bench_vsync(const sched_t *s)
+{
+        bench_sched = s;
+        bench_vsyncs++;
+        bench_slack_us += s->slack_us;
+}
@@ -0,0 +1,5 @@
+/* umac_bench stand-in for TinyUSB's RP2040 board header (unused on a host) */
+#ifndef HOST_BSP_BOARD_H
+#define HOST_BSP_BOARD_H
+
+#endif
@@ -0,0 +1,15 @@
+/* umac_bench stand-in for the Pico SDK's hardware/clocks.h */
+#ifndef HOST_HARDWARE_CLOCKS_H
+#define HOST_HARDWARE_CLOCKS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+enum clock_index {
+        clk_sys,
+};
+
+bool            set_sys_clock_khz(uint32_t freq_khz, bool required);
+uint32_t        clock_get_hz(enum clock_index clk);
+
+#endif
@@ -0,0 +1,27 @@
+/* umac_bench stand-in for the Pico SDK's hardware/gpio.h:  outputs go nowhere */
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include <stdbool.h>
+
+#define GPIO_OUT        1
+#define GPIO_IN         0
+
+static inline void gpio_init(unsigned int gpio)
+{
+        (void)gpio;
+}
+
+static inline void gpio_set_dir(unsigned int gpio, bool out)
+{
+        (void)gpio;
+        (void)out;
+}
+
+static inline void gpio_put(unsigned int gpio, bool value)
+{
+        (void)gpio;
+        (void)value;
+}
+
+#endif
@@ -0,0 +1,5 @@
+/* umac_bench stand-in for the Pico SDK's hardware/pio.h (unused on a host) */
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+#endif
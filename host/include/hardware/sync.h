@@ -0,0 +1,12 @@
+/* umac_bench stand-in for the Pico SDK's hardware/sync.h */
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+/* umac_bench's sleeps advance its clock to the next frame */
+void    __wfe(void);
+
+static inline void __sev(void)
+{
+}
+
+#endif
@@ -0,0 +1,10 @@
+/* umac_bench stand-in for the Pico SDK's pico/multicore.h
+ *
+ * "Launching" core 1 just runs it, so core 0's loop (USB) never runs.
+ */
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+void    multicore_launch_core1(void (*entry)(void));
+
+#endif
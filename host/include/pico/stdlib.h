@@ -0,0 +1,36 @@
+/* umac_bench stand-in for the Pico SDK's pico/stdlib.h
+ *
+ * Just enough of the SDK for main.c, on a host; see host_hal.c.
+ */
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#define PICO_DEFAULT_LED_PIN    25
+#define __not_in_flash_func(f)  f
+#define panic(...)      do { fprintf(stderr, __VA_ARGS__); exit(2); } while (0)
+
+#define PICO_ERROR_TIMEOUT      -1
+
+/* There's no console input */
+static inline int getchar_timeout_us(uint32_t timeout_us)
+{
+        return PICO_ERROR_TIMEOUT;
+}
+
+/* Not inline, as in the SDK: umac_bench's idle polls advance its clock */
+void    tight_loop_contents(void);
+
+static inline bool stdio_init_all(void)
+{
+        return true;
+}
+
+#endif
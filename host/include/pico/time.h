@@ -0,0 +1,42 @@
+/* umac_bench stand-in for the Pico SDK's pico/time.h
+ *
+ * Time is virtual:  it's derived from the 68K cycles emulated (see
+ * host_hal.c), so that runs are repeatable whatever the host's speed.
+ */
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef uint64_t absolute_time_t;
+
+absolute_time_t get_absolute_time(void);
+uint32_t        time_us_32(void);
+uint64_t        time_us_64(void);
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+        return (int64_t)(to - from);
+}
+
+/* There are no timer IRQs:  repeating timers never fire (core 0's work
+ * that uses them, e.g. profiling, is done from core 1's loop instead).
+ */
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer {
+        repeating_timer_callback_t callback;
+        void *user_data;
+};
+
+static inline bool      add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback,
+                                               void *user_data, repeating_timer_t *out)
+{
+        (void)delay_us;
+        out->callback = callback;
+        out->user_data = user_data;
+        return true;
+}
+
+#endif
@@ -0,0 +1,16 @@
+/* umac_bench stand-in for TinyUSB:  there's no USB, so no keyboard/mouse */
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+
+#include <stdbool.h>
+
+static inline bool tusb_init(void)
+{
+        return true;
+}
+
+static inline void tuh_task(void)
+{
+}
+
+#endif
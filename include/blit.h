@@ -0,0 +1,54 @@
+/*
+ * pico-umac 1BPP rectangle kernels, for native QuickDraw traps
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* Bitmaps are the Mac's:  big-endian rows of rowBytes, with the leftmost
+ * pixel in bit 7 of a byte.  Coordinates are pixels from the base.
+ *
+ * The widest row blit_copy() handles (it stages each row in a buffer, so
+ * that overlapping copies are safe):
+ */
+#define BLIT_MAX_ROW_BYTES      256
+
+/* Fill w x h pixels at (x, y) with an 8x8 pattern, whose row pat_y is used
+ * for the first row.  The pattern's bytes align with the bitmap's.
+ */
+void    blit_fill(uint8_t *base, unsigned int row_bytes, unsigned int x, unsigned int y,
+                  unsigned int w, unsigned int h, const uint8_t pat[8], unsigned int pat_y);
+
+/* Copy w x h pixels from (sx, sy) in src to (dx, dy) in dst (which may
+ * overlap).  Returns false, having done nothing, if a row is too wide.
+ */
+bool    blit_copy(uint8_t *dst, unsigned int dst_row_bytes, unsigned int dx, unsigned int dy,
+                  const uint8_t *src, unsigned int src_row_bytes, unsigned int sx, unsigned int sy,
+                  unsigned int w, unsigned int h);
+
+#endif
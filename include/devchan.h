@@ -0,0 +1,127 @@
+/*
+ * pico-umac device request channel
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DEVCHAN_H
+#define DEVCHAN_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#if HOST_BUILD
+#include <sched.h>
+#else
+#include "hardware/sync.h"
+#endif
+
+#ifndef DEVCHAN_SIZE
+#define DEVCHAN_SIZE            4
+#endif
+#if (DEVCHAN_SIZE & (DEVCHAN_SIZE - 1))
+#error "DEVCHAN_SIZE must be a power of 2"
+#endif
+
+typedef enum {
+        DEVCHAN_DISC_READ = 1,
+        DEVCHAN_DISC_WRITE,
+} devchan_op_t;
+
+typedef struct {
+        uint8_t         op;             /* devchan_op_t */
+        uint8_t         unit;           /* e.g. the drive */
+        uint8_t         *data;          /* Owned by the server until it replies */
+        uint32_t        offset;
+        uint32_t        len;
+} devchan_req_t;
+
+typedef struct {
+        int32_t         result;
+} devchan_resp_t;
+
+/* Requests from the emulation (on core 1) to device backends on core 0,
+ * and their responses, which come back in the same order.  Each direction
+ * is a single-producer, single-consumer ring like input.h's:  indices run
+ * freely, each is written by one side only, and is published with release
+ * ordering after the slot it covers.  The client never has more requests
+ * outstanding than the rings hold, so the server's replies always fit.
+ */
+typedef struct {
+        devchan_req_t   req[DEVCHAN_SIZE];
+        devchan_resp_t  resp[DEVCHAN_SIZE];
+        uint32_t        req_prod;       /* Client */
+        uint32_t        req_cons;       /* Server */
+        uint32_t        resp_prod;      /* Server */
+        uint32_t        resp_cons;      /* Client */
+
+        uint32_t        calls;          /* Client:  requests sent */
+        uint32_t        waits;          /* ...and times it had to wait */
+} devchan_t;
+
+/* Waiting for the other side:  the core sleeps until an event (a reply's
+ * __sev(), or an IRQ).  The host build's threads just yield, so that
+ * waiting doesn't move umac_bench's virtual clock.
+ */
+static inline void      devchan_wait(void)
+{
+#if HOST_BUILD
+        sched_yield();
+#else
+        __wfe();
+#endif
+}
+
+static inline void      devchan_signal(void)
+{
+#if !HOST_BUILD
+        __sev();
+#endif
+}
+
+void    devchan_init(devchan_t *ch);
+
+/* Client:  returns false if as many requests as the rings hold are
+ * outstanding
+ */
+bool    devchan_send(devchan_t *ch, const devchan_req_t *req);
+/* Client:  returns false if no response has arrived */
+bool    devchan_receive(devchan_t *ch, devchan_resp_t *resp);
+/* Client:  sends a request and waits for its result (with nothing else
+ * outstanding)
+ */
+int     devchan_call(devchan_t *ch, const devchan_req_t *req);
+
+/* Server:  returns false if there's no request */
+bool    devchan_take(devchan_t *ch, devchan_req_t *req);
+/* Server:  replies to the oldest request taken */
+void    devchan_reply(devchan_t *ch, const devchan_resp_t *resp);
+
+/* Server:  a cheap check for a request */
+static inline bool devchan_pending(devchan_t *ch)
+{
+        return __atomic_load_n(&ch->req_prod, __ATOMIC_ACQUIRE) !=
+                __atomic_load_n(&ch->req_cons, __ATOMIC_RELAXED);
+}
+
+#endif
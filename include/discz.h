@@ -0,0 +1,93 @@
+/*
+ * pico-umac block-compressed disc image
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DISCZ_H
+#define DISCZ_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* An image (from tools/discpack) is a header, an index, then the disc's
+ * blocks, each compressed on its own, so any block can be read without
+ * the rest.  All little-endian:
+ *
+ *      0       "UMDZ"
+ *      4       Disc size, in bytes
+ *      8       Block size (4KB or 8KB)
+ *      12      Number of blocks, n
+ *      16      n+1 offsets (from the start of the image) of each block's
+ *              data, the last being the end of the image
+ *
+ * A block's data is its length if stored (as when it doesn't compress),
+ * none if it's all zeroes, and otherwise LZ4's block format.  The last
+ * block is short if the disc isn't a multiple of the block size.
+ */
+#define DISCZ_MAGIC             "UMDZ"
+#define DISCZ_HDR_SIZE          16
+#define DISCZ_MIN_BLOCK         4096
+#define DISCZ_MAX_BLOCK         8192
+
+/* Blocks are decompressed into an LRU cache, of as many blocks as fit in
+ * the buffer given, up to:
+ */
+#define DISCZ_MAX_SLOTS         16
+
+typedef struct {
+        const uint8_t   *image;
+        uint32_t        size;           /* Of the disc */
+        uint32_t        block_size;
+        uint32_t        blocks;
+        uint8_t         *cache;
+        unsigned int    slots;
+        int32_t         slot_block[DISCZ_MAX_SLOTS];    /* -1 is empty */
+        uint32_t        slot_used[DISCZ_MAX_SLOTS];     /* LRU stamp */
+        uint32_t        clock;
+        /* Stats: */
+        uint32_t        hits;
+        uint32_t        misses;         /* Decompressed into the cache */
+        uint32_t        direct;         /* Whole blocks, straight to the reader */
+        uint32_t        errors;
+} discz_t;
+
+/* Check an image (image_len bytes) and set up z to read it, caching in
+ * cache_size bytes at cache.  Returns 0, or -1 if the image is bad or
+ * the cache can't hold a block.
+ */
+int     discz_open(discz_t *z, const uint8_t *image, unsigned int image_len,
+                   uint8_t *cache, unsigned int cache_size);
+
+/* Read len bytes of the disc at offset (a disc_descr_t op_read, with z as
+ * its ctx).  Returns 0, or -1 if out of range or a block's corrupt.
+ */
+int     discz_read(void *ctx, uint8_t *data, unsigned int offset, unsigned int len);
+
+/* Decompress LZ4 block-format data to exactly out_len bytes.  Returns 0,
+ * or -1 if it's malformed (without reading or writing out of bounds).
+ */
+int     discz_decompress(const uint8_t *in, unsigned int in_len,
+                         uint8_t *out, unsigned int out_len);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * pico-umac emulation scheduler
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EMU_SCHED_H
+#define EMU_SCHED_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* The emulated 68000's clock */
+#define SCHED_CLOCK_HZ          7833600
+/* Batches are sized to take about this long, bounding the latency of
+ * everything polled between them (vsync, input):
+ */
+#define SCHED_SLICE_US          2000
+#define SCHED_MAX_BATCH         64
+/* In real-time mode, a lag beyond this is given up on rather than caught
+ * up (by running flat out) later:
+ */
+#define SCHED_MAX_LAG_US        50000
+
+typedef enum {
+        SCHED_REALTIME = 0,     /* Paced to a real 7.8336MHz 68000 */
+        SCHED_TURBO,            /* Unthrottled */
+} sched_mode_t;
+
+/* Decides how many umac_loop() quanta to run between polls.  Time is passed
+ * in (in us), so this has no SDK dependencies and can be driven from a
+ * virtual clock.
+ */
+typedef struct {
+        sched_mode_t    mode;
+        unsigned int    quantum;        /* 68K cycles per umac_loop() */
+        unsigned int    batch;          /* Current batch size, in quanta */
+        uint64_t        base_us;        /* Wall time at emulated time 0 */
+        uint64_t        emu_us;         /* Emulated time */
+        uint64_t        emu_rem;        /* ...and remainder, in cycles*10^6 */
+        uint64_t        batch_start_us;
+        uint64_t        frame_start_us;
+        uint32_t        frame_busy_us;
+        /* Per-frame results:  the last frame's slack (time not spent
+         * emulating), or if behind real time, minus the lag:
+         */
+        int32_t         slack_us;
+        uint32_t        frames;
+        uint32_t        overruns;       /* Frames that ended behind */
+        uint64_t        lost_us;        /* Lag given up on */
+} sched_t;
+
+void    sched_init(sched_t *s, sched_mode_t mode, unsigned int quantum, uint64_t now_us);
+void    sched_set_mode(sched_t *s, sched_mode_t mode, uint64_t now_us);
+/* Returns the number of quanta to run now; 0 if ahead of real time */
+unsigned int    sched_batch(sched_t *s, uint64_t now_us);
+/* After running the quanta sched_batch() returned */
+void    sched_done(sched_t *s, unsigned int quanta, uint64_t now_us);
+/* At each guest vsync, to account the frame */
+void    sched_frame(sched_t *s, uint64_t now_us);
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * pico-umac framebuffer capture
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FBCAP_H
+#define FBCAP_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* The framebuffer is streamed as packets of:
+ *
+ *   0xfb 0xca <type> <len lo> <len hi> <len bytes of payload> <crc lo> <crc hi>
+ *
+ * The CRC is CRC-16/CCITT (0x1021, init 0xffff) over type, length and
+ * payload.  Packets may be mixed with console text (e.g. printf() output
+ * from core 1), so a receiver should resync on the marker and discard
+ * packets with bad CRCs.  Multi-byte fields are little-endian.
+ *
+ * Each update is a FRAME, then ROWs for lines that changed since they were
+ * last sent, then an END:
+ *   FRAME: u32 seq, u16 width, u16 height, u8 flags (bit 0: all rows follow)
+ *   ROW:   u16 row, then the row's bytes PackBits-compressed (as the Mac
+ *          does:  n < 128 is n+1 literal bytes, n > 128 repeats the next
+ *          byte 257-n times)
+ *   END:   u32 seq, u16 rows sent, u16 rows still to send, u32 total bytes
+ *          output, u32 captures, u32 total capture CPU time (us)
+ * Rows that don't fit in the buffer are left for the next update.
+ */
+#define FBCAP_SYNC0             0xfb
+#define FBCAP_SYNC1             0xca
+#define FBCAP_PKT_FRAME         'F'
+#define FBCAP_PKT_ROW           'R'
+#define FBCAP_PKT_END           'E'
+#define FBCAP_FLAG_KEY          1
+
+#define FBCAP_MAX_ROWS          768
+#define FBCAP_MAX_ROW_BYTES     128
+#define FBCAP_BUF_SIZE          4096
+/* Every Nth update resends all rows, for receivers that join late: */
+#define FBCAP_KEY_INTERVAL      64
+
+typedef struct {
+        unsigned int    width;
+        unsigned int    height;
+        unsigned int    stride;         /* Bytes per row */
+        uint32_t        hashes[FBCAP_MAX_ROWS];
+        uint32_t        force[FBCAP_MAX_ROWS / 32];     /* Rows to send regardless */
+        unsigned int    start_row;      /* Resume point after a partial update */
+        unsigned int    key_countdown;
+        uint32_t        seq;
+        /* Stats: */
+        uint32_t        captures;
+        uint32_t        rows_sent;
+        uint32_t        bytes;
+        /* Output for this update: */
+        unsigned int    len;
+        uint8_t         buf[FBCAP_BUF_SIZE];
+} fbcap_t;
+
+/* width must be a multiple of 8, and at most FBCAP_MAX_ROW_BYTES*8 */
+void            fbcap_init(fbcap_t *f, unsigned int width, unsigned int height);
+
+/* Compare fb (a 1BPP Mac-order framebuffer) with what's been sent, and encode
+ * an update in f->buf.  Returns the length (0 if nothing changed).  busy_us is
+ * reported in the END packet.
+ */
+unsigned int    fbcap_capture(fbcap_t *f, const uint8_t *fb, uint32_t busy_us);
+
+/* Helpers (exposed for host-side checks): */
+unsigned int    fbcap_packbits(const uint8_t *in, unsigned int len, uint8_t *out);
+uint16_t        fbcap_crc16(uint16_t crc, const uint8_t *data, unsigned int len);
+
+#endif
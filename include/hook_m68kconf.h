@@ -0,0 +1,92 @@
+/*
+ * pico-umac Musashi configuration, with hooks
+ *
+ * This is umac's configuration, plus an instruction hook for opcode
+ * counting (USE_OPCOUNT), native traps (USE_TRAPS) and idle detection
+ * (USE_IDLE), and direct-mapped memory accesses (USE_MEMMAP).  (umac's
+ * include directory comes before Musashi's in the include path, so it's
+ * umac's m68kconf.h that's found here.)
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HOOK_M68KCONF_H
+#define HOOK_M68KCONF_H
+
+#include "m68kconf.h"
+#if USE_OPCOUNT
+#include "opcount.h"
+#endif
+#if USE_TRAPS
+#include "traps.h"
+#endif
+#if USE_IDLE
+#include "idle.h"
+#endif
+
+/* The opcode count comes first:  it counts the previous instruction.  A
+ * native trap replaces this one and moves the PC past it, and Musashi
+ * fetches the next without another call here, so that's looked at too (it
+ * may be another trap).  Idle detection looks at whichever instruction
+ * Musashi will run, which may be an event call.  This is included by
+ * m68k.h before its register names, so the new PC isn't read back.
+ */
+static inline void      hook_insn(unsigned int pc)
+{
+#if USE_OPCOUNT
+        opcount_insn();
+#endif
+#if USE_TRAPS
+        while (traps_hook(pc))
+                pc += 2;
+#endif
+#if USE_IDLE
+        idle_hook(pc);
+#endif
+}
+
+#undef M68K_INSTRUCTION_HOOK
+#undef M68K_INSTRUCTION_CALLBACK
+#define M68K_INSTRUCTION_HOOK           OPT_SPECIFY_HANDLER
+#define M68K_INSTRUCTION_CALLBACK(pc)   hook_insn(pc)
+
+/* Musashi's core (m68kcpu.h, included by its sources but not umac's) calls
+ * the inline fast paths, which call umac's handlers for anything unmapped.
+ * Instruction fetches are data reads, or if umac separates them, they have
+ * fast paths of their own.
+ */
+#if USE_MEMMAP && defined(M68KCPU__HEADER)
+#include "memmap.h"
+#define m68k_read_memory_8(a)           memmap_read_8(a)
+#define m68k_read_memory_16(a)          memmap_read_16(a)
+#define m68k_read_memory_32(a)          memmap_read_32(a)
+#define m68k_write_memory_8(a, v)       memmap_write_8(a, v)
+#define m68k_write_memory_16(a, v)      memmap_write_16(a, v)
+#define m68k_write_memory_32(a, v)      memmap_write_32(a, v)
+#if defined(M68K_SEPARATE_READS) && M68K_SEPARATE_READS == OPT_ON
+#define m68k_read_immediate_16(a)       memmap_fetch_16(a)
+#define m68k_read_immediate_32(a)       memmap_fetch_32(a)
+#endif
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * pico-umac performance HUD text rendering
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HUD_H
+#define HUD_H
+
+#include <inttypes.h>
+
+/* Glyphs are 8 pixels wide (i.e. one byte), 7 high plus a blank line */
+#define HUD_CHAR_W      8
+#define HUD_FONT_H      8
+/* A HUD strip is one line of text with a blank line above and below */
+#define HUD_LINES       (HUD_FONT_H + 2)
+
+/* Render one pixel row (0 to HUD_FONT_H-1) of text into out, a line of wpl
+ * words of 1BPP Mac-order pixels (bytes left to right, MSB leftmost, 1 is
+ * black).  Text is white on black; characters beyond the line are dropped,
+ * and lower-case is shown as upper-case.
+ */
+void    hud_render_row(const char *text, unsigned int row, uint32_t *out, unsigned int wpl);
+
+/* Render text into a strip of HUD_LINES lines of wpl words each */
+void    hud_render(const char *text, uint32_t *strip, unsigned int wpl);
+
+#endif
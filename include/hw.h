@@ -29,9 +29,11 @@
 
 #define GPIO_LED_PIN    PICO_DEFAULT_LED_PIN
 
+/* VIDEO_BPP data pins, then syncs/clock (then DE, for LCDs): */
 #define GPIO_VID_DATA   GPIO_VID_BASE
-#define GPIO_VID_VS     (GPIO_VID_DATA + 1)
+#define GPIO_VID_VS     (GPIO_VID_DATA + VIDEO_BPP)
 #define GPIO_VID_CLK    (GPIO_VID_VS + 1)
 #define GPIO_VID_HS     (GPIO_VID_CLK + 1)
+#define GPIO_VID_DE     (GPIO_VID_HS + 1)
 
 #endif
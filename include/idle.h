@@ -0,0 +1,125 @@
+/*
+ * pico-umac guest idle detection
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "maclowmem.h"
+
+/* An application with nothing to do spins calling GetNextEvent (or
+ * WaitNextEvent), which returns null events.  The instruction hook (see
+ * hook_m68kconf.h) watches for those calls; once the guest's spinning, the
+ * rest of its quantum is skipped.  umac still advances emulated time (VIA
+ * timers and so on) by the whole quantum, so the guest sees time pass as
+ * it would have, but doesn't spend host cycles doing nothing.
+ */
+#define TRAP_GETNEXTEVENT       0xa970
+#define TRAP_WAITNEXTEVENT      0xa860
+#define TRAP_AUTOPOP            0x0400
+
+/* The guest's idle after this many event calls in a row have returned a
+ * null event...
+ */
+#define IDLE_NULL_EVENTS        3
+/* ...and between each return and the next call it ran at most this many
+ * instructions (so an application doing real work on null events, such as
+ * a game or a long calculation, isn't slowed down):
+ */
+#define IDLE_SPIN_INSNS         400
+
+#define IDLE_NO_RET             0xffffffff
+
+typedef struct {
+        uint32_t        quanta;         /* umac_loop() calls */
+        uint32_t        idle;           /* ...cut short, as the guest was idle */
+        uint32_t        calls;          /* Event calls */
+        uint32_t        nulls;          /* ...returning a null event, in a spin */
+} idle_stats_t;
+
+extern volatile bool idle_enabled;
+/* Written by core 1 only */
+extern idle_stats_t idle_stats;
+
+extern const uint8_t *idle_ram;
+extern uint32_t idle_ram_size;
+extern const uint8_t *idle_rom;
+extern uint32_t idle_rom_size;
+/* Where the last event call returns to, and instructions since it did */
+extern uint32_t idle_ret;
+extern uint32_t idle_insns;
+extern bool idle_hit;
+
+/* ram is the guest's (big-endian) RAM, and rom its ROM image */
+void    idle_init(const uint8_t *ram, uint32_t ram_size, const uint8_t *rom, uint32_t rom_size);
+
+/* Look at an event call, at pc, before it's made */
+void    idle_call(uint32_t pc, uint16_t op);
+
+/* Input's arrived:  run the guest flat out until it's idle again */
+void    idle_wake(void);
+
+/* Called before each instruction:  like traps_hook(), this only peeks at
+ * the opcode's first byte.
+ */
+static inline void      idle_hook(uint32_t pc)
+{
+        const uint8_t *p;
+
+        if (!idle_enabled)
+                return;
+        pc &= 0xffffff;
+        if (pc == idle_ret) {
+                idle_ret = IDLE_NO_RET;
+                idle_insns = 0;
+        }
+        idle_insns++;
+        if (pc < idle_ram_size)
+                p = idle_ram + pc;
+        else if (pc >= MAC_ROM_BASE && pc < MAC_ROM_BASE + idle_rom_size)
+                p = idle_rom + (pc - MAC_ROM_BASE);
+        else
+                return;
+        /* 0xa8/0xa9, with or without auto-pop */
+        if ((p[0] & 0xfa) == 0xa8)
+                idle_call(pc, (p[0] << 8) | p[1]);
+}
+
+/* Call after each umac_loop():  returns true if the guest was idle */
+static inline bool      idle_quantum_end(void)
+{
+        bool idle = idle_hit;
+
+        idle_hit = false;
+        idle_stats.quanta++;
+        if (idle)
+                idle_stats.idle++;
+        return idle;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * pico-umac input events, from core 0 (USB HID) to core 1 (umac)
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifndef INPUT_RING_SIZE
+#define INPUT_RING_SIZE         32
+#endif
+#if (INPUT_RING_SIZE & (INPUT_RING_SIZE - 1)) || INPUT_RING_SIZE < 4
+#error "INPUT_RING_SIZE must be a power of 2, at least 4"
+#endif
+
+typedef enum {
+        INPUT_KEY = 1,          /* Edge */
+        INPUT_BUTTON,           /* Edge */
+        INPUT_MOUSE,            /* Motion, coalesced */
+        INPUT_POINTER,          /* Absolute position (see pointer.h), latest wins */
+        INPUT_WHEEL,            /* Coalesced */
+} input_type_t;
+
+typedef struct {
+        uint32_t        time_us;        /* When the producer saw it (the
+                                         * first of a coalesced group) */
+        uint8_t         type;           /* input_type_t */
+        uint8_t         down;           /* Edges:  pressed (else released) */
+        uint8_t         key;            /* INPUT_KEY:  Mac keycode, or
+                                         * INPUT_BUTTON:  button number */
+        int16_t         dx;             /* INPUT_MOUSE:  motion */
+        int16_t         dy;             /* INPUT_POINTER:  0..POINTER_MAX */
+                                        /* INPUT_WHEEL:  in dy */
+} input_event_t;
+
+/* A single-producer, single-consumer ring.  The indices run freely (and
+ * are masked on use); each is only written by one side, and published
+ * with release ordering after the slot it covers, so no locks are needed.
+ *
+ * The rest belongs to the producer:  the keys/buttons the consumer will
+ * see as down (so that room is kept for their releases), motion waiting
+ * to be sent, and counts of what happened when the ring was full.
+ */
+typedef struct {
+        input_event_t   ev[INPUT_RING_SIZE];
+        uint32_t        prod;
+        uint32_t        cons;
+
+        uint32_t        key_down[256 / 32];
+        uint8_t         buttons_down;
+        unsigned int    held;
+        int             pend_dx;
+        int             pend_dy;
+        int             pend_wheel;
+        int             pend_x;
+        int             pend_y;
+        bool            pend_pointer;
+        uint32_t        pend_time_us;
+
+        uint32_t        dropped;        /* Presses refused (and their releases) */
+        uint32_t        coalesced;      /* Motion/wheel/pointer merged */
+        uint32_t        max_used;       /* High-water mark */
+} input_ring_t;
+
+/* The ring from hid.c/kbd.c to main.c */
+extern input_ring_t input_events;
+
+void    input_init(input_ring_t *r);
+
+/* Producer.  Presses are refused (returning false, and counted) unless
+ * there would still be room for the releases of everything held down;
+ * a release is never refused, and is skipped if its press was.  Motion,
+ * wheel and pointer events always succeed:  they're merged with any that
+ * haven't been sent yet, and go before the next edge, or at the next
+ * input_flush().
+ */
+bool    input_key(input_ring_t *r, uint8_t key, bool down, uint32_t time_us);
+bool    input_button(input_ring_t *r, uint8_t button, bool down, uint32_t time_us);
+void    input_motion(input_ring_t *r, int dx, int dy, uint32_t time_us);
+void    input_wheel(input_ring_t *r, int dz, uint32_t time_us);
+void    input_pointer(input_ring_t *r, unsigned int x, unsigned int y, uint32_t time_us);
+/* Producer:  send any merged events, if there's room */
+void    input_flush(input_ring_t *r);
+
+/* The raw ring.  Producer:  returns false (and drops the event) if full */
+bool    input_push(input_ring_t *r, const input_event_t *e);
+/* Consumer:  returns false if empty */
+bool    input_pop(input_ring_t *r, input_event_t *e);
+
+/* Consumer:  a cheap check, so input is only touched when something has
+ * arrived.
+ */
+static inline bool input_pending(input_ring_t *r)
+{
+        return __atomic_load_n(&r->prod, __ATOMIC_ACQUIRE) !=
+                __atomic_load_n(&r->cons, __ATOMIC_RELAXED);
+}
+
+#endif
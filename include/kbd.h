@@ -30,11 +30,11 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
-bool            kbd_queue_empty();
-/* If empty, return 0, else return a mac keycode in [7:0] and [15] set if a press (else release) */
-uint16_t        kbd_queue_pop();
-
-/* FIXME: map modifiers */
+/* Map a HID key event, and queue it on input_events as an INPUT_KEY.
+ * Returns false if unmapped, or a press was refused as the queue is full
+ * (see input.h).
+ * FIXME: map modifiers
+ */
 bool            kbd_queue_push(uint8_t hid_keycode, bool pressed);
 
 #endif
@@ -0,0 +1,58 @@
+/*
+ * pico-umac:  Mac low-memory globals, and other addresses in the guest
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MACLOWMEM_H
+#define MACLOWMEM_H
+
+#define MAC_OSTABLE             0x400   /* OS trap dispatch table, 256 longs */
+#define MAC_OSTABLE_NUM         256
+#define MAC_SCRNBASE            0x824   /* Ptr:  main screen buffer */
+#define MAC_MTEMP               0x828   /* Point (v, h):  new position */
+#define MAC_RAWMOUSE            0x82c   /* Point:  unclipped position */
+#define MAC_CRSRRECT            0x83c   /* Rect:  cursor's, in global coordinates */
+#define MAC_CRSRVIS             0x8cc   /* Byte:  cursor is drawn */
+#define MAC_CRSRNEW             0x8ce   /* Byte:  position has changed */
+#define MAC_CRSRCOUPLE          0x8cf   /* Byte:  cursor follows the mouse */
+#define MAC_CURAPNAME           0x910   /* Str31:  current application */
+#define MAC_TOPMAPHNDL          0xa50   /* Handle:  first resource map */
+#define MAC_TBTRAPTABLE         0xc00   /* Toolbox trap dispatch table, 512 longs */
+#define MAC_TBTRAPTABLE_NUM     512
+
+#define MAC_ROM_BASE            0x400000
+#define MAC_ROM_SIZE            0x20000         /* Mac Plus, 128KB */
+
+#define MAC_VIA_BUFA            0xeffffe        /* VIA port A (no handshake) */
+#define MAC_VIA_PAGE2           0x40            /* Port A:  1 for the main screen */
+#define MAC_SCREEN_MAIN         0x5900          /* Screen buffers, below the top of RAM */
+#define MAC_SCREEN_ALT          0xd900
+
+/* The offset in RAM of the screen buffer selected by VIA port A */
+static inline unsigned int      mac_screen_offset(unsigned int via_bufa, unsigned int ram_size)
+{
+        return ram_size - ((via_bufa & MAC_VIA_PAGE2) ? MAC_SCREEN_MAIN : MAC_SCREEN_ALT);
+}
+
+#endif
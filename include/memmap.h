@@ -0,0 +1,232 @@
+/*
+ * pico-umac direct-mapped guest memory, for Musashi's reads and writes
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MEMMAP_H
+#define MEMMAP_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* For reads, the low 8MB of the 24-bit bus (RAM and ROM; above is I/O)
+ * is split into 16KB pages.  A page that's wholly RAM or ROM maps straight
+ * to the host's copy, which Musashi reads inline.  Writes to RAM are
+ * inline too.  Anything else (I/O, RAM mirrors, a part-page at the end of
+ * RAM, and writes to ROM) goes to umac's handlers, as before.
+ *
+ * While the ROM's overlaid on RAM at reset, RAM isn't mapped.  The overlay
+ * is switched by a VIA write:  after any, memmap_update() asks umac's
+ * handlers which of RAM or ROM is at address 0.
+ */
+#define MEMMAP_PAGE_SHIFT       14
+#define MEMMAP_PAGE_SIZE        (1 << MEMMAP_PAGE_SHIFT)
+#define MEMMAP_LIMIT            0x800000
+#define MEMMAP_PAGES            (MEMMAP_LIMIT >> MEMMAP_PAGE_SHIFT)
+
+#define MEMMAP_VIA_BASE         0xe80000
+#define MEMMAP_VIA_END          0xf00000
+
+/* An entry is the host address of the page, less the page's guest address
+ * (so adding a guest address gives the host's); 0 means unmapped.
+ */
+extern uintptr_t memmap_pages[MEMMAP_PAGES];
+
+/* RAM's host address, and the size that's written directly (0 while the
+ * ROM's overlaid)
+ */
+extern uint8_t *memmap_ram;
+extern uint32_t memmap_ram_limit;
+
+/* Map ram and rom (call after umac_init(), which resets the overlay) */
+void    memmap_init(uint8_t *ram, uint32_t ram_size, const uint8_t *rom, uint32_t rom_size);
+void    memmap_update(void);
+
+/* umac's handlers */
+unsigned int    m68k_read_memory_8(unsigned int address);
+unsigned int    m68k_read_memory_16(unsigned int address);
+unsigned int    m68k_read_memory_32(unsigned int address);
+void    m68k_write_memory_8(unsigned int address, unsigned int value);
+void    m68k_write_memory_16(unsigned int address, unsigned int value);
+void    m68k_write_memory_32(unsigned int address, unsigned int value);
+
+/* The host's pointer for a size-byte read within one mapped page, or NULL */
+static inline const uint8_t     *memmap_rd_ptr(unsigned int address, unsigned int size)
+{
+        if (address >= MEMMAP_LIMIT ||
+            (address & (MEMMAP_PAGE_SIZE - 1)) > MEMMAP_PAGE_SIZE - size)
+                return NULL;
+        uintptr_t e = memmap_pages[address >> MEMMAP_PAGE_SHIFT];
+        return e ? (const uint8_t *)(e + address) : NULL;
+}
+
+/* ...and for a write to RAM */
+static inline uint8_t   *memmap_wr_ptr(unsigned int address, unsigned int size)
+{
+        return address + size <= memmap_ram_limit ? memmap_ram + address : NULL;
+}
+
+/* The guest's big-endian.  A 68K long need only be word-aligned, and the
+ * RP2040's M0+ faults on unaligned loads, so there it's bytewise.  The
+ * RP2350's M33 (and a host) can do it as one access and a byte-swap.
+ */
+#if (defined(__ARM_FEATURE_UNALIGNED) || !defined(__arm__)) && \
+        __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MEMMAP_UNALIGNED        1
+#else
+#define MEMMAP_UNALIGNED        0
+#endif
+
+static inline unsigned int      memmap_get_16(const uint8_t *p)
+{
+#if MEMMAP_UNALIGNED
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return __builtin_bswap16(v);
+#else
+        return (p[0] << 8) | p[1];
+#endif
+}
+
+static inline unsigned int      memmap_get_32(const uint8_t *p)
+{
+#if MEMMAP_UNALIGNED
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return __builtin_bswap32(v);
+#else
+        return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+#endif
+}
+
+static inline void      memmap_put_16(uint8_t *p, unsigned int value)
+{
+#if MEMMAP_UNALIGNED
+        uint16_t v = __builtin_bswap16(value);
+        memcpy(p, &v, 2);
+#else
+        p[0] = value >> 8;
+        p[1] = value;
+#endif
+}
+
+static inline void      memmap_put_32(uint8_t *p, unsigned int value)
+{
+#if MEMMAP_UNALIGNED
+        uint32_t v = __builtin_bswap32(value);
+        memcpy(p, &v, 4);
+#else
+        p[0] = value >> 24;
+        p[1] = value >> 16;
+        p[2] = value >> 8;
+        p[3] = value;
+#endif
+}
+
+static inline unsigned int      memmap_read_8(unsigned int address)
+{
+        const uint8_t *p = memmap_rd_ptr(address, 1);
+
+        return p ? p[0] : (m68k_read_memory_8)(address);
+}
+
+static inline unsigned int      memmap_read_16(unsigned int address)
+{
+        const uint8_t *p = memmap_rd_ptr(address, 2);
+
+        return p ? memmap_get_16(p) : (m68k_read_memory_16)(address);
+}
+
+static inline unsigned int      memmap_read_32(unsigned int address)
+{
+        const uint8_t *p = memmap_rd_ptr(address, 4);
+
+        return p ? memmap_get_32(p) : (m68k_read_memory_32)(address);
+}
+
+#if defined(M68K_SEPARATE_READS) && M68K_SEPARATE_READS == OPT_ON
+unsigned int    m68k_read_immediate_16(unsigned int address);
+unsigned int    m68k_read_immediate_32(unsigned int address);
+
+static inline unsigned int      memmap_fetch_16(unsigned int address)
+{
+        const uint8_t *p = memmap_rd_ptr(address, 2);
+
+        return p ? memmap_get_16(p) : (m68k_read_immediate_16)(address);
+}
+
+static inline unsigned int      memmap_fetch_32(unsigned int address)
+{
+        const uint8_t *p = memmap_rd_ptr(address, 4);
+
+        return p ? memmap_get_32(p) : (m68k_read_immediate_32)(address);
+}
+#endif
+
+static inline void      memmap_io_written(unsigned int address)
+{
+        if (address >= MEMMAP_VIA_BASE && address < MEMMAP_VIA_END)
+                memmap_update();
+}
+
+static inline void      memmap_write_8(unsigned int address, unsigned int value)
+{
+        uint8_t *p = memmap_wr_ptr(address, 1);
+
+        if (p) {
+                p[0] = value;
+        } else {
+                (m68k_write_memory_8)(address, value);
+                memmap_io_written(address);
+        }
+}
+
+static inline void      memmap_write_16(unsigned int address, unsigned int value)
+{
+        uint8_t *p = memmap_wr_ptr(address, 2);
+
+        if (p) {
+                memmap_put_16(p, value);
+        } else {
+                (m68k_write_memory_16)(address, value);
+                memmap_io_written(address);
+        }
+}
+
+static inline void      memmap_write_32(unsigned int address, unsigned int value)
+{
+        uint8_t *p = memmap_wr_ptr(address, 4);
+
+        if (p) {
+                memmap_put_32(p, value);
+        } else {
+                (m68k_write_memory_32)(address, value);
+                memmap_io_written(address);
+        }
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * pico-umac 68K opcode counting
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef OPCOUNT_H
+#define OPCOUNT_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Executed opcodes are counted in a hash table of 2^OPCOUNT_BITS slots
+ * (a workload runs a few thousand distinct opcodes).  An opcode that
+ * finds no slot within OPCOUNT_PROBES is counted as overflow.
+ */
+#ifndef OPCOUNT_BITS
+#define OPCOUNT_BITS            12
+#endif
+#define OPCOUNT_SLOTS           (1 << OPCOUNT_BITS)
+#define OPCOUNT_PROBES          16
+
+/* Musashi's instruction hook (see hook_m68kconf.h):  called before
+ * each instruction, it counts the one before, whose opcode is still in IR.
+ */
+void    opcount_insn(void);
+
+/* Count op as executed, for an instruction Musashi doesn't run (such as a
+ * native trap's A-line instruction, see traps.c)
+ */
+void    opcount_op(uint16_t op);
+
+/* Print the counts as "opc:" lines on stdout, for tools/pgo_place.py and
+ * tools/oprank.py
+ */
+void    opcount_dump(void);
+
+/* Restart counting (from the other core, counts in flight may be lost) */
+void    opcount_clear(void);
+
+#if HOST_BUILD
+/* Keep the last n opcodes executed, and write them (16-bit little-endian)
+ * to f, for tools/pgo_place.py's XIP cache model.
+ */
+void    opcount_trace_start(unsigned int n);
+void    opcount_trace_write(FILE *f);
+#endif
+
+#endif
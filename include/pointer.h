@@ -0,0 +1,59 @@
+/*
+ * pico-umac absolute pointer support
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef POINTER_H
+#define POINTER_H
+
+#include <inttypes.h>
+
+#include "maclowmem.h"
+
+/* Absolute positions are 0..POINTER_MAX in each axis (as HID digitizers
+ * commonly report), independent of the Mac's screen size.
+ */
+#define POINTER_MAX             32767
+
+/* Map an absolute position to a screen coordinate (0..size-1); each
+ * coordinate gets an equal share of the range.
+ */
+static inline int       pointer_map(unsigned int pos, unsigned int size)
+{
+        return pos * size / (POINTER_MAX + 1);
+}
+
+/* The inverse:  the centre of a coordinate's share */
+static inline unsigned int pointer_unmap(int coord, unsigned int size)
+{
+        return ((2 * coord + 1) * (POINTER_MAX + 1)) / (2 * size);
+}
+
+/* Move the Mac's cursor to (x, y), by writing the low-memory globals the
+ * ROM's mouse interrupt would:  the cursor VBL task then redraws it at the
+ * next vsync.  ram is the guest's (big-endian) RAM.
+ */
+void    pointer_set_lowmem(uint8_t *ram, int x, int y);
+
+#endif
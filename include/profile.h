@@ -0,0 +1,66 @@
+/*
+ * pico-umac 68K PC sampling profiler
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "maclowmem.h"
+
+/* Samples of the guest PC are counted in buckets over RAM and the ROM.
+ * RAM's buckets are scaled to its size (at least PROF_RAM_MIN_SHIFT bits,
+ * i.e. 64 bytes); the ROM's are 2^PROF_ROM_SHIFT bytes.
+ */
+#define PROF_RAM_BUCKETS        2048
+#define PROF_RAM_MIN_SHIFT      6
+#define PROF_ROM_BASE           MAC_ROM_BASE
+#define PROF_ROM_SIZE           MAC_ROM_SIZE
+#define PROF_ROM_SHIFT          6
+#define PROF_ROM_BUCKETS        (PROF_ROM_SIZE >> PROF_ROM_SHIFT)
+
+/* Set by core 1 while it runs the 68K:  when it's waiting for real time,
+ * the PC is stale, and a sample counts as idle.
+ */
+extern volatile bool profile_running;
+
+/* ram is the guest's (big-endian) RAM, read when dumping */
+void    profile_init(const uint8_t *ram, uint32_t ram_size);
+
+/* Count a sample of the 68K's PC, or a sample taken when it isn't running */
+void    profile_sample(uint32_t pc);
+void    profile_idle(void);
+
+void    profile_clear(void);
+
+/* Print the histogram (non-empty buckets), then the trap dispatch tables
+ * and the loaded code resources for tools/profsym.py to symbolise it,
+ * as "prof:" lines on stdout.
+ */
+void    profile_dump(uint32_t interval_us);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * pico-umac PSRAM (RP2350)
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PSRAM_H
+#define PSRAM_H
+
+#include <stddef.h>
+
+#include "hardware/regs/addressmap.h"
+
+/* An APS6404-style QSPI PSRAM on the QMI's second chip select appears in
+ * the XIP window after the flash, cached (writes too, once enabled).  The
+ * XIP cache is in front of the QMI for every bus master, so DMA (i.e.
+ * video) sees the CPUs' writes.
+ */
+#define PSRAM_BASE              (XIP_BASE + 0x01000000)
+
+/* Set up the QMI for the PSRAM on cs_pin (call after the system clock's
+ * set).  Returns its size in bytes, or 0 if there isn't one.
+ */
+size_t  psram_init(unsigned int cs_pin);
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * pico-umac time accounting
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <inttypes.h>
+
+/* Subsystems whose time is accounted.  Each is only accounted on one core
+ * (which is the only writer of its counters).
+ */
+typedef enum {
+        /* Core 1: */
+        STATS_UMAC = 0,         /* umac_loop() */
+        STATS_POLL,             /* vsync, input, HUD etc. between batches */
+        STATS_VIDEO_IRQ,        /* video_dma_irq() */
+        STATS_SLEEP,            /* Waiting (WFE) while the guest's idle */
+        /* Core 0: */
+        STATS_USB,              /* tuh_task() */
+        STATS_HID,              /* hid_app_task() */
+        STATS_FBCAP,            /* poll_fbcap() */
+        STATS_DEVICES,          /* poll_devices() */
+        STATS_NUM
+} stats_id_t;
+
+#define STATS_CORE(id)          ((id) < STATS_USB ? 1 : 0)
+
+typedef struct {
+        uint64_t        cycles;
+        uint32_t        count;
+        uint32_t        max;            /* Longest, in cycles */
+} stats_acc_t;
+
+extern stats_acc_t stats_acc[STATS_NUM];
+/* Cycles in accounted IRQs, per core, which are excluded from the section
+ * they interrupted:
+ */
+extern volatile uint32_t stats_irq_cycles[2];
+
+/* Time is counted in CPU cycles, from each core's own 24-bit SysTick, so
+ * one section can't be longer than 2^24 cycles (67ms at 250MHz).
+ */
+#define STATS_CLOCK_MASK        0xffffff
+
+#if HOST_BUILD
+/* Provided by the host build, from a fake clock */
+uint32_t        stats_clock(void);
+#else
+#include "hardware/structs/systick.h"
+
+static inline uint32_t stats_clock(void)
+{
+        /* SysTick counts down */
+        return ~systick_hw->cvr;
+}
+#endif
+
+typedef struct {
+        uint32_t        t0;
+        uint32_t        irq0;
+} stats_mark_t;
+
+static inline stats_mark_t stats_begin(stats_id_t id)
+{
+        return (stats_mark_t){ .t0 = stats_clock(), .irq0 = stats_irq_cycles[STATS_CORE(id)] };
+}
+
+static inline uint32_t stats_account(stats_id_t id, uint32_t cycles)
+{
+        stats_acc_t *a = &stats_acc[id];
+
+        a->cycles += cycles;
+        a->count++;
+        if (cycles > a->max)
+                a->max = cycles;
+        return cycles;
+}
+
+static inline void stats_end(stats_id_t id, stats_mark_t m)
+{
+        uint32_t irq = stats_irq_cycles[STATS_CORE(id)] - m.irq0;
+
+        stats_account(id, ((stats_clock() - m.t0) & STATS_CLOCK_MASK) - irq);
+}
+
+/* As stats_end(), for an IRQ handler */
+static inline void stats_end_irq(stats_id_t id, stats_mark_t m)
+{
+        stats_irq_cycles[STATS_CORE(id)] +=
+                stats_account(id, (stats_clock() - m.t0) & STATS_CLOCK_MASK);
+}
+
+/* Call on each core, before accounting there:  starts its SysTick */
+void    stats_init(void);
+/* Copy all counters.  A copy can be taken on either core; one written
+ * concurrently by the other core might be slightly out of date.
+ */
+void    stats_snapshot(stats_acc_t snap[STATS_NUM]);
+/* Print each subsystem's share of window_us (on its core), calls and mean
+ * time between two snapshots, and max time since boot (as neither core
+ * resets the other's counters).
+ */
+void    stats_report(const stats_acc_t now[STATS_NUM], const stats_acc_t base[STATS_NUM],
+                     uint64_t window_us, uint32_t clk_hz);
+
+#endif
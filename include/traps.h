@@ -0,0 +1,86 @@
+/*
+ * pico-umac native Toolbox traps
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRAPS_H
+#define TRAPS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "maclowmem.h"
+
+/* Some hot traps are run natively in C, instead of by the ROM:  the
+ * instruction hook (see hook_m68kconf.h) spots their A-line instruction
+ * before it's executed, and if the case is simple enough does the work,
+ * moving the PC past it.  Otherwise (or if the trap's been patched) the
+ * A-line instruction runs as usual, and the ROM does it.
+ */
+#define TRAP_BLOCKMOVE          0xa02e
+#define TRAP_FILLRECT           0xa8a5
+#define TRAP_COPYBITS           0xa8ec
+
+extern volatile bool traps_enabled;
+
+extern const uint8_t *traps_ram;
+extern uint32_t traps_ram_size;
+extern const uint8_t *traps_rom;
+extern uint32_t traps_rom_size;
+
+/* ram is the guest's (big-endian) RAM, and rom its ROM image */
+void    traps_init(uint8_t *ram, uint32_t ram_size, const uint8_t *rom, uint32_t rom_size);
+
+/* Run the trap at pc natively, if it's one of ours and simple enough */
+bool    traps_try(uint32_t pc, uint16_t op);
+
+/* Called before each instruction:  A-line instructions are rare, so this
+ * only peeks at the opcode's first byte.  Returns true if it ran the trap
+ * at pc and moved the PC past it, to pc + 2.  Musashi then fetches the
+ * instruction there without calling the hook, so the caller must look at
+ * that too.
+ */
+static inline bool      traps_hook(uint32_t pc)
+{
+        const uint8_t *p;
+
+        if (!traps_enabled)
+                return false;
+        pc &= 0xffffff;
+        if (pc < traps_ram_size)
+                p = traps_ram + pc;
+        else if (pc >= MAC_ROM_BASE && pc < MAC_ROM_BASE + traps_rom_size)
+                p = traps_rom + (pc - MAC_ROM_BASE);
+        else
+                return false;
+        if ((p[0] & 0xf7) == 0xa0)
+                return traps_try(pc, (p[0] << 8) | p[1]);
+        return false;
+}
+
+/* Print how often each trap ran natively, and fell back to the ROM */
+void    traps_dump(void);
+void    traps_clear(void);
+
+#endif
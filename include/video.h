@@ -28,6 +28,13 @@
 
 #include <inttypes.h>
 
-void    video_init(uint32_t *framebuffer);
+void            video_init(uint32_t *framebuffer, const char *mode);
+const char      *video_get_mode();
+void            video_set_framebuffer(uint32_t *framebuffer);
+uint32_t        video_get_frame_count();
+#if USE_HUD
+void            video_set_hud(const uint32_t *strip);
+uint32_t        video_get_irq_cycles();
+#endif
 
 #endif
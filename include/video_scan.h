@@ -0,0 +1,182 @@
+/*
+ * pico-umac video scan-out geometry
+ *
+ * Maps output (monitor) lines to the config and pixel data buffers that
+ * the video DMA sends to PIO for each line.  This is used both by the
+ * per-line IRQ and to generate a per-frame DMA list; it has no SDK
+ * dependencies, so can also be built on a host.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VIDEO_SCAN_H
+#define VIDEO_SCAN_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef struct {
+        unsigned int    v_total;        /* Lines per frame, including syncs/porches */
+        unsigned int    vsw;            /* VSync lines, at the start of the frame */
+        unsigned int    fb_v_start;     /* First line showing framebuffer data */
+        unsigned int    fb_vres;        /* Number of framebuffer lines */
+        unsigned int    v_shift;        /* Each FB line is output 1 << v_shift times */
+        unsigned int    wpl;            /* Words of pixel data per line */
+        const uint32_t  *fb;
+        const uint32_t  *null_line;     /* Blank line, wpl words */
+        /* 2 config words for VS lines, then 2 for other blanking lines, then 2
+         * for lines in the active area (which differ only if DE is output):
+         */
+        const uint32_t  *cfg;
+        unsigned int    act_start;      /* First line of active area */
+        unsigned int    act_lines;
+        /* Framebuffer to switch to at the start of the next frame: */
+        const uint32_t * volatile fb_next;
+        unsigned int    y;              /* Current line, for per-line scan-out */
+        /* Optional status strip (of hud_lines * wpl words) outside the FB: */
+        unsigned int    hud_start;
+        unsigned int    hud_lines;
+        const uint32_t  *hud;           /* NULL if off */
+        const uint32_t * volatile hud_next;
+} video_scan_t;
+
+/* A scan list is a sequence of {count, read address} pairs, one pair for each
+ * DMA transfer to PIO:  for each line, one pair for config and one for pixel
+ * data.  It's terminated by a {0, 0} pair.  Entries are uintptr_t so that the
+ * layout matches the DMA registers on the RP2040, and still holds a pointer
+ * on a 64-bit host.
+ */
+#define VIDEO_SCANLIST_WORDS(v_total)   (((v_total) * 2 + 1) * 2)
+
+/* Returns the framebuffer line displayed on output line y, or -1 if none.
+ * For scaled modes, consecutive output lines show the same FB line (so the
+ * DMA reads it again, rather than it being copied).
+ */
+static inline __attribute__((always_inline))
+int     video_scan_visible_y(const video_scan_t *vs, unsigned int y)
+{
+        unsigned int dy = y - vs->fb_v_start;
+
+        if (dy < (vs->fb_vres << vs->v_shift)) {
+                return dy >> vs->v_shift;
+        } else {
+                return -1;
+        }
+}
+
+static inline __attribute__((always_inline))
+const uint32_t  *video_scan_line_addr(const video_scan_t *vs, unsigned int y)
+{
+        int vy = video_scan_visible_y(vs, y);
+        if (vy >= 0)
+                return &vs->fb[vy * vs->wpl];
+        else if (vs->hud && (y - vs->hud_start) < vs->hud_lines)
+                return &vs->hud[(y - vs->hud_start) * vs->wpl];
+        else
+                return vs->null_line;
+}
+
+static inline __attribute__((always_inline))
+const uint32_t  *video_scan_cfg_addr(const video_scan_t *vs, unsigned int y)
+{
+        if (y < vs->vsw)
+                return &vs->cfg[0];
+        else if ((y - vs->act_start) < vs->act_lines)
+                return &vs->cfg[4];
+        else
+                return &vs->cfg[2];
+}
+
+/* Request a new framebuffer base.  This doesn't take effect until the next
+ * frame boundary, so a frame is never scanned from two framebuffers.
+ */
+static inline void      video_scan_set_fb(video_scan_t *vs, const uint32_t *fb)
+{
+        vs->fb_next = fb;
+}
+
+/* Similarly, switch the status strip (or NULL to remove it) */
+static inline void      video_scan_set_hud(video_scan_t *vs, const uint32_t *hud)
+{
+        vs->hud_next = hud;
+}
+
+/* Advance vs->y for per-line scan-out, returning true if it wrapped to the
+ * start of a new frame (in which case a pending framebuffer is latched).
+ */
+static inline __attribute__((always_inline))
+bool    video_scan_next_line(video_scan_t *vs)
+{
+        if (++vs->y >= vs->v_total) {
+                vs->y = 0;
+                vs->fb = vs->fb_next;
+                vs->hud = vs->hud_next;
+                return true;
+        }
+        return false;
+}
+
+/* Words of pixel data for a line of pixels at bpp bits per pixel */
+#define VIDEO_SCAN_WPL(pixels, bpp)     ((pixels) * (bpp) / 32)
+
+/* Set pixel x of a line (of bpp, 1/2/4, bits per pixel) to value v.  The line
+ * is in Mac framebuffer order:  bytes left to right, and pixels MSB-first
+ * within a byte, as pio_video shifts them out after the DMA byteswap.
+ */
+void            video_scan_put_pixel(uint32_t *line, unsigned int x, unsigned int bpp,
+                                     unsigned int v);
+unsigned int    video_scan_get_pixel(const uint32_t *line, unsigned int x, unsigned int bpp);
+
+/* Fill list (VIDEO_SCANLIST_WORDS(vs->v_total) entries) for a whole frame */
+void    video_scan_build_list(const video_scan_t *vs, uintptr_t *list);
+
+/* For scan list output:  latch a pending framebuffer/status strip, rewriting
+ * the list's pixel data addresses if either changed.  Call at the start of a
+ * frame; the list entries are rewritten in order, and the blank lines at the
+ * top of the frame (VSW + VBP at least) give ample time to stay ahead of the
+ * DMA.
+ */
+static inline __attribute__((always_inline))
+bool    video_scan_latch_list(video_scan_t *vs, uintptr_t *list)
+{
+        const uint32_t *fb = vs->fb_next;
+        const uint32_t *hud = vs->hud_next;
+        bool changed = false;
+
+        if (fb != vs->fb) {
+                vs->fb = fb;
+                for (unsigned int dy = 0; dy < (vs->fb_vres << vs->v_shift); dy++)
+                        list[(vs->fb_v_start + dy) * 4 + 3] =
+                                (uintptr_t)&fb[(dy >> vs->v_shift) * vs->wpl];
+                changed = true;
+        }
+        if (hud != vs->hud) {
+                vs->hud = hud;
+                for (unsigned int y = vs->hud_start; y < vs->hud_start + vs->hud_lines; y++)
+                        list[y * 4 + 3] = (uintptr_t)video_scan_line_addr(vs, y);
+                changed = true;
+        }
+        return changed;
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * pico-umac video timings
+ *
+ * Tables of output timings (VGA monitor, parallel RGB LCD panels), and
+ * generation of the per-line config words that pio_video/pio_lcd consume.
+ * This has no SDK dependencies, so can be checked on a host.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VIDEO_TIMING_H
+#define VIDEO_TIMING_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* Horizontal values are in pixel clocks, vertical in lines.  Each is the
+ * width of that region alone (i.e. HBP doesn't include HSW).
+ *
+ * The framebuffer is shown at an integer scale:  each FB pixel is output
+ * as a scale x scale block (PIO repeats pixels, and the DMA repeats lines).
+ */
+typedef struct {
+        const char      *name;
+        unsigned int    pclk_khz;
+        unsigned int    hsw, hbp, hres, hfp;
+        unsigned int    vsw, vbp, vres, vfp;
+        unsigned int    scale;
+} video_timing_t;
+
+/* Tables of VGA monitor modes, and of LCD panels, terminated by a NULL
+ * name:
+ */
+extern const video_timing_t video_vga_modes[];
+extern const video_timing_t video_lcd_panels[];
+
+static inline unsigned int      video_timing_h_total(const video_timing_t *t)
+{
+        return t->hsw + t->hbp + t->hres + t->hfp;
+}
+
+static inline unsigned int      video_timing_v_total(const video_timing_t *t)
+{
+        return t->vsw + t->vbp + t->vres + t->vfp;
+}
+
+/* Look up a table entry by name, or NULL if not found */
+const video_timing_t    *video_timing_find(const video_timing_t *table, const char *name);
+
+/* Checks a timing can be generated by pio_video (or pio_lcd, if lcd) with a
+ * framebuffer of fb_w x fb_h at bpp bits per pixel, scaled by t->scale, and
+ * clk_sys at sys_khz.  Returns NULL if OK, or a description of the problem.
+ * This is done before anything is output, so a bad mode never reaches the
+ * monitor.
+ */
+const char      *video_timing_check(const video_timing_t *t, unsigned int fb_w,
+                                    unsigned int fb_h, unsigned int bpp,
+                                    uint32_t sys_khz, bool lcd);
+
+/* Returns the PIO clock divider (16.8 fixed point, as the hardware) giving
+ * t's pixel clock (2 PIO cycles) from clk_sys, or 0 if it's not within 0.5%.
+ * A VGA monitor samples pixels with its own clock, so for VGA the pixel
+ * clock must be clk_sys divided by an integer:  a fractional PIO divider is
+ * then only ever .5, and pixel edges don't jitter.  LCDs are clocked by
+ * PCLK, so can have any divider.
+ */
+uint32_t        video_timing_clkdiv(const video_timing_t *t, uint32_t sys_khz, bool lcd);
+
+/* Where the framebuffer's first pixel is output:  x in pixel clocks from
+ * the start of HSync (nominally; see video_timing_line_pclks()), and y as
+ * a line of the frame, from the start of VSync.  The FB is centred in the
+ * active area, though for VGA it's moved left if HBP's field would
+ * overflow.
+ */
+unsigned int    video_timing_fb_x(const video_timing_t *t, unsigned int fb_w, bool lcd);
+unsigned int    video_timing_fb_y(const video_timing_t *t, unsigned int fb_h);
+
+/* Generate the 3 pairs of per-line config words:  for VSync lines, other
+ * blanking lines, and lines in the active area.  For VGA, the (scaled)
+ * framebuffer is positioned by extending the porches; for LCD, the active
+ * area lines assert DE, and the framebuffer must be the full width of the
+ * panel.  The pixel count is of FB pixels, before PIO repeats them.
+ */
+void    video_timing_cfg(const video_timing_t *t, unsigned int fb_w, bool lcd,
+                         uint32_t cfg[6]);
+
+/* Returns the length of a line, in pixel clocks, that the PIO program
+ * (loaded for the given scale) generates from a pair of config words.  This
+ * models the program's cycle counts, so must be kept in step with
+ * pio_video.pio!
+ */
+unsigned int    video_timing_line_pclks(const uint32_t cfg[2], unsigned int scale, bool lcd);
+
+#endif
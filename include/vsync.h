@@ -0,0 +1,50 @@
+/*
+ * pico-umac vsync event delivery
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VSYNC_H
+#define VSYNC_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* Tracks a frame counter published by the video output, and turns it into
+ * guest vsync events.  If the emulator falls behind by more than one frame,
+ * up to max_backlog missed frames are delivered late (one per poll); any
+ * beyond that are dropped and counted.
+ */
+typedef struct {
+        uint32_t        last_frame;
+        unsigned int    pending;
+        unsigned int    max_backlog;
+        uint32_t        delivered;
+        uint32_t        missed;
+} vsync_t;
+
+void    vsync_init(vsync_t *v, uint32_t frame_count, unsigned int max_backlog);
+/* Returns true if a vsync event should be delivered now */
+bool    vsync_poll(vsync_t *v, uint32_t frame_count);
+
+#endif
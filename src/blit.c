@@ -0,0 +1,167 @@
+/*
+ * pico-umac 1BPP rectangle kernels, for native QuickDraw traps
+ *
+ * Rows are worked on a byte at a time, so that the Mac's big-endian
+ * bitmaps need no byte-swapping:  the inside of a row is a memset() or
+ * memmove() (word-at-a-time), and only the ends are masked.  A copy
+ * between different bit alignments shifts through a staging buffer.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "blit.h"
+
+/* Bits [x & 7, 8) and [0, (x & 7) + 1) of a byte, from the left */
+#define LEFT_MASK(x)            (0xff >> ((x) & 7))
+#define RIGHT_MASK(x)           ((0xff00 >> (((x) & 7) + 1)) & 0xff)
+
+static inline void      merge(uint8_t *d, uint8_t v, uint8_t mask)
+{
+        *d = (*d & ~mask) | (v & mask);
+}
+
+void    __not_in_flash_func(blit_fill)(uint8_t *base, unsigned int row_bytes,
+                                       unsigned int x, unsigned int y,
+                                       unsigned int w, unsigned int h,
+                                       const uint8_t pat[8], unsigned int pat_y)
+{
+        if (w == 0)
+                return;
+
+        unsigned int first = x >> 3;
+        unsigned int last = (x + w - 1) >> 3;
+        uint8_t lmask = LEFT_MASK(x);
+        uint8_t rmask = RIGHT_MASK(x + w - 1);
+        uint8_t *row = base + y * row_bytes;
+
+        for (unsigned int i = 0; i < h; i++, row += row_bytes) {
+                uint8_t p = pat[(pat_y + i) & 7];
+
+                if (first == last) {
+                        merge(&row[first], p, lmask & rmask);
+                } else {
+                        merge(&row[first], p, lmask);
+                        memset(&row[first + 1], p, last - first - 1);
+                        merge(&row[last], p, rmask);
+                }
+        }
+}
+
+/* Bytes [first, last] of a row, from source bytes at the same alignment */
+static inline void      copy_row_aligned(uint8_t *d, const uint8_t *s, unsigned int first,
+                                         unsigned int last, uint8_t lmask, uint8_t rmask)
+{
+        if (first == last) {
+                merge(&d[first], s[0], lmask & rmask);
+        } else {
+                /* The ends are read before the middle's written, in case
+                 * they overlap it:
+                 */
+                uint8_t a = s[0];
+                uint8_t b = s[last - first];
+
+                memmove(&d[first + 1], &s[1], last - first - 1);
+                merge(&d[first], a, lmask);
+                merge(&d[last], b, rmask);
+        }
+}
+
+/* Bytes [first, last] of a row, from source bits r to the left of
+ * their place in the staging buffer (whose ends are zero-padded)
+ */
+static inline void      copy_row_shifted(uint8_t *d, const uint8_t *buf, unsigned int r,
+                                         unsigned int first, unsigned int last,
+                                         uint8_t lmask, uint8_t rmask)
+{
+        unsigned int n = last - first + 1;
+        uint8_t v;
+
+        if (n == 1) {
+                v = (buf[0] << r) | (buf[1] >> (8 - r));
+                merge(&d[first], v, lmask & rmask);
+                return;
+        }
+        merge(&d[first], (buf[0] << r) | (buf[1] >> (8 - r)), lmask);
+        for (unsigned int k = 1; k < n - 1; k++)
+                d[first + k] = (buf[k] << r) | (buf[k + 1] >> (8 - r));
+        merge(&d[last], (buf[n - 1] << r) | (buf[n] >> (8 - r)), rmask);
+}
+
+bool    __not_in_flash_func(blit_copy)(uint8_t *dst, unsigned int dst_row_bytes,
+                                       unsigned int dx, unsigned int dy,
+                                       const uint8_t *src, unsigned int src_row_bytes,
+                                       unsigned int sx, unsigned int sy,
+                                       unsigned int w, unsigned int h)
+{
+        static uint8_t buf[BLIT_MAX_ROW_BYTES + 2];
+
+        if (w == 0 || h == 0)
+                return true;
+
+        unsigned int first = dx >> 3;
+        unsigned int last = (dx + w - 1) >> 3;
+        unsigned int n = last - first + 1;
+        unsigned int s_first = sx >> 3;
+        unsigned int s_n = ((sx + w - 1) >> 3) - s_first + 1;
+        uint8_t lmask = LEFT_MASK(dx);
+        uint8_t rmask = RIGHT_MASK(dx + w - 1);
+        bool aligned = (dx & 7) == (sx & 7);
+
+        if (!aligned && n > BLIT_MAX_ROW_BYTES)
+                return false;
+
+        /* Bit t of the staging buffer is the destination's first byte's
+         * leftmost bit.  Its first byte is padding, so t's at least 1.
+         */
+        unsigned int t = (sx & 7) + 8 - (dx & 7);
+        const uint8_t *sbuf = &buf[t >> 3];
+        unsigned int r = t & 7;
+
+        /* Rows go bottom-up if the destination's after an overlapping source */
+        uint8_t *d = dst + dy * dst_row_bytes;
+        const uint8_t *s = src + sy * src_row_bytes + s_first;
+        int d_step = dst_row_bytes;
+        int s_step = src_row_bytes;
+
+        if (d + first > s) {
+                d += (h - 1) * dst_row_bytes;
+                s += (h - 1) * src_row_bytes;
+                d_step = -d_step;
+                s_step = -s_step;
+        }
+
+        for (unsigned int i = 0; i < h; i++, d += d_step, s += s_step) {
+                if (aligned) {
+                        copy_row_aligned(d, s, first, last, lmask, rmask);
+                } else {
+                        buf[0] = 0;
+                        memcpy(&buf[1], s, s_n);
+                        memset(&buf[1 + s_n], 0, n + 1 - s_n);
+                        copy_row_shifted(d, sbuf, r, first, last, lmask, rmask);
+                }
+        }
+        return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * pico-umac command console, on the stdio UART
+ *
+ * Characters are echoed, and a line is run as a command (with anything
+ * after the first space passed as its args).
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "console.h"
+
+#define CONSOLE_LINE_MAX        64
+
+static void     console_help(const console_cmd_t *cmds)
+{
+        printf("Commands:\n");
+        for (const console_cmd_t *c = cmds; c->name; c++)
+                printf("  %-10s %s\n", c->name, c->help);
+        printf("  %-10s %s\n", "help", "List commands");
+}
+
+static void     console_run(const console_cmd_t *cmds, char *line)
+{
+        char *args = strchr(line, ' ');
+
+        if (args)
+                *args++ = '\0';
+        else
+                args = "";
+        if (line[0] == '\0')
+                return;
+        for (const console_cmd_t *c = cmds; c->name; c++) {
+                if (strcmp(c->name, line) == 0) {
+                        c->fn(args);
+                        return;
+                }
+        }
+        if (strcmp(line, "help") != 0)
+                printf("Unknown command '%s'\n", line);
+        console_help(cmds);
+}
+
+void    console_poll(const console_cmd_t *cmds)
+{
+        static char line[CONSOLE_LINE_MAX];
+        static unsigned int len = 0;
+        static int last = 0;
+        int c;
+
+        while ((c = getchar_timeout_us(0)) >= 0) {
+                int prev = last;
+
+                last = c;
+                if (c == '\n' && prev == '\r')
+                        continue;       /* CRLF */
+                if (c == '\r' || c == '\n') {
+                        putchar('\n');
+                        line[len] = '\0';
+                        len = 0;
+                        console_run(cmds, line);
+                        printf("> ");
+                } else if ((c == '\b' || c == 0x7f) && len > 0) {
+                        len--;
+                        printf("\b \b");
+                } else if (c >= ' ' && c < 0x7f && len < CONSOLE_LINE_MAX - 1) {
+                        line[len++] = c;
+                        putchar(c);
+                }
+        }
+}
@@ -0,0 +1,100 @@
+/*
+ * pico-umac device request channel
+ *
+ * The emulation core hands work to device backends on core 0 (see
+ * main.c), and waits for the result where the guest needs it.  The guest
+ * sees exactly what it would if the emulation core had done the work
+ * itself, just sooner or later in real time.  Nothing here depends on
+ * which core, or thread, services the requests, or how quickly.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "devchan.h"
+
+#define DEVCHAN_MASK            (DEVCHAN_SIZE - 1)
+
+void    devchan_init(devchan_t *ch)
+{
+        *ch = (devchan_t){ 0 };
+}
+
+bool    devchan_send(devchan_t *ch, const devchan_req_t *req)
+{
+        uint32_t p = __atomic_load_n(&ch->req_prod, __ATOMIC_RELAXED);
+
+        /* Sent but not received back */
+        if (p - ch->resp_cons >= DEVCHAN_SIZE)
+                return false;
+        ch->req[p & DEVCHAN_MASK] = *req;
+        __atomic_store_n(&ch->req_prod, p + 1, __ATOMIC_RELEASE);
+        ch->calls++;
+        devchan_signal();
+        return true;
+}
+
+bool    devchan_receive(devchan_t *ch, devchan_resp_t *resp)
+{
+        uint32_t c = __atomic_load_n(&ch->resp_cons, __ATOMIC_RELAXED);
+
+        if (__atomic_load_n(&ch->resp_prod, __ATOMIC_ACQUIRE) == c)
+                return false;
+        *resp = ch->resp[c & DEVCHAN_MASK];
+        __atomic_store_n(&ch->resp_cons, c + 1, __ATOMIC_RELEASE);
+        return true;
+}
+
+int     devchan_call(devchan_t *ch, const devchan_req_t *req)
+{
+        devchan_resp_t resp;
+
+        while (!devchan_send(ch, req))
+                devchan_wait();
+        if (!devchan_receive(ch, &resp)) {
+                ch->waits++;
+                do {
+                        devchan_wait();
+                } while (!devchan_receive(ch, &resp));
+        }
+        return resp.result;
+}
+
+bool    devchan_take(devchan_t *ch, devchan_req_t *req)
+{
+        uint32_t c = __atomic_load_n(&ch->req_cons, __ATOMIC_RELAXED);
+
+        if (__atomic_load_n(&ch->req_prod, __ATOMIC_ACQUIRE) == c)
+                return false;
+        *req = ch->req[c & DEVCHAN_MASK];
+        __atomic_store_n(&ch->req_cons, c + 1, __ATOMIC_RELEASE);
+        return true;
+}
+
+void    devchan_reply(devchan_t *ch, const devchan_resp_t *resp)
+{
+        uint32_t p = __atomic_load_n(&ch->resp_prod, __ATOMIC_RELAXED);
+
+        ch->resp[p & DEVCHAN_MASK] = *resp;
+        __atomic_store_n(&ch->resp_prod, p + 1, __ATOMIC_RELEASE);
+        devchan_signal();
+}
@@ -0,0 +1,214 @@
+/*
+ * pico-umac block-compressed disc image
+ *
+ * A disc_descr_t backend for an image packed by tools/discpack:  reads
+ * find the blocks they cover, and decompress them into a small LRU cache
+ * in SRAM.  Reads of a whole block skip the cache, and zero and stored
+ * blocks are read straight from the image.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "discz.h"
+
+#define LZ4_MINMATCH            4
+
+static uint32_t get32(const uint8_t *p)
+{
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t block_off(const discz_t *z, uint32_t b)
+{
+        return get32(z->image + DISCZ_HDR_SIZE + b * 4);
+}
+
+static uint32_t block_len(const discz_t *z, uint32_t b)
+{
+        uint32_t left = z->size - b * z->block_size;
+
+        return left < z->block_size ? left : z->block_size;
+}
+
+/* An LZ4 length's extra bytes:  each 255 means more follow */
+static int      get_len(const uint8_t **ip, const uint8_t *iend, unsigned int *len)
+{
+        unsigned int b;
+
+        do {
+                if (*ip >= iend)
+                        return -1;
+                b = *(*ip)++;
+                *len += b;
+        } while (b == 255);
+        return 0;
+}
+
+int     __not_in_flash_func(discz_decompress)(const uint8_t *in, unsigned int in_len,
+                                              uint8_t *out, unsigned int out_len)
+{
+        const uint8_t *ip = in, *iend = in + in_len;
+        uint8_t *op = out, *oend = out + out_len;
+
+        while (ip < iend) {
+                unsigned int token = *ip++;
+                unsigned int len = token >> 4;
+
+                /* Literals... */
+                if (len == 15 && get_len(&ip, iend, &len) < 0)
+                        return -1;
+                if (len > (unsigned int)(iend - ip) || len > (unsigned int)(oend - op))
+                        return -1;
+                memcpy(op, ip, len);
+                op += len;
+                ip += len;
+                /* ...then a match, except in the last sequence */
+                if (ip == iend)
+                        break;
+                if (iend - ip < 2)
+                        return -1;
+                unsigned int off = ip[0] | (ip[1] << 8);
+                ip += 2;
+                len = token & 15;
+                if (len == 15 && get_len(&ip, iend, &len) < 0)
+                        return -1;
+                len += LZ4_MINMATCH;
+                if (off == 0 || off > (unsigned int)(op - out) || len > (unsigned int)(oend - op))
+                        return -1;
+                const uint8_t *m = op - off;
+                if (off >= len) {
+                        memcpy(op, m, len);
+                        op += len;
+                } else {
+                        /* Overlapping, i.e. a repeating pattern */
+                        while (len--)
+                                *op++ = *m++;
+                }
+        }
+        return op == oend ? 0 : -1;
+}
+
+int     discz_open(discz_t *z, const uint8_t *image, unsigned int image_len,
+                   uint8_t *cache, unsigned int cache_size)
+{
+        *z = (discz_t){ 0 };
+        if (image_len < DISCZ_HDR_SIZE + 4 || memcmp(image, DISCZ_MAGIC, 4) != 0)
+                return -1;
+        z->image = image;
+        z->size = get32(image + 4);
+        z->block_size = get32(image + 8);
+        z->blocks = get32(image + 12);
+        if (z->block_size < DISCZ_MIN_BLOCK || z->block_size > DISCZ_MAX_BLOCK ||
+            (z->block_size & (z->block_size - 1)) ||
+            z->blocks != (z->size + z->block_size - 1) / z->block_size ||
+            z->blocks > (image_len - DISCZ_HDR_SIZE) / 4 - 1)
+                return -1;
+
+        /* Each block's data must be in the image, and no longer than it */
+        uint32_t data = DISCZ_HDR_SIZE + (z->blocks + 1) * 4;
+        if (block_off(z, 0) != data || block_off(z, z->blocks) > image_len)
+                return -1;
+        for (uint32_t b = 0; b < z->blocks; b++) {
+                uint32_t start = block_off(z, b), end = block_off(z, b + 1);
+                if (end < start || end - start > block_len(z, b))
+                        return -1;
+        }
+
+        z->cache = cache;
+        z->slots = cache_size / z->block_size;
+        if (z->slots > DISCZ_MAX_SLOTS)
+                z->slots = DISCZ_MAX_SLOTS;
+        if (!z->slots)
+                return -1;
+        for (unsigned int i = 0; i < z->slots; i++)
+                z->slot_block[i] = -1;
+        return 0;
+}
+
+/* Decompress block b (compressed, of clen bytes) into the cache */
+static const uint8_t    *discz_cached(discz_t *z, uint32_t b, uint32_t clen)
+{
+        unsigned int lru = 0;
+
+        for (unsigned int i = 0; i < z->slots; i++) {
+                if (z->slot_block[i] == (int32_t)b) {
+                        z->slot_used[i] = ++z->clock;
+                        z->hits++;
+                        return z->cache + i * z->block_size;
+                }
+                if (z->slot_used[i] < z->slot_used[lru])
+                        lru = i;
+        }
+
+        uint8_t *p = z->cache + lru * z->block_size;
+        z->slot_block[lru] = -1;
+        if (discz_decompress(z->image + block_off(z, b), clen, p, block_len(z, b)) < 0)
+                return NULL;
+        z->slot_block[lru] = b;
+        z->slot_used[lru] = ++z->clock;
+        z->misses++;
+        return p;
+}
+
+int     discz_read(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        discz_t *z = (discz_t *)ctx;
+
+        if (offset > z->size || len > z->size - offset)
+                return -1;
+
+        while (len) {
+                uint32_t b = offset / z->block_size;
+                uint32_t o = offset - b * z->block_size;
+                uint32_t blen = block_len(z, b);
+                uint32_t n = len < blen - o ? len : blen - o;
+                uint32_t start = block_off(z, b);
+                uint32_t clen = block_off(z, b + 1) - start;
+
+                if (clen == 0) {
+                        memset(data, 0, n);
+                } else if (clen == blen) {
+                        memcpy(data, z->image + start + o, n);
+                } else if (n == blen) {
+                        if (discz_decompress(z->image + start, clen, data, blen) < 0)
+                                goto bad;
+                        z->direct++;
+                } else {
+                        const uint8_t *p = discz_cached(z, b, clen);
+                        if (!p)
+                                goto bad;
+                        memcpy(data, p + o, n);
+                }
+                data += n;
+                offset += n;
+                len -= n;
+        }
+        return 0;
+
+bad:
+        z->errors++;
+        return -1;
+}
@@ -0,0 +1,129 @@
+/*
+ * pico-umac emulation scheduler
+ *
+ * umac_loop() runs a fixed quantum of 68K cycles.  The main loop runs a
+ * batch of quanta between polls of everything else; the batch doubles
+ * while it takes under half of SCHED_SLICE_US and halves when it takes
+ * longer, so polling overhead stays low without delaying vsync or input.
+ *
+ * In real-time mode, emulated time (cycles at SCHED_CLOCK_HZ) is paced
+ * against the wall clock:  nothing is run while the emulation is ahead,
+ * and when behind, enough quanta (up to a batch) are run to catch up.
+ * Each frame's slack, or lag if the emulation couldn't keep up, is kept
+ * for reporting.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "emu_sched.h"
+
+static int64_t  sched_lag_us(sched_t *s, uint64_t now_us)
+{
+        return (int64_t)(now_us - s->base_us) - (int64_t)s->emu_us;
+}
+
+void    sched_init(sched_t *s, sched_mode_t mode, unsigned int quantum, uint64_t now_us)
+{
+        s->mode = mode;
+        s->quantum = quantum;
+        s->batch = 1;
+        s->base_us = now_us;
+        s->emu_us = 0;
+        s->emu_rem = 0;
+        s->batch_start_us = now_us;
+        s->frame_start_us = now_us;
+        s->frame_busy_us = 0;
+        s->slack_us = 0;
+        s->frames = 0;
+        s->overruns = 0;
+        s->lost_us = 0;
+}
+
+void    sched_set_mode(sched_t *s, sched_mode_t mode, uint64_t now_us)
+{
+        /* Real time restarts from now, rather than trying to catch up (or
+         * waiting for) what turbo did:
+         */
+        if (mode == SCHED_REALTIME && s->mode != SCHED_REALTIME)
+                s->base_us = now_us - s->emu_us;
+        s->mode = mode;
+}
+
+unsigned int    sched_batch(sched_t *s, uint64_t now_us)
+{
+        unsigned int n = s->batch;
+
+        s->batch_start_us = now_us;
+        if (s->mode == SCHED_REALTIME) {
+                int64_t lag = sched_lag_us(s, now_us);
+
+                if (lag < 0)
+                        return 0;
+                if (lag > SCHED_MAX_LAG_US) {
+                        s->lost_us += lag - SCHED_MAX_LAG_US;
+                        s->base_us += lag - SCHED_MAX_LAG_US;
+                        lag = SCHED_MAX_LAG_US;
+                }
+                /* Enough to pass real time, i.e. at most a quantum ahead: */
+                unsigned int q = (uint64_t)lag * SCHED_CLOCK_HZ / 1000000 / s->quantum + 1;
+                if (q < n)
+                        n = q;
+        }
+        return n;
+}
+
+void    sched_done(sched_t *s, unsigned int quanta, uint64_t now_us)
+{
+        uint32_t us = now_us - s->batch_start_us;
+
+        s->frame_busy_us += us;
+
+        s->emu_rem += (uint64_t)quanta * s->quantum * 1000000;
+        uint64_t emu_us = s->emu_rem / SCHED_CLOCK_HZ;
+        s->emu_us += emu_us;
+        s->emu_rem -= emu_us * SCHED_CLOCK_HZ;
+
+        /* Adapt from full batches only; a short catch-up says nothing */
+        if (quanta == s->batch && us < SCHED_SLICE_US/2 && s->batch < SCHED_MAX_BATCH)
+                s->batch *= 2;
+        else if (us > SCHED_SLICE_US && s->batch > 1)
+                s->batch /= 2;
+}
+
+void    sched_frame(sched_t *s, uint64_t now_us)
+{
+        uint32_t frame_us = now_us - s->frame_start_us;
+        int64_t lag = sched_lag_us(s, now_us);
+        /* Up to a quantum behind is just waiting for the next to start: */
+        int64_t quantum_us = (uint64_t)s->quantum * 1000000 / SCHED_CLOCK_HZ;
+
+        if (s->mode == SCHED_REALTIME && lag > quantum_us) {
+                s->slack_us = -(int32_t)lag;
+                s->overruns++;
+        } else {
+                s->slack_us = (frame_us > s->frame_busy_us) ? frame_us - s->frame_busy_us : 0;
+        }
+        s->frames++;
+        s->frame_start_us = now_us;
+        s->frame_busy_us = 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * pico-umac framebuffer capture
+ *
+ * Encodes the framebuffer's changed rows as a stream of packets (see
+ * fbcap.h), for watching a unit's screen over a serial link.  Rows are
+ * hashed to find changes, so only the hashes are kept rather than a copy of
+ * the framebuffer.  This has no SDK dependencies; the caller sends the
+ * buffer and accounts for time.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "fbcap.h"
+
+#define PKT_HDR         5
+#define PKT_CRC         2
+#define PKT_ROW_MAX     (PKT_HDR + 2 + FBCAP_MAX_ROW_BYTES + (FBCAP_MAX_ROW_BYTES + 127)/128 + PKT_CRC)
+#define PKT_END_LEN     (PKT_HDR + 22 + PKT_CRC)
+
+uint16_t        fbcap_crc16(uint16_t crc, const uint8_t *data, unsigned int len)
+{
+        while (len--) {
+                crc ^= (uint16_t)*data++ << 8;
+                for (int i = 0; i < 8; i++)
+                        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+        return crc;
+}
+
+unsigned int    fbcap_packbits(const uint8_t *in, unsigned int len, uint8_t *out)
+{
+        uint8_t *o = out;
+        unsigned int i = 0;
+
+        while (i < len) {
+                unsigned int run = 1;
+
+                while (i + run < len && run < 128 && in[i + run] == in[i])
+                        run++;
+                /* A pair costs as much as a run as it does in literals,
+                 * but breaks them up (one more header), so only runs of 3+
+                 * are runs.  Then the worst case is len + ceil(len/128).
+                 */
+                if (run >= 3) {
+                        *o++ = 257 - run;
+                        *o++ = in[i];
+                        i += run;
+                } else {
+                        /* Literals, up to the start of the next run: */
+                        unsigned int start = i;
+
+                        do {
+                                i++;
+                        } while (i < len && i - start < 128 &&
+                                 !(i + 2 < len && in[i] == in[i + 1] && in[i] == in[i + 2]));
+                        *o++ = i - start - 1;
+                        memcpy(o, &in[start], i - start);
+                        o += i - start;
+                }
+        }
+        return o - out;
+}
+
+static uint32_t hash_row(const uint8_t *row, unsigned int len)
+{
+        /* FNV-1a */
+        uint32_t h = 0x811c9dc5;
+
+        while (len--)
+                h = (h ^ *row++) * 0x01000193;
+        return h;
+}
+
+static uint8_t  *put16(uint8_t *p, uint32_t v)
+{
+        *p++ = v;
+        *p++ = v >> 8;
+        return p;
+}
+
+static uint8_t  *put32(uint8_t *p, uint32_t v)
+{
+        return put16(put16(p, v), v >> 16);
+}
+
+/* Packets are built in place:  start, write the payload, then finish */
+static uint8_t  *pkt_start(fbcap_t *f, uint8_t type)
+{
+        uint8_t *p = &f->buf[f->len];
+
+        p[0] = FBCAP_SYNC0;
+        p[1] = FBCAP_SYNC1;
+        p[2] = type;
+        return p + PKT_HDR;
+}
+
+static void     pkt_finish(fbcap_t *f, uint8_t *end)
+{
+        uint8_t *p = &f->buf[f->len];
+        unsigned int plen = end - (p + PKT_HDR);
+
+        put16(&p[3], plen);
+        put16(end, fbcap_crc16(0xffff, &p[2], plen + 3));
+        f->len += PKT_HDR + plen + PKT_CRC;
+}
+
+void            fbcap_init(fbcap_t *f, unsigned int width, unsigned int height)
+{
+        memset(f, 0, sizeof(*f));
+        f->width = width;
+        f->height = height;
+        f->stride = width / 8;
+}
+
+unsigned int    fbcap_capture(fbcap_t *f, const uint8_t *fb, uint32_t busy_us)
+{
+        uint8_t row[FBCAP_MAX_ROW_BYTES];
+        unsigned int rows = 0, pending = 0;
+        unsigned int next_start = f->start_row;
+        bool key = (f->key_countdown == 0);
+        uint8_t *p;
+
+        if (key) {
+                memset(f->force, 0xff, sizeof(f->force));
+                f->key_countdown = FBCAP_KEY_INTERVAL;
+        }
+        f->key_countdown--;
+        f->captures++;
+        f->len = 0;
+
+        p = pkt_start(f, FBCAP_PKT_FRAME);
+        p = put32(p, f->seq);
+        p = put16(p, f->width);
+        p = put16(p, f->height);
+        *p++ = key ? FBCAP_FLAG_KEY : 0;
+        pkt_finish(f, p);
+
+        /* Start where the last partial update stopped, so rows at the bottom
+         * aren't starved:
+         */
+        for (unsigned int i = 0; i < f->height; i++) {
+                unsigned int r = (f->start_row + i) % f->height;
+                uint32_t bit = 1u << (r & 31);
+
+                /* Work on a snapshot, so the hash matches what's sent even if
+                 * the guest is drawing:
+                 */
+                memcpy(row, &fb[r * f->stride], f->stride);
+                uint32_t h = hash_row(row, f->stride);
+                if (h == f->hashes[r] && !(f->force[r / 32] & bit))
+                        continue;
+
+                if (f->len + PKT_ROW_MAX + PKT_END_LEN > FBCAP_BUF_SIZE) {
+                        if (pending++ == 0)
+                                next_start = r;
+                        continue;
+                }
+                p = pkt_start(f, FBCAP_PKT_ROW);
+                p = put16(p, r);
+                p += fbcap_packbits(row, f->stride, p);
+                pkt_finish(f, p);
+                f->hashes[r] = h;
+                f->force[r / 32] &= ~bit;
+                rows++;
+        }
+        f->start_row = next_start;
+
+        if (rows == 0) {
+                /* Nothing to say */
+                f->len = 0;
+                return 0;
+        }
+
+        f->rows_sent += rows;
+        f->bytes += f->len + PKT_END_LEN;
+
+        p = pkt_start(f, FBCAP_PKT_END);
+        p = put32(p, f->seq++);
+        p = put16(p, rows);
+        p = put16(p, pending);
+        p = put32(p, f->bytes);
+        p = put32(p, f->captures);
+        p = put32(p, busy_us);
+        pkt_finish(f, p);
+        return f->len;
+}
@@ -27,7 +27,11 @@
 #include "bsp/rp2040/board.h"
 #include "tusb.h"
 
+#include "pico/time.h"
+
 #include "kbd.h"
+#include "input.h"
+#include "pointer.h"
 
 //--------------------------------------------------------------------+
 // MACRO TYPEDEF CONSTANT ENUM DECLARATION
@@ -54,7 +58,8 @@ static void process_generic_report(uint8_t dev_addr, uint8_t instance, uint8_t c
 
 void hid_app_task(void)
 {
-        // nothing to do
+        /* Send any motion that was waiting for room */
+        input_flush(&input_events);
 }
 
 //--------------------------------------------------------------------+
@@ -197,11 +202,7 @@ static void process_kbd_report(hid_keyboard_report_t const *report)
 // Mouse
 //--------------------------------------------------------------------+
 
-/* Exported for use by other thread! */
-int cursor_x = 0;
-int cursor_y = 0;
-int cursor_button = 0;
-
+#if !USE_ABS_MOUSE
 #define MAX_DELTA       8
 
 static int clamp(int i)
@@ -209,16 +210,32 @@ static int clamp(int i)
         return (i >= 0) ? (i > MAX_DELTA ? MAX_DELTA : i) :
                 (i < -MAX_DELTA ? -MAX_DELTA : i);
 }
+#endif
 
 static void process_mouse_report(hid_mouse_report_t const * report)
 {
-        static hid_mouse_report_t prev_report = { 0 };
-        uint8_t button_changed_mask = report->buttons ^ prev_report.buttons;
-        /* report->wheel can be used too... */
-
-        cursor_button = !!(report->buttons & MOUSE_BUTTON_LEFT);
-        cursor_x += clamp(report->x);
-        cursor_y += clamp(report->y);
+        uint32_t now = time_us_32();
+
+#if USE_ABS_MOUSE
+        /* The mouse is tracked here, unclamped, and sent as absolute positions */
+        static int x = DISP_WIDTH / 2;
+        static int y = DISP_HEIGHT / 2;
+        int nx = x + report->x;
+        int ny = y + report->y;
+
+        nx = (nx < 0) ? 0 : (nx >= DISP_WIDTH ? DISP_WIDTH - 1 : nx);
+        ny = (ny < 0) ? 0 : (ny >= DISP_HEIGHT ? DISP_HEIGHT - 1 : ny);
+        if (nx != x || ny != y) {
+                x = nx;
+                y = ny;
+                input_pointer(&input_events, pointer_unmap(x, DISP_WIDTH),
+                              pointer_unmap(y, DISP_HEIGHT), now);
+        }
+#else
+        input_motion(&input_events, clamp(report->x), clamp(report->y), now);
+#endif
+        input_wheel(&input_events, report->wheel, now);
+        input_button(&input_events, 0, !!(report->buttons & MOUSE_BUTTON_LEFT), now);
 }
 
 //--------------------------------------------------------------------+
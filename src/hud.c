@@ -0,0 +1,115 @@
+/*
+ * pico-umac performance HUD text rendering
+ *
+ * This rasterises a line of text into 1BPP framebuffer-format lines, for a
+ * status strip displayed outside of the Mac's screen.  It has no SDK
+ * dependencies, so can also be built on a host.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include "hud.h"
+
+#define HUD_FONT_FIRST  0x20
+#define HUD_FONT_LAST   0x5f
+
+/* 5x7 glyphs in bits [6:2] of each row, so there's a one pixel gap on the
+ * left and two on the right.  Undefined characters are blank.
+ */
+static const uint8_t hud_font[HUD_FONT_LAST - HUD_FONT_FIRST + 1][7] = {
+        [' ' - HUD_FONT_FIRST] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        ['%' - HUD_FONT_FIRST] = { 0x60, 0x64, 0x08, 0x10, 0x20, 0x4c, 0x0c },
+        ['(' - HUD_FONT_FIRST] = { 0x08, 0x10, 0x20, 0x20, 0x20, 0x10, 0x08 },
+        [')' - HUD_FONT_FIRST] = { 0x20, 0x10, 0x08, 0x08, 0x08, 0x10, 0x20 },
+        ['-' - HUD_FONT_FIRST] = { 0x00, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x00 },
+        ['.' - HUD_FONT_FIRST] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30 },
+        ['/' - HUD_FONT_FIRST] = { 0x00, 0x04, 0x08, 0x10, 0x20, 0x40, 0x00 },
+        ['0' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x4c, 0x54, 0x64, 0x44, 0x38 },
+        ['1' - HUD_FONT_FIRST] = { 0x10, 0x30, 0x10, 0x10, 0x10, 0x10, 0x38 },
+        ['2' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x04, 0x08, 0x10, 0x20, 0x7c },
+        ['3' - HUD_FONT_FIRST] = { 0x7c, 0x08, 0x10, 0x08, 0x04, 0x44, 0x38 },
+        ['4' - HUD_FONT_FIRST] = { 0x08, 0x18, 0x28, 0x48, 0x7c, 0x08, 0x08 },
+        ['5' - HUD_FONT_FIRST] = { 0x7c, 0x40, 0x78, 0x04, 0x04, 0x44, 0x38 },
+        ['6' - HUD_FONT_FIRST] = { 0x18, 0x20, 0x40, 0x78, 0x44, 0x44, 0x38 },
+        ['7' - HUD_FONT_FIRST] = { 0x7c, 0x04, 0x08, 0x10, 0x20, 0x20, 0x20 },
+        ['8' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x44, 0x38, 0x44, 0x44, 0x38 },
+        ['9' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x44, 0x3c, 0x04, 0x08, 0x30 },
+        [':' - HUD_FONT_FIRST] = { 0x00, 0x30, 0x30, 0x00, 0x30, 0x30, 0x00 },
+        ['A' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x44, 0x7c, 0x44, 0x44, 0x44 },
+        ['B' - HUD_FONT_FIRST] = { 0x78, 0x44, 0x44, 0x78, 0x44, 0x44, 0x78 },
+        ['C' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x40, 0x40, 0x40, 0x44, 0x38 },
+        ['D' - HUD_FONT_FIRST] = { 0x70, 0x48, 0x44, 0x44, 0x44, 0x48, 0x70 },
+        ['E' - HUD_FONT_FIRST] = { 0x7c, 0x40, 0x40, 0x78, 0x40, 0x40, 0x7c },
+        ['F' - HUD_FONT_FIRST] = { 0x7c, 0x40, 0x40, 0x78, 0x40, 0x40, 0x40 },
+        ['G' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x40, 0x5c, 0x44, 0x44, 0x3c },
+        ['H' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x44, 0x7c, 0x44, 0x44, 0x44 },
+        ['I' - HUD_FONT_FIRST] = { 0x38, 0x10, 0x10, 0x10, 0x10, 0x10, 0x38 },
+        ['J' - HUD_FONT_FIRST] = { 0x1c, 0x08, 0x08, 0x08, 0x08, 0x48, 0x30 },
+        ['K' - HUD_FONT_FIRST] = { 0x44, 0x48, 0x50, 0x60, 0x50, 0x48, 0x44 },
+        ['L' - HUD_FONT_FIRST] = { 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7c },
+        ['M' - HUD_FONT_FIRST] = { 0x44, 0x6c, 0x54, 0x54, 0x44, 0x44, 0x44 },
+        ['N' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x64, 0x54, 0x4c, 0x44, 0x44 },
+        ['O' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38 },
+        ['P' - HUD_FONT_FIRST] = { 0x78, 0x44, 0x44, 0x78, 0x40, 0x40, 0x40 },
+        ['Q' - HUD_FONT_FIRST] = { 0x38, 0x44, 0x44, 0x44, 0x54, 0x48, 0x34 },
+        ['R' - HUD_FONT_FIRST] = { 0x78, 0x44, 0x44, 0x78, 0x50, 0x48, 0x44 },
+        ['S' - HUD_FONT_FIRST] = { 0x3c, 0x40, 0x40, 0x38, 0x04, 0x04, 0x78 },
+        ['T' - HUD_FONT_FIRST] = { 0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 },
+        ['U' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38 },
+        ['V' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x44, 0x44, 0x44, 0x28, 0x10 },
+        ['W' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x44, 0x54, 0x54, 0x54, 0x28 },
+        ['X' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x28, 0x10, 0x28, 0x44, 0x44 },
+        ['Y' - HUD_FONT_FIRST] = { 0x44, 0x44, 0x28, 0x10, 0x10, 0x10, 0x10 },
+        ['Z' - HUD_FONT_FIRST] = { 0x7c, 0x04, 0x08, 0x10, 0x20, 0x40, 0x7c },
+};
+
+void    hud_render_row(const char *text, unsigned int row, uint32_t *out, unsigned int wpl)
+{
+        uint8_t *p = (uint8_t *)out;
+        unsigned int len = wpl * 4;
+
+        /* Black background */
+        memset(p, 0xff, len);
+        if (row >= 7)
+                return;
+
+        for (unsigned int i = 0; i < len && text[i]; i++) {
+                unsigned char c = text[i];
+
+                if (c >= 'a' && c <= 'z')
+                        c -= 'a' - 'A';
+                if (c < HUD_FONT_FIRST || c > HUD_FONT_LAST)
+                        continue;
+                p[i] = ~hud_font[c - HUD_FONT_FIRST][row];
+        }
+}
+
+void    hud_render(const char *text, uint32_t *strip, unsigned int wpl)
+{
+        /* Blank first and last lines, with the text between: */
+        memset(strip, 0xff, wpl * 4);
+        for (unsigned int r = 0; r < HUD_FONT_H; r++)
+                hud_render_row(text, r, &strip[(r + 1) * wpl], wpl);
+        memset(&strip[(HUD_LINES - 1) * wpl], 0xff, wpl * 4);
+}
@@ -0,0 +1,124 @@
+/*
+ * pico-umac guest idle detection
+ *
+ * A call to GetNextEvent or WaitNextEvent is spotted before it's made.  The
+ * result of the previous call is still in its event record then, so a run
+ * of null events (with little done between them) can be seen without
+ * catching the trap's return.  Once the guest's idle, the quantum's ended
+ * at each call:  it still runs SystemTask, the caret blink and so on once
+ * per quantum, and anything it's woken for (an interrupt, or input) is
+ * taken at the start of the next.  The main loop sleeps when a batch ends
+ * idle.  tools/idletest checks that the guest sees time pass just as it
+ * does without this.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "m68k.h"
+#include "idle.h"
+
+volatile bool idle_enabled = false;
+idle_stats_t idle_stats;
+
+const uint8_t *idle_ram;
+uint32_t idle_ram_size;
+const uint8_t *idle_rom;
+uint32_t idle_rom_size;
+uint32_t idle_ret = IDLE_NO_RET;
+uint32_t idle_insns;
+bool idle_hit;
+
+/* The last call's event record, and how many nulls in a row */
+static uint32_t idle_ev = 0;
+static unsigned int idle_run = 0;
+
+static uint16_t rd16(uint32_t a)
+{
+        return (idle_ram[a] << 8) | idle_ram[a + 1];
+}
+
+static uint32_t rd32(uint32_t a)
+{
+        return ((uint32_t)rd16(a) << 16) | rd16(a + 2);
+}
+
+static bool     ram_ok(uint32_t a, uint32_t len)
+{
+        return a < idle_ram_size && len <= idle_ram_size - a;
+}
+
+void    idle_init(const uint8_t *ram, uint32_t ram_size, const uint8_t *rom, uint32_t rom_size)
+{
+        idle_ram = ram;
+        idle_ram_size = ram_size;
+        idle_rom = rom;
+        idle_rom_size = rom_size;
+        idle_enabled = true;
+}
+
+void    idle_call(uint32_t pc, uint16_t op)
+{
+        uint16_t trap = op & ~TRAP_AUTOPOP;
+        uint32_t sp = m68k_get_reg(NULL, M68K_REG_A7) & 0xffffff;
+        uint32_t ret = pc + 2;
+
+        if (trap != TRAP_GETNEXTEVENT && trap != TRAP_WAITNEXTEVENT)
+                return;
+        if (!ram_ok(sp, 16))
+                return;
+        /* With auto-pop, the trap returns to its glue's caller */
+        if (op & TRAP_AUTOPOP) {
+                ret = rd32(sp);
+                sp += 4;
+        }
+        idle_stats.calls++;
+
+        /* GetNextEvent(mask, VAR theEvent) has the event record on top of
+         * the stack, and WaitNextEvent(mask, VAR theEvent, sleep, mouseRgn)
+         * under two longs.  Its what field is 0 for a null event:
+         */
+        if (idle_ev && rd16(idle_ev) == 0 && idle_insns <= IDLE_SPIN_INSNS) {
+                idle_stats.nulls++;
+                idle_run++;
+        } else {
+                idle_run = 0;
+        }
+        idle_ev = rd32(sp + (trap == TRAP_WAITNEXTEVENT ? 8 : 0)) & 0xffffff;
+        if (!ram_ok(idle_ev, 2))
+                idle_ev = 0;
+        idle_ret = ret & 0xffffff;
+        idle_insns = 0;
+
+        if (idle_run >= IDLE_NULL_EVENTS) {
+                /* The call's made in this quantum, then it ends */
+                m68k_end_timeslice();
+                idle_hit = true;
+        }
+}
+
+void    idle_wake(void)
+{
+        idle_run = 0;
+}
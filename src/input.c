@@ -0,0 +1,222 @@
+/*
+ * pico-umac input events
+ *
+ * USB HID is handled on core 0, and umac runs on core 1.  Events cross in
+ * a lock-free ring:  the producer fills a slot then publishes it by
+ * storing prod (release); the consumer sees prod (acquire) before reading
+ * the slot, and frees it by storing cons (release) after.  On the RP2040
+ * these are plain word accesses plus DMBs.
+ *
+ * Back-pressure:  when the consumer falls behind (or a macro keyboard
+ * sends a burst), the ring mustn't lose a release, or the guest sees a
+ * stuck key.  So the producer tracks what the guest will see as held, and
+ * only accepts a press if there'd still be a slot free for every held
+ * key's release afterwards; other events leave that many free.  A refused
+ * press is counted, and its release skipped.  Motion and wheel deltas
+ * that don't fit are summed, and a pointer position replaced, until
+ * there's room; they're flushed before any edge, so a click happens where
+ * the pointer was (unless the ring is so full that only the reserve is
+ * left, in which case the release goes first).
+ *
+ * This has no SDK dependencies, so can be tested on a host (see
+ * tools/inputstress).
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "input.h"
+
+#define INPUT_RING_MASK         (INPUT_RING_SIZE - 1)
+
+input_ring_t input_events;
+
+void    input_init(input_ring_t *r)
+{
+        *r = (input_ring_t){ 0 };
+}
+
+/* Push, if that leaves at least keep slots free */
+static bool     input_push_keep(input_ring_t *r, const input_event_t *e, unsigned int keep)
+{
+        uint32_t p = __atomic_load_n(&r->prod, __ATOMIC_RELAXED);
+        uint32_t c = __atomic_load_n(&r->cons, __ATOMIC_ACQUIRE);
+        uint32_t used = p - c;
+
+        if (INPUT_RING_SIZE - used < keep + 1)
+                return false;
+        r->ev[p & INPUT_RING_MASK] = *e;
+        __atomic_store_n(&r->prod, p + 1, __ATOMIC_RELEASE);
+        if (used + 1 > r->max_used)
+                r->max_used = used + 1;
+        return true;
+}
+
+bool    input_push(input_ring_t *r, const input_event_t *e)
+{
+        return input_push_keep(r, e, 0);
+}
+
+bool    input_pop(input_ring_t *r, input_event_t *e)
+{
+        uint32_t c = __atomic_load_n(&r->cons, __ATOMIC_RELAXED);
+        uint32_t p = __atomic_load_n(&r->prod, __ATOMIC_ACQUIRE);
+
+        if (p == c)
+                return false;
+        *e = r->ev[c & INPUT_RING_MASK];
+        __atomic_store_n(&r->cons, c + 1, __ATOMIC_RELEASE);
+        return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Producer policy
+
+static int      clamp16(int v)
+{
+        return (v > INT16_MAX) ? INT16_MAX : (v < -INT16_MAX ? -INT16_MAX : v);
+}
+
+static bool     input_pend_empty(input_ring_t *r)
+{
+        return !r->pend_pointer && !r->pend_dx && !r->pend_dy && !r->pend_wheel;
+}
+
+/* Note a new merged event; unsent if there's one of its kind pending */
+static void     input_pend(input_ring_t *r, bool unsent, uint32_t time_us)
+{
+        if (input_pend_empty(r))
+                r->pend_time_us = time_us;
+        if (unsent)
+                r->coalesced++;
+}
+
+void    input_flush(input_ring_t *r)
+{
+        input_event_t e = { .time_us = r->pend_time_us };
+
+        if (r->pend_pointer) {
+                e.type = INPUT_POINTER;
+                e.dx = r->pend_x;
+                e.dy = r->pend_y;
+                if (input_push_keep(r, &e, r->held))
+                        r->pend_pointer = false;
+        }
+        /* Big deltas go in pieces */
+        while (r->pend_dx || r->pend_dy) {
+                e.type = INPUT_MOUSE;
+                e.dx = clamp16(r->pend_dx);
+                e.dy = clamp16(r->pend_dy);
+                if (!input_push_keep(r, &e, r->held))
+                        break;
+                r->pend_dx -= e.dx;
+                r->pend_dy -= e.dy;
+        }
+        while (r->pend_wheel) {
+                e.type = INPUT_WHEEL;
+                e.dx = 0;
+                e.dy = clamp16(r->pend_wheel);
+                if (!input_push_keep(r, &e, r->held))
+                        break;
+                r->pend_wheel -= e.dy;
+        }
+}
+
+static bool     input_edge(input_ring_t *r, uint8_t type, uint8_t key, bool down,
+                           bool was_down, uint32_t time_us)
+{
+        input_event_t e = { .time_us = time_us, .type = type, .down = down, .key = key };
+
+        if (down == was_down)
+                return true;    /* Repeat, or release of a refused press */
+
+        input_flush(r);
+        if (down) {
+                /* Leave room for this key's release, and the others' */
+                if (!input_push_keep(r, &e, r->held + 1)) {
+                        r->dropped++;
+                        return false;
+                }
+                r->held++;
+        } else {
+                /* Always fits:  there are at least held slots free */
+                input_push(r, &e);
+                r->held--;
+        }
+        return true;
+}
+
+bool    input_key(input_ring_t *r, uint8_t key, bool down, uint32_t time_us)
+{
+        uint32_t bit = 1u << (key & 31);
+        bool was_down = !!(r->key_down[key / 32] & bit);
+
+        if (!input_edge(r, INPUT_KEY, key, down, was_down, time_us))
+                return false;
+        if (down)
+                r->key_down[key / 32] |= bit;
+        else
+                r->key_down[key / 32] &= ~bit;
+        return true;
+}
+
+bool    input_button(input_ring_t *r, uint8_t button, bool down, uint32_t time_us)
+{
+        uint8_t bit = 1 << (button & 7);
+        bool was_down = !!(r->buttons_down & bit);
+
+        if (!input_edge(r, INPUT_BUTTON, button & 7, down, was_down, time_us))
+                return false;
+        if (down)
+                r->buttons_down |= bit;
+        else
+                r->buttons_down &= ~bit;
+        return true;
+}
+
+void    input_motion(input_ring_t *r, int dx, int dy, uint32_t time_us)
+{
+        if (!dx && !dy)
+                return;
+        input_pend(r, r->pend_dx || r->pend_dy, time_us);
+        r->pend_dx += dx;
+        r->pend_dy += dy;
+        input_flush(r);
+}
+
+void    input_wheel(input_ring_t *r, int dz, uint32_t time_us)
+{
+        if (!dz)
+                return;
+        input_pend(r, r->pend_wheel, time_us);
+        r->pend_wheel += dz;
+        input_flush(r);
+}
+
+void    input_pointer(input_ring_t *r, unsigned int x, unsigned int y, uint32_t time_us)
+{
+        input_pend(r, r->pend_pointer, time_us);
+        r->pend_x = x;
+        r->pend_y = y;
+        r->pend_pointer = true;
+        input_flush(r);
+}
@@ -27,39 +27,13 @@
  */
 
 #include <stdio.h>
+#include "pico/time.h"
 #include "kbd.h"
+#include "input.h"
 
 #include "class/hid/hid.h"
 #include "keymap.h"
 
-#define KQ_SIZE         32
-#define KQ_MASK         (KQ_SIZE-1)
-
-static uint16_t kbd_queue[KQ_SIZE];
-static unsigned int kbd_queue_prod = 0;
-static unsigned int kbd_queue_cons = 0;
-
-static bool     kbd_queue_full()
-{
-        return ((kbd_queue_prod + 1) & KQ_MASK) == kbd_queue_cons;
-}
-
-
-bool            kbd_queue_empty()
-{
-        return kbd_queue_prod == kbd_queue_cons;
-}
-
-/* If empty, return 0, else return a mac keycode in [7:0] and [15] set if a press (else release) */
-uint16_t        kbd_queue_pop()
-{
-        if (kbd_queue_empty())
-                return 0;
-        uint16_t v = kbd_queue[kbd_queue_cons];
-        kbd_queue_cons = (kbd_queue_cons + 1) & KQ_MASK;
-        return v;
-}
-
 static const uint8_t hid_to_mac[256] = {
         [HID_KEY_NONE] = 0,
         [HID_KEY_A] = 255, // Hack for MKC_A,
@@ -172,28 +146,22 @@ static const uint8_t hid_to_mac[256] = {
         [HID_KEY_GUI_RIGHT] = MKC_Command,
 };
 
-static bool     kbd_map(uint8_t hid_keycode, bool pressed, uint16_t *key_out)
+static bool     kbd_map(uint8_t hid_keycode, uint8_t *key_out)
 {
         uint8_t k = hid_to_mac[hid_keycode];
         if (!k)
                 return false;
         if (k == 255)
                 k = MKC_A; // Hack, this is zero
-        k = (k << 1) | 1; // FIXME just do this in the #defines
-        *key_out = k | (pressed ? 0x8000 : 0); /* Convention w.r.t. main */
+        *key_out = (k << 1) | 1; // FIXME just do this in the #defines
         return true;
 }
 
 bool            kbd_queue_push(uint8_t hid_keycode, bool pressed)
 {
-        if (kbd_queue_full())
-                return false;
+        uint8_t k;
 
-        uint16_t v;
-        if (!kbd_map(hid_keycode, pressed, &v))
+        if (!kbd_map(hid_keycode, &k))
                 return false;
-
-        kbd_queue[kbd_queue_prod] = v;
-        kbd_queue_prod = (kbd_queue_prod + 1) & KQ_MASK;
-        return true;
+        return input_key(&input_events, k, pressed, time_us_32());
 }
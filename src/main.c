@@ -38,12 +38,38 @@
 #include "pico/time.h"
 #include "hw.h"
 #include "video.h"
+#include "vsync.h"
+#include "emu_sched.h"
+#include "stats.h"
+#include "console.h"
 #include "kbd.h"
+#include "input.h"
+#include "pointer.h"
+#include "hud.h"
+#include "fbcap.h"
+#include "profile.h"
+#include "opcount.h"
+#include "traps.h"
+#include "memmap.h"
+#include "idle.h"
+#include "maclowmem.h"
+#include "devchan.h"
+#include "discz.h"
+#if USE_PSRAM
+#include "psram.h"
+#endif
+#if HOST_BUILD
+#include "host_bench.h"
+#endif
 
 #include "bsp/rp2040/board.h"
 #include "tusb.h"
 
 #include "umac.h"
+#include "keymap.h"
+#if USE_PROFILE
+#include "m68k.h"
+#endif
 
 #if USE_SD
 #include "f_util.h"
@@ -52,13 +78,14 @@
 #include "hw_config.h"
 #endif
 
+#if VIDEO_BPP != 1
+#error "The Mac framebuffer is 1BPP; VIDEO_BPP > 1 is for other framebuffers"
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Imports and data
 
 extern void     hid_app_task(void);
-extern int cursor_x;
-extern int cursor_y;
-extern int cursor_button;
 
 // Mac binary data:  disc and ROM images
 static const uint8_t umac_disc[] = {
@@ -68,7 +95,12 @@ static const uint8_t umac_rom[] = {
 #include "umac-rom.h"
 };
 
+#if USE_PSRAM
+/* 512K/1MB Macs don't fit in SRAM; main() maps the PSRAM before use */
+static uint8_t *const umac_ram = (uint8_t *)PSRAM_BASE;
+#else
 static uint8_t umac_ram[RAM_SIZE];
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -92,57 +124,292 @@ static void     poll_led_etc()
         }
 }
 
-static int umac_cursor_x = 0;
-static int umac_cursor_y = 0;
 static int umac_cursor_button = 0;
 
+/* Guest vsync follows the video output's frames (so ~60Hz, but in step
+ * with the real scan-out).
+ */
+static vsync_t umac_vsync;
+
+/* The Mac selects the main or alternate screen buffer with VIA port A bit
+ * 6.  Read it (through umac's VIA, at the no-handshake address the ROM
+ * uses) and follow it, so page flipping is displayed directly from guest
+ * RAM.  video switches at the next frame boundary.
+ */
+static volatile unsigned int umac_fb_offset;
+
+static void     poll_fb_page()
+{
+        unsigned int o = mac_screen_offset(m68k_read_memory_8(MAC_VIA_BUFA), RAM_SIZE);
+
+        if (o != umac_fb_offset) {
+                umac_fb_offset = o;
+                video_set_framebuffer((uint32_t *)(umac_ram + o));
+        }
+}
+
+/* Bytes of disc I/O performed by the guest */
+static uint32_t disc_bytes = 0;
+
+#ifndef UMAC_EXECLOOP_QUANTUM
+/* 68000 cycles executed per umac_loop() call (umac's execution quantum) */
+#define UMAC_EXECLOOP_QUANTUM   5000
+#endif
+
+/* The 68K runs in batches of quanta, paced to real time unless USE_TURBO */
+#if USE_TURBO
+#define SCHED_MODE              SCHED_TURBO
+#else
+#define SCHED_MODE              SCHED_REALTIME
+#endif
+static sched_t umac_sched;
+
+#if USE_IDLE
+/* The last batch ended with the guest idle, waiting for an event */
+static bool umac_idle = false;
+#endif
+
+#if USE_HUD
+#define HUD_UPDATE_FRAMES       30
+
+/* The HUD strip is double-buffered: one is displayed while the other is drawn */
+static uint32_t hud_strip[2][HUD_LINES * (DISP_WIDTH / 32)];
+static unsigned int hud_loops = 0;
+static uint32_t hud_busy_us = 0;
+
+static void     poll_hud()
+{
+        static int hud_buf = 0;
+        static uint32_t last_frame = 0;
+        static uint32_t last_us = 0;
+        static uint32_t last_irq_cycles = 0;
+        static uint32_t last_disc_bytes = 0;
+        uint32_t frame = video_get_frame_count();
+        uint32_t frames = frame - last_frame;
+
+        if (frames < HUD_UPDATE_FRAMES)
+                return;
+
+        uint32_t now_us = time_us_32();
+        uint32_t us = now_us - last_us;
+        uint32_t irq_cycles = video_get_irq_cycles();
+        uint32_t sys_mhz = clock_get_hz(clk_sys) / 1000000;
+
+        /* Emulated MHz, busy time per frame (ms), IRQ % of CPU, disc KB/s,
+         * and the last frame's slack (or lag, if behind real time):
+         */
+        unsigned int mhz100 = (uint64_t)hud_loops * UMAC_EXECLOOP_QUANTUM * 100 / us;
+        unsigned int frame_ms10 = hud_busy_us / frames / 100;
+        unsigned int irq_pc10 = (uint64_t)(irq_cycles - last_irq_cycles) * 1000 / ((uint64_t)us * sys_mhz);
+        unsigned int disc_kbs = (uint64_t)(disc_bytes - last_disc_bytes) * 1000000 / us / 1024;
+        int32_t slack = umac_sched.slack_us;
+        unsigned int slack_ms10 = (slack < 0 ? -slack : slack) / 100;
+
+        char text[DISP_WIDTH / HUD_CHAR_W + 1];
+        snprintf(text, sizeof(text), "%u.%02uMHZ  FRAME %u.%uMS  IRQ %u.%u%%  DISC %uKB/S  %s %u.%uMS",
+                 mhz100 / 100, mhz100 % 100, frame_ms10 / 10, frame_ms10 % 10,
+                 irq_pc10 / 10, irq_pc10 % 10, disc_kbs,
+                 slack < 0 ? "LATE" : "SLACK", slack_ms10 / 10, slack_ms10 % 10);
+        hud_render(text, hud_strip[hud_buf], DISP_WIDTH / 32);
+        video_set_hud(hud_strip[hud_buf]);
+        hud_buf ^= 1;
+
+        last_frame = frame;
+        last_us = now_us;
+        last_irq_cycles = irq_cycles;
+        last_disc_bytes = disc_bytes;
+        hud_loops = 0;
+        hud_busy_us = 0;
+}
+#endif
+
+#if USE_FBCAP
+/* Framebuffer changes are streamed to the stdio UART from core 0, so
+ * emulation isn't slowed.  The UART is fed without blocking, to keep USB
+ * serviced; a new update is captured once the last has gone, and at most
+ * every FBCAP_INTERVAL_FRAMES.
+ */
+#define FBCAP_INTERVAL_FRAMES   6
+
+static fbcap_t fbcap;
+static unsigned int fbcap_sent = 0;
+static uint32_t fbcap_busy_us = 0;
+
+static void     poll_fbcap()
+{
+        static uint32_t last_frame = 0;
+        uint32_t frame = video_get_frame_count();
+
+        while (fbcap_sent < fbcap.len && uart_is_writable(uart_default))
+                uart_putc_raw(uart_default, fbcap.buf[fbcap_sent++]);
+
+        /* Frame 0 means video (and so umac) isn't up yet */
+        if (fbcap_sent < fbcap.len || frame == 0 ||
+            (frame - last_frame) < FBCAP_INTERVAL_FRAMES)
+                return;
+        last_frame = frame;
+
+        uint32_t t0 = time_us_32();
+        fbcap_capture(&fbcap, umac_ram + umac_fb_offset, fbcap_busy_us);
+        fbcap_busy_us += time_us_32() - t0;
+        fbcap_sent = 0;
+}
+#endif
+
+/* The absolute pointer's latest position, written to the guest at vsync */
+static int pointer_x;
+static int pointer_y;
+static bool pointer_new = false;
+
+/* The Mac has no scroll wheel, so each notch is sent as an up or down
+ * arrow key press and release, one edge per poll like other keys.  Notches
+ * not yet sent are capped, so a fast spin doesn't scroll on for long.
+ */
+#define WHEEL_MAX_NOTCHES       8
+
+static int wheel_notches = 0;
+static int wheel_key = -1;              /* Arrow key held, or -1 */
+
+static bool     wheel_pending()
+{
+        return wheel_notches || wheel_key >= 0;
+}
+
+/* Send one edge of the wheel's arrow keys; returns false if none were due */
+static bool     poll_wheel()
+{
+        if (wheel_key >= 0) {
+                umac_kbd_event(wheel_key, 0);
+                wheel_key = -1;
+        } else if (wheel_notches) {
+                wheel_key = wheel_notches > 0 ? MKC_Up : MKC_Down;
+                wheel_notches -= wheel_notches > 0 ? 1 : -1;
+                umac_kbd_event(wheel_key, 1);
+        } else {
+                return false;
+        }
+        return true;
+}
+
+/* Motion is merged, but a poll stops after a key or a button change so
+ * that the guest sees each one (as it did when keys were polled one at a
+ * time).
+ */
+static void     poll_input()
+{
+        input_event_t e;
+        int dx = 0;
+        int dy = 0;
+        bool mouse = false;
+
+#if USE_IDLE
+        idle_wake();
+#endif
+        if (poll_wheel())
+                return;
+        while (input_pop(&input_events, &e)) {
+                if (e.type == INPUT_KEY) {
+                        umac_kbd_event(e.key, e.down);
+                        break;
+                } else if (e.type == INPUT_BUTTON) {
+                        /* The Mac has one button */
+                        if (e.key == 0) {
+                                umac_cursor_button = e.down;
+                                mouse = true;
+                                break;
+                        }
+                } else if (e.type == INPUT_MOUSE) {
+                        dx += e.dx;
+                        dy += e.dy;
+                        mouse = true;
+                } else if (e.type == INPUT_POINTER) {
+                        pointer_x = pointer_map(e.dx, DISP_WIDTH);
+                        pointer_y = pointer_map(e.dy, DISP_HEIGHT);
+                        pointer_new = true;
+                } else if (e.type == INPUT_WHEEL) {
+                        /* Positive is away from the user, i.e. up */
+                        wheel_notches += e.dy;
+                        if (wheel_notches > WHEEL_MAX_NOTCHES)
+                                wheel_notches = WHEEL_MAX_NOTCHES;
+                        else if (wheel_notches < -WHEEL_MAX_NOTCHES)
+                                wheel_notches = -WHEEL_MAX_NOTCHES;
+                }
+        }
+        if (mouse)
+                umac_mouse(dx, -dy, umac_cursor_button);
+}
+
 static void     poll_umac()
 {
         static absolute_time_t last_1hz = 0;
-        static absolute_time_t last_vsync = 0;
         absolute_time_t now = get_absolute_time();
+        unsigned int n = sched_batch(&umac_sched, now);
 
-        umac_loop();
+        if (n) {
+                stats_mark_t m = stats_begin(STATS_UMAC);
+#if USE_PROFILE
+                profile_running = true;
+#endif
+                for (unsigned int i = 0; i < n; i++) {
+                        umac_loop();
+#if USE_IDLE
+                        umac_idle = idle_quantum_end();
+#endif
+#if HOST_BUILD
+                        host_bench_loop();
+#endif
+                }
+#if USE_PROFILE
+                profile_running = false;
+#endif
+                stats_end(STATS_UMAC, m);
+                absolute_time_t end = get_absolute_time();
+                sched_done(&umac_sched, n, end);
+#if USE_HUD
+                hud_busy_us += end - now;
+                hud_loops += n;
+#endif
+#if USE_IDLE
+        } else if (umac_idle) {
+                /* Ahead of real time, and the guest's only waiting for an
+                 * event:  sleep until the next IRQ (the video's, by the next
+                 * frame at the latest) or core 0 signals input.
+                 */
+                stats_mark_t m = stats_begin(STATS_SLEEP);
+                __wfe();
+                stats_end(STATS_SLEEP, m);
+#endif
+        } else {
+                /* Ahead of real time */
+                tight_loop_contents();
+        }
 
+        stats_mark_t m = stats_begin(STATS_POLL);
         int64_t p_1hz = absolute_time_diff_us(last_1hz, now);
-        int64_t p_vsync = absolute_time_diff_us(last_vsync, now);
-        if (p_vsync >= 16667) {
-                /* FIXME: Trigger this off actual vsync */
+        if (vsync_poll(&umac_vsync, video_get_frame_count())) {
+                /* Before the guest's VBL task, which draws the cursor: */
+                if (pointer_new) {
+                        pointer_set_lowmem(umac_ram, pointer_x, pointer_y);
+                        pointer_new = false;
+                }
                 umac_vsync_event();
-                last_vsync = now;
+                sched_frame(&umac_sched, get_absolute_time());
+#if HOST_BUILD
+                host_bench_vsync(&umac_sched);
+#endif
+                poll_fb_page();
+#if USE_HUD
+                poll_hud();
+#endif
         }
         if (p_1hz >= 1000000) {
                 umac_1hz_event();
                 last_1hz = now;
         }
 
-        int update = 0;
-        int dx = 0;
-        int dy = 0;
-        int b = umac_cursor_button;
-        if (cursor_x != umac_cursor_x) {
-                dx = cursor_x - umac_cursor_x;
-                umac_cursor_x = cursor_x;
-                update = 1;
-        }
-        if (cursor_y != umac_cursor_y) {
-                dy = cursor_y - umac_cursor_y;
-                umac_cursor_y = cursor_y;
-                update = 1;
-        }
-        if (cursor_button != umac_cursor_button) {
-                b = cursor_button;
-                umac_cursor_button = cursor_button;
-                update = 1;
-        }
-        if (update) {
-                umac_mouse(dx, -dy, b);
-        }
-
-        if (!kbd_queue_empty()) {
-                uint16_t k = kbd_queue_pop();
-                umac_kbd_event(k & 0xff, !!(k & 0x8000));
-        }
+        if (input_pending(&input_events) || wheel_pending())
+                poll_input();
+        stats_end(STATS_POLL, m);
 }
 
 #if USE_SD
@@ -156,6 +423,7 @@ static int      disc_do_read(void *ctx, uint8_t *data, unsigned int offset, unsi
                 printf("disc: f_read returned %d, read %u (of %u)\n", fr, did_read, len);
                 return -1;
         }
+        disc_bytes += len;
         return 0;
 }
 
@@ -169,12 +437,44 @@ static int      disc_do_write(void *ctx, uint8_t *data, unsigned int offset, uns
                 printf("disc: f_write returned %d, read %u (of %u)\n", fr, did_write, len);
                 return -1;
         }
+        disc_bytes += len;
         return 0;
 }
 
 static FIL discfp;
 #endif
 
+/* The in-flash image is accessed via ops too, so that I/O can be counted */
+#if USE_DISCZ
+/* It's block-compressed (by tools/discpack), and blocks are decompressed
+ * into a cache as they're read.
+ */
+static discz_t disc_z;
+static uint8_t disc_z_cache[DISCZ_CACHE_KB * 1024];
+
+static int      disc_flash_read(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        if (discz_read(ctx, data, offset, len) < 0) {
+                printf("disc: bad compressed block, reading %u at 0x%x\n", len, offset);
+                return -1;
+        }
+        disc_bytes += len;
+        return 0;
+}
+#else
+static int      disc_flash_read(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        memcpy(data, (const uint8_t *)ctx + offset, len);
+        disc_bytes += len;
+        return 0;
+}
+#endif
+
+static int      disc_flash_write(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        return -1;      /* Read-only */
+}
+
 static void     disc_setup(disc_descr_t discs[DISC_NUM_DRIVES])
 {
 #if USE_SD
@@ -238,9 +538,173 @@ no_sd:
         /* If we don't find (or look for) an SD-based image, attempt
          * to use in-flash disc image:
          */
-        discs[0].base = (void *)umac_disc;
+#if USE_DISCZ
+        if (discz_open(&disc_z, umac_disc, sizeof(umac_disc),
+                       disc_z_cache, sizeof(disc_z_cache)) < 0) {
+                printf("disc: no packed image in flash\n");
+                return;
+        }
+        printf("disc: packed image, %u bytes in %u %uKB blocks, %u cached\n",
+               (unsigned int)disc_z.size, (unsigned int)disc_z.blocks,
+               (unsigned int)disc_z.block_size / 1024, disc_z.slots);
+#endif
+        discs[0].base = 0; // Means use R/W ops
         discs[0].read_only = 1;
+#if USE_DISCZ
+        discs[0].size = disc_z.size;
+        discs[0].op_ctx = &disc_z;
+#else
         discs[0].size = sizeof(umac_disc);
+        discs[0].op_ctx = (void *)umac_disc;
+#endif
+        discs[0].op_read = disc_flash_read;
+        discs[0].op_write = disc_flash_write;
+}
+
+#if USE_DEVCHAN
+/* The disc backends (SD and FatFS, or the flash image) are set up and run
+ * on core 0.  Core 1's disc ops send it requests and wait for the result,
+ * so the guest sees just what it would if they ran on core 1.  While the
+ * guest runs, core 0 reads ahead from where the last read ended:  reads
+ * are mostly sequential, so the next one is often ready.
+ */
+#define DISC_READAHEAD          4096
+
+static devchan_t disc_chan;
+static disc_descr_t disc_backend[DISC_NUM_DRIVES];
+
+/* Core 0's:  the read-ahead buffer, and what's in it (or wanted) */
+static uint8_t disc_ra_buf[DISC_READAHEAD];
+static unsigned int disc_ra_unit;
+static uint32_t disc_ra_offset;
+static uint32_t disc_ra_len = 0;
+static bool disc_ra_wanted = false;
+static uint32_t disc_ra_hits = 0;
+
+static int      disc_chan_read(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        devchan_req_t r = { .op = DEVCHAN_DISC_READ, .unit = (uintptr_t)ctx,
+                            .data = data, .offset = offset, .len = len };
+
+        return devchan_call(&disc_chan, &r);
+}
+
+static int      disc_chan_write(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        devchan_req_t r = { .op = DEVCHAN_DISC_WRITE, .unit = (uintptr_t)ctx,
+                            .data = data, .offset = offset, .len = len };
+
+        return devchan_call(&disc_chan, &r);
+}
+
+/* On core 1:  the guest's discs, as disc_setup() found them on core 0 */
+static void     disc_chan_setup(disc_descr_t discs[DISC_NUM_DRIVES])
+{
+        for (unsigned int i = 0; i < DISC_NUM_DRIVES; i++) {
+                if (!disc_backend[i].op_read)
+                        continue;
+                discs[i] = disc_backend[i];
+                discs[i].op_ctx = (void *)(uintptr_t)i;
+                discs[i].op_read = disc_chan_read;
+                discs[i].op_write = disc_chan_write;
+        }
+}
+
+static int      disc_serve(const devchan_req_t *r)
+{
+        disc_descr_t *d = &disc_backend[r->unit];
+        int ret;
+
+        if (r->op == DEVCHAN_DISC_WRITE) {
+                if (r->unit == disc_ra_unit)
+                        disc_ra_len = 0;
+                return d->op_write(d->op_ctx, r->data, r->offset, r->len);
+        }
+        if (r->unit == disc_ra_unit && disc_ra_len && r->offset >= disc_ra_offset &&
+            r->offset + r->len <= disc_ra_offset + disc_ra_len) {
+                memcpy(r->data, disc_ra_buf + (r->offset - disc_ra_offset), r->len);
+                disc_ra_hits++;
+                ret = 0;
+        } else {
+                ret = d->op_read(d->op_ctx, r->data, r->offset, r->len);
+        }
+        if (ret == 0 && r->offset + r->len < d->size &&
+            !(r->unit == disc_ra_unit && disc_ra_len &&
+              r->offset + r->len + DISC_READAHEAD / 2 <= disc_ra_offset + disc_ra_len)) {
+                /* Unless at least half the buffer's still to come */
+                disc_ra_unit = r->unit;
+                disc_ra_offset = r->offset + r->len;
+                disc_ra_len = 0;
+                disc_ra_wanted = true;
+        }
+        return ret;
+}
+
+/* On core 0:  serve a request, or else read ahead.  Returns false if
+ * there was nothing to do.
+ */
+static bool     poll_devices()
+{
+        devchan_req_t r;
+
+        if (devchan_take(&disc_chan, &r)) {
+                devchan_resp_t resp = { .result = disc_serve(&r) };
+                devchan_reply(&disc_chan, &resp);
+                return true;
+        }
+        if (disc_ra_wanted) {
+                disc_descr_t *d = &disc_backend[disc_ra_unit];
+                uint32_t len = d->size - disc_ra_offset;
+
+                if (len > DISC_READAHEAD)
+                        len = DISC_READAHEAD;
+                disc_ra_wanted = false;
+                if (d->op_read(d->op_ctx, disc_ra_buf, disc_ra_offset, len) == 0)
+                        disc_ra_len = len;
+                return true;
+        }
+        return false;
+}
+
+#if HOST_BUILD
+/* umac_bench's "core 0" is a thread that only serves devices */
+static void     core0_devices()
+{
+        while (true) {
+                if (!poll_devices())
+                        devchan_wait();
+        }
+}
+#endif
+#endif
+
+/* The video mode can be chosen at boot by putting its name (e.g.
+ * "1024x768@60") in video.txt on the SD card.  Returns NULL to use the
+ * build's default.  This uses FatFS, so runs on the core that owns the
+ * SD card, after disc_setup() has mounted it:  core 0 with USE_DEVCHAN,
+ * before core 1 is started (which then only reads video_mode_name).
+ */
+static const char *video_mode_name = NULL;
+
+static const char       *video_mode_setup()
+{
+#if USE_SD
+        static char mode[32];
+        unsigned int len = 0;
+        FIL fp;
+
+        if (f_open(&fp, "video.txt", FA_READ) != FR_OK)
+                return NULL;
+        f_read(&fp, mode, sizeof(mode) - 1, &len);
+        f_close(&fp);
+        mode[len] = '\0';
+        mode[strcspn(mode, " \t\r\n")] = '\0';
+        if (mode[0]) {
+                printf("video.txt: mode %s\n", mode);
+                return mode;
+        }
+#endif
+        return NULL;
 }
 
 static void     core1_main()
@@ -248,13 +712,31 @@ static void     core1_main()
         disc_descr_t discs[DISC_NUM_DRIVES] = {0};
 
         printf("Core 1 started\n");
+        stats_init();
+#if USE_DEVCHAN
+        disc_chan_setup(discs);
+#else
         disc_setup(discs);
+        video_mode_name = video_mode_setup();
+#endif
 
+#if USE_TRAPS
+        traps_init(umac_ram, RAM_SIZE, umac_rom, sizeof(umac_rom));
+#endif
         umac_init(umac_ram, (void *)umac_rom, discs);
+#if USE_MEMMAP
+        memmap_init(umac_ram, RAM_SIZE, umac_rom, sizeof(umac_rom));
+#endif
+#if USE_IDLE
+        idle_init(umac_ram, RAM_SIZE, umac_rom, sizeof(umac_rom));
+#endif
         /* Video runs on core 1, i.e. IRQs/DMA are unaffected by
          * core 0's USB activity.
          */
-        video_init((uint32_t *)(umac_ram + umac_get_fb_offset()));
+        umac_fb_offset = mac_screen_offset(m68k_read_memory_8(MAC_VIA_BUFA), RAM_SIZE);
+        video_init((uint32_t *)(umac_ram + umac_fb_offset), video_mode_name);
+        vsync_init(&umac_vsync, video_get_frame_count(), VSYNC_MAX_BACKLOG);
+        sched_init(&umac_sched, SCHED_MODE, UMAC_EXECLOOP_QUANTUM, get_absolute_time());
 
         printf("Enjoyable Mac times now begin:\n\n");
 
@@ -263,23 +745,214 @@ static void     core1_main()
         }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Console, on core 0
+
+/* "reset" keeps a baseline, so that core 1's counters aren't written here */
+static stats_acc_t stats_base[STATS_NUM];
+static uint64_t stats_base_us = 0;
+#if USE_IDLE
+static idle_stats_t idle_base;
+#endif
+
+static void     cmd_stats(const char *args)
+{
+        stats_acc_t now[STATS_NUM];
+
+        stats_snapshot(now);
+        stats_report(now, stats_base, time_us_64() - stats_base_us, clock_get_hz(clk_sys));
+        printf("sched:  %s, %u frames, %u overrun, last slack %dus\n",
+               umac_sched.mode == SCHED_TURBO ? "turbo" : "real-time",
+               (unsigned int)umac_sched.frames, (unsigned int)umac_sched.overruns,
+               (int)umac_sched.slack_us);
+        printf("vsync:  %u delivered, %u missed\n",
+               (unsigned int)umac_vsync.delivered, (unsigned int)umac_vsync.missed);
+        printf("input:  %u presses refused, %u coalesced, max %u/%u queued\n",
+               (unsigned int)input_events.dropped, (unsigned int)input_events.coalesced,
+               (unsigned int)input_events.max_used, INPUT_RING_SIZE);
+#if USE_DEVCHAN
+        printf("discs:  %u requests to core 0, %u waited for, %u read-ahead hits\n",
+               (unsigned int)disc_chan.calls, (unsigned int)disc_chan.waits,
+               (unsigned int)disc_ra_hits);
+#endif
+#if USE_DISCZ
+        printf("discz:  %u cache hits, %u misses, %u whole blocks, %u errors\n",
+               (unsigned int)disc_z.hits, (unsigned int)disc_z.misses,
+               (unsigned int)disc_z.direct, (unsigned int)disc_z.errors);
+#endif
+#if USE_IDLE
+        idle_stats_t i = idle_stats;
+        uint32_t quanta = i.quanta - idle_base.quanta;
+        uint32_t idle = i.idle - idle_base.idle;
+        unsigned int idle10 = quanta ? (uint64_t)idle * 1000 / quanta : 0;
+
+        printf("idle:   %u.%u%% of %u quanta cut short, %u of %u event calls null%s\n",
+               idle10 / 10, idle10 % 10, (unsigned int)quanta,
+               (unsigned int)(i.nulls - idle_base.nulls), (unsigned int)(i.calls - idle_base.calls),
+               idle_enabled ? "" : " (off)");
+#endif
+}
+
+static void     cmd_reset(const char *args)
+{
+        stats_snapshot(stats_base);
+        stats_base_us = time_us_64();
+#if USE_IDLE
+        idle_base = idle_stats;
+#endif
+        printf("Stats reset\n");
+}
+
+#if USE_PROFILE
+/* Core 1's PC is sampled from a timer on core 0.  The interval's prime, so
+ * it doesn't beat with the 68K's periodic work (e.g. 60Hz vsync).
+ */
+#define PROF_INTERVAL_US        997
+
+static repeating_timer_t prof_timer;
+
+static bool     prof_tick(repeating_timer_t *t)
+{
+        if (profile_running)
+                profile_sample(m68k_get_reg(NULL, M68K_REG_PC));
+        else
+                profile_idle();
+        return true;
+}
+
+static void     cmd_prof(const char *args)
+{
+        if (strcmp(args, "clear") == 0) {
+                profile_clear();
+                printf("Profile cleared\n");
+        } else {
+                profile_dump(PROF_INTERVAL_US);
+        }
+}
+#endif
+
+#if USE_OPCOUNT
+static void     cmd_ops(const char *args)
+{
+        if (strcmp(args, "clear") == 0) {
+                opcount_clear();
+                printf("Opcode counts cleared\n");
+        } else {
+                opcount_dump();
+        }
+}
+#endif
+
+#if USE_TRAPS
+static void     cmd_traps(const char *args)
+{
+        if (strcmp(args, "on") == 0) {
+                traps_enabled = true;
+        } else if (strcmp(args, "off") == 0) {
+                traps_enabled = false;
+        } else if (strcmp(args, "clear") == 0) {
+                traps_clear();
+                printf("Trap counts cleared\n");
+                return;
+        }
+        traps_dump();
+}
+#endif
+
+#if USE_IDLE
+static void     cmd_idle(const char *args)
+{
+        if (strcmp(args, "on") == 0)
+                idle_enabled = true;
+        else if (strcmp(args, "off") == 0)
+                idle_enabled = false;
+        printf("Idle detection %s\n", idle_enabled ? "on" : "off");
+}
+#endif
+
+static const console_cmd_t console_cmds[] = {
+        { "stats", "Time per subsystem since reset, and counts since boot", cmd_stats },
+        { "reset", "Restart the time accounting", cmd_reset },
+#if USE_PROFILE
+        { "prof", "Dump the 68K PC profile (for tools/profsym.py); 'prof clear' restarts it", cmd_prof },
+#endif
+#if USE_OPCOUNT
+        { "ops", "Dump the 68K opcode counts (for tools/oprank.py); 'ops clear' restarts them", cmd_ops },
+#endif
+#if USE_TRAPS
+        { "traps", "Native trap counts; 'traps on|off' switches them, 'traps clear' restarts the counts", cmd_traps },
+#endif
+#if USE_IDLE
+        { "idle", "'idle on|off' switches guest idle detection (see stats)", cmd_idle },
+#endif
+        { NULL },
+};
+
 int     main()
 {
         set_sys_clock_khz(250*1000, true);
 
 	stdio_init_all();
         io_init();
+        stats_init();
+#if USE_PSRAM
+        /* After the clock's set, as the PSRAM's timing follows it */
+        size_t psram_size = psram_init(PSRAM_CS_PIN);
+        if (psram_size < RAM_SIZE)
+                panic("PSRAM: %uKB, but the Mac needs %uKB\n",
+                      (unsigned int)(psram_size / 1024), (unsigned int)(RAM_SIZE / 1024));
+        /* As the SRAM array would be */
+        memset(umac_ram, 0, RAM_SIZE);
+#endif
 
+        input_init(&input_events);
+#if USE_PROFILE
+        profile_init(umac_ram, RAM_SIZE);
+        add_repeating_timer_us(-PROF_INTERVAL_US, prof_tick, NULL, &prof_timer);
+#endif
+#if USE_DEVCHAN
+        /* Before core 1 starts, so the discs are ready for it */
+        devchan_init(&disc_chan);
+        disc_setup(disc_backend);
+        video_mode_name = video_mode_setup();
+#if HOST_BUILD
+        host_bench_thread(core0_devices);
+#endif
+#endif
         multicore_launch_core1(core1_main);
 
 	printf("Starting, init usb\n");
         tusb_init();
+#if USE_FBCAP
+        fbcap_init(&fbcap, DISP_WIDTH, DISP_HEIGHT);
+#endif
 
         /* This happens on core 0: */
 	while (true) {
+                stats_mark_t m = stats_begin(STATS_USB);
                 tuh_task();
+                stats_end(STATS_USB, m);
+                m = stats_begin(STATS_HID);
                 hid_app_task();
+                stats_end(STATS_HID, m);
+#if USE_IDLE
+                /* Wake core 1, if it's sleeping with the guest idle */
+                if (input_pending(&input_events))
+                        __sev();
+#endif
                 poll_led_etc();
+#if USE_DEVCHAN
+                m = stats_begin(STATS_DEVICES);
+                while (poll_devices())
+                        ;
+                stats_end(STATS_DEVICES, m);
+#endif
+#if USE_FBCAP
+                m = stats_begin(STATS_FBCAP);
+                poll_fbcap();
+                stats_end(STATS_FBCAP, m);
+#endif
+                console_poll(console_cmds);
 	}
 
 	return 0;
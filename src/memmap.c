@@ -0,0 +1,85 @@
+/*
+ * pico-umac direct-mapped guest memory, for Musashi's reads and writes
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "maclowmem.h"
+#include "memmap.h"
+
+/* Addresses 0..MEMMAP_PROBE_LIMIT are compared to find out whether RAM or
+ * the ROM's there.
+ */
+#define MEMMAP_PROBE_LIMIT      0x400
+
+uintptr_t memmap_pages[MEMMAP_PAGES];
+uint8_t *memmap_ram;
+uint32_t memmap_ram_limit = 0;
+
+static uint32_t memmap_ram_size;
+static const uint8_t *memmap_rom;
+
+static void     map(uint32_t base, uint32_t size, const uint8_t *host)
+{
+        for (uint32_t a = base; a + MEMMAP_PAGE_SIZE <= base + size; a += MEMMAP_PAGE_SIZE)
+                memmap_pages[a >> MEMMAP_PAGE_SHIFT] = host ? (uintptr_t)host - base : 0;
+}
+
+void    memmap_init(uint8_t *ram, uint32_t ram_size, const uint8_t *rom, uint32_t rom_size)
+{
+        memmap_ram = ram;
+        memmap_ram_size = ram_size;
+        memmap_rom = rom;
+        memmap_ram_limit = 0;
+        memset(memmap_pages, 0, sizeof(memmap_pages));
+        /* The ROM's at MAC_ROM_BASE, overlay or not */
+        map(MAC_ROM_BASE, rom_size, rom);
+        memmap_update();
+}
+
+static inline uint32_t  be32(const uint8_t *p)
+{
+        return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+void    memmap_update(void)
+{
+        bool ram_at_0 = false;
+
+        /* Find a long where RAM and ROM differ, and see which umac reads */
+        for (uint32_t a = 0; a < MEMMAP_PROBE_LIMIT; a += 4) {
+                uint32_t r = be32(memmap_ram + a);
+
+                if (r != be32(memmap_rom + a)) {
+                        ram_at_0 = (m68k_read_memory_32)(a) == r;
+                        break;
+                }
+        }
+        if (ram_at_0 != (memmap_ram_limit != 0)) {
+                map(0, memmap_ram_size, ram_at_0 ? memmap_ram : NULL);
+                memmap_ram_limit = ram_at_0 ? memmap_ram_size : 0;
+        }
+}
@@ -0,0 +1,129 @@
+/*
+ * pico-umac 68K opcode counting
+ *
+ * A build with USE_OPCOUNT counts every instruction executed, by opcode
+ * (i.e. by m68ki_instruction_jump_table index), which identifies the
+ * Musashi handler that ran, and so its addressing mode and cycles.  The
+ * counts drive profile-guided placement of the hottest handlers in SRAM
+ * (see tools/pgo_place.py), and tools/oprank.py ranks them by estimated
+ * cycles.  Counting costs emulation speed, so it's a build of its own.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "m68k.h"
+#include "opcount.h"
+
+static uint16_t opcount_ops[OPCOUNT_SLOTS];
+static uint32_t opcount_counts[OPCOUNT_SLOTS];  /* 0 means a free slot */
+static uint32_t opcount_overflow;
+
+#if HOST_BUILD
+static uint16_t *opcount_trace;
+static unsigned int opcount_trace_len;
+static uint64_t opcount_trace_pos;
+#endif
+
+void    __not_in_flash_func(opcount_op)(uint16_t op)
+{
+        /* Runs of one opcode (e.g. a DBRA loop) are common */
+        static unsigned int last = 0;
+
+#if HOST_BUILD
+        if (opcount_trace)
+                opcount_trace[opcount_trace_pos++ % opcount_trace_len] = op;
+#endif
+        if (opcount_counts[last] && opcount_ops[last] == op) {
+                opcount_counts[last]++;
+                return;
+        }
+        unsigned int h = ((uint32_t)op * 2654435761u) >> (32 - OPCOUNT_BITS);
+        for (unsigned int i = 0; i < OPCOUNT_PROBES; i++) {
+                unsigned int s = (h + i) & (OPCOUNT_SLOTS - 1);
+                if (opcount_counts[s] == 0)
+                        opcount_ops[s] = op;
+                else if (opcount_ops[s] != op)
+                        continue;
+                opcount_counts[s]++;
+                last = s;
+                return;
+        }
+        opcount_overflow++;
+}
+
+void    __not_in_flash_func(opcount_insn)(void)
+{
+        opcount_op(m68k_get_reg(NULL, M68K_REG_IR));
+}
+
+void    opcount_dump(void)
+{
+        uint64_t total = opcount_overflow;
+        unsigned int used = 0;
+
+        for (unsigned int s = 0; s < OPCOUNT_SLOTS; s++) {
+                if (opcount_counts[s]) {
+                        total += opcount_counts[s];
+                        used++;
+                }
+        }
+        printf("opc: total %llu overflow %u slots %u/%u\n", (unsigned long long)total,
+               (unsigned int)opcount_overflow, used, OPCOUNT_SLOTS);
+        for (unsigned int s = 0; s < OPCOUNT_SLOTS; s++) {
+                if (opcount_counts[s])
+                        printf("opc: %04x %u\n", opcount_ops[s], (unsigned int)opcount_counts[s]);
+        }
+        printf("opc: end\n");
+}
+
+void    opcount_clear(void)
+{
+        memset(opcount_counts, 0, sizeof(opcount_counts));
+        opcount_overflow = 0;
+}
+
+#if HOST_BUILD
+void    opcount_trace_start(unsigned int n)
+{
+        opcount_trace = calloc(n, sizeof(*opcount_trace));
+        opcount_trace_len = opcount_trace ? n : 0;
+        opcount_trace_pos = 0;
+}
+
+void    opcount_trace_write(FILE *f)
+{
+        unsigned int n = opcount_trace_pos < opcount_trace_len ? opcount_trace_pos : opcount_trace_len;
+        uint64_t start = opcount_trace_pos - n;
+
+        for (unsigned int i = 0; i < n; i++) {
+                uint16_t op = opcount_trace[(start + i) % opcount_trace_len];
+                fputc(op & 0xff, f);
+                fputc(op >> 8, f);
+        }
+}
+#endif
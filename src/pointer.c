@@ -0,0 +1,50 @@
+/*
+ * pico-umac absolute pointer support
+ *
+ * In absolute mode, the mouse isn't passed to umac as motion (which the
+ * guest integrates, after clamping and acceleration, so the pointer lags
+ * and drifts).  Instead the cursor position is written directly into the
+ * Mac's low memory at vsync, as Mini vMac does for its absolute mouse:
+ * MTemp and RawMouse take the new position, and CrsrNew is set from
+ * CrsrCouple so the cursor task picks it up (unless the cursor has been
+ * decoupled from the mouse).
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pointer.h"
+
+static void     wr16(uint8_t *ram, uint32_t addr, uint16_t v)
+{
+        ram[addr] = v >> 8;
+        ram[addr + 1] = v & 0xff;
+}
+
+void    pointer_set_lowmem(uint8_t *ram, int x, int y)
+{
+        wr16(ram, MAC_MTEMP, y);
+        wr16(ram, MAC_MTEMP + 2, x);
+        wr16(ram, MAC_RAWMOUSE, y);
+        wr16(ram, MAC_RAWMOUSE + 2, x);
+        ram[MAC_CRSRNEW] = ram[MAC_CRSRCOUPLE];
+}
@@ -0,0 +1,208 @@
+/*
+ * pico-umac 68K PC sampling profiler
+ *
+ * Samples are taken from the other core (or, on a host, between umac
+ * quanta), so the 68K isn't slowed at all:  where the PC is found is where
+ * the time goes.  Raw addresses aren't much use, so a dump also gives the
+ * trap dispatch tables and where code resources are loaded, which
+ * tools/profsym.py uses to name Toolbox/OS traps and application code.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "profile.h"
+
+volatile bool profile_running = false;
+
+static uint32_t prof_ram_buckets[PROF_RAM_BUCKETS];
+static uint32_t prof_rom_buckets[PROF_ROM_BUCKETS];
+static uint32_t prof_samples;
+static uint32_t prof_idle;
+static uint32_t prof_other;
+
+static const uint8_t *prof_ram;
+static uint32_t prof_ram_size;
+static unsigned int prof_ram_shift = PROF_RAM_MIN_SHIFT;
+
+/* Resource types that hold 68K code */
+static const char *prof_code_types[] = {
+        "CODE", "DRVR", "PTCH", "INIT", "PACK", "CDEF", "WDEF", "MDEF",
+        "LDEF", "FKEY", "cdev", "RDEV", NULL
+};
+
+void    profile_init(const uint8_t *ram, uint32_t ram_size)
+{
+        prof_ram = ram;
+        prof_ram_size = ram_size;
+        while ((ram_size >> prof_ram_shift) > PROF_RAM_BUCKETS)
+                prof_ram_shift++;
+        profile_clear();
+}
+
+void    profile_sample(uint32_t pc)
+{
+        pc &= 0xffffff;                         /* 24-bit bus */
+        prof_samples++;
+        if (pc < prof_ram_size)
+                prof_ram_buckets[pc >> prof_ram_shift]++;
+        else if (pc >= PROF_ROM_BASE && pc < PROF_ROM_BASE + PROF_ROM_SIZE)
+                prof_rom_buckets[(pc - PROF_ROM_BASE) >> PROF_ROM_SHIFT]++;
+        else
+                prof_other++;
+}
+
+void    profile_idle(void)
+{
+        prof_idle++;
+}
+
+void    profile_clear(void)
+{
+        memset(prof_ram_buckets, 0, sizeof(prof_ram_buckets));
+        memset(prof_rom_buckets, 0, sizeof(prof_rom_buckets));
+        prof_samples = 0;
+        prof_idle = 0;
+        prof_other = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reading the guest's structures (which it may be changing, so every access
+// is bounds-checked, and walks are limited)
+
+static uint32_t rd8(uint32_t addr)
+{
+        return addr < prof_ram_size ? prof_ram[addr] : 0;
+}
+
+static uint32_t rd16(uint32_t addr)
+{
+        return (rd8(addr) << 8) | rd8(addr + 1);
+}
+
+static uint32_t rd32(uint32_t addr)
+{
+        return (rd16(addr) << 16) | rd16(addr + 2);
+}
+
+/* A handle's data, or 0 if it's NULL or purged */
+static uint32_t deref(uint32_t h)
+{
+        h &= 0xffffff;
+        return h ? rd32(h) & 0xffffff : 0;
+}
+
+static void     print_str(uint32_t addr, unsigned int len)
+{
+        for (unsigned int i = 0; i < len; i++) {
+                int c = rd8(addr + i);
+                putchar(c >= ' ' && c < 0x7f ? c : '?');
+        }
+}
+
+static bool     is_code_type(uint32_t addr)
+{
+        for (const char **t = prof_code_types; *t; t++) {
+                if (rd32(addr) == (((uint32_t)(*t)[0] << 24) | ((*t)[1] << 16) |
+                                   ((*t)[2] << 8) | (*t)[3]))
+                        return true;
+        }
+        return false;
+}
+
+/* Each resource map (from TopMapHndl, so the application's first) has a
+ * type list, each type a list of references, and each reference the
+ * resource's handle if it's loaded.  A block's size is in its (24-bit
+ * Memory Manager) header.
+ */
+static void     dump_resources(void)
+{
+        uint32_t map = deref(rd32(MAC_TOPMAPHNDL));
+
+        for (int maps = 0; map && maps < 16; maps++) {
+                uint32_t types = map + rd16(map + 24);
+                uint32_t names = map + rd16(map + 26);
+                unsigned int ntypes = (rd16(types) + 1) & 0xffff;
+
+                for (unsigned int t = 0; t < ntypes && t < 256; t++) {
+                        uint32_t te = types + 2 + t * 8;
+                        if (!is_code_type(te))
+                                continue;
+                        unsigned int nrefs = (rd16(te + 4) + 1) & 0xffff;
+                        uint32_t refs = types + rd16(te + 6);
+
+                        for (unsigned int r = 0; r < nrefs && r < 1024; r++) {
+                                uint32_t re = refs + r * 12;
+                                uint32_t data = deref(rd32(re + 8));
+                                if (data < 8 || data >= prof_ram_size)
+                                        continue;
+                                uint32_t hdr = rd32(data - 8);
+                                uint32_t size = (hdr & 0xffffff) - 8 - ((hdr >> 24) & 0xf);
+                                if (size > prof_ram_size - data)
+                                        continue;
+                                printf("prof: res ");
+                                print_str(te, 4);
+                                printf(" %d %06x %x ", (int16_t)rd16(re), (unsigned int)data,
+                                       (unsigned int)size);
+                                uint32_t name = rd16(re + 2);
+                                if (name != 0xffff)
+                                        print_str(names + name + 1, rd8(names + name));
+                                printf("\n");
+                        }
+                }
+                map = deref(rd32(map + 16));
+        }
+}
+
+void    profile_dump(uint32_t interval_us)
+{
+        printf("prof: samples %u idle %u other %u interval %u\n",
+               (unsigned int)prof_samples, (unsigned int)prof_idle,
+               (unsigned int)prof_other, (unsigned int)interval_us);
+        printf("prof: ram %x %u\n", (unsigned int)prof_ram_size, prof_ram_shift);
+        printf("prof: rom %x %x %u\n", PROF_ROM_BASE, PROF_ROM_SIZE, PROF_ROM_SHIFT);
+        for (unsigned int i = 0; i < PROF_RAM_BUCKETS; i++) {
+                if (prof_ram_buckets[i])
+                        printf("prof: b %06x %u\n", i << prof_ram_shift,
+                               (unsigned int)prof_ram_buckets[i]);
+        }
+        for (unsigned int i = 0; i < PROF_ROM_BUCKETS; i++) {
+                if (prof_rom_buckets[i])
+                        printf("prof: b %06x %u\n", PROF_ROM_BASE + (i << PROF_ROM_SHIFT),
+                               (unsigned int)prof_rom_buckets[i]);
+        }
+
+        printf("prof: app ");
+        print_str(MAC_CURAPNAME + 1, rd8(MAC_CURAPNAME) & 31);
+        printf("\n");
+        for (unsigned int i = 0; i < MAC_OSTABLE_NUM; i++)
+                printf("prof: trap a%03x %06x\n", i,
+                       (unsigned int)(rd32(MAC_OSTABLE + i * 4) & 0xffffff));
+        for (unsigned int i = 0; i < MAC_TBTRAPTABLE_NUM; i++)
+                printf("prof: trap a%03x %06x\n", 0x800 + i,
+                       (unsigned int)(rd32(MAC_TBTRAPTABLE + i * 4) & 0xffffff));
+        dump_resources();
+        printf("prof: end\n");
+}
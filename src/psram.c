@@ -0,0 +1,202 @@
+/*
+ * pico-umac PSRAM (RP2350)
+ *
+ * Sets up the QMI's chip select 1 for an APS6404-style QSPI PSRAM (as on
+ * the Pimoroni Pico Plus 2 and similar boards):  it's reset and put in
+ * quad (QPI) mode using the QMI's direct mode, then the M1 window is given
+ * quad read/write commands and timing for the system clock.
+ *
+ * In direct mode the QMI stalls XIP (so flash) accesses, so that part runs
+ * from SRAM with interrupts off.  Only core 0 is running, at init.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/structs/qmi.h"
+#include "hardware/structs/xip_ctrl.h"
+
+#include "psram.h"
+
+#define PSRAM_CMD_QUAD_END      0xf5
+#define PSRAM_CMD_QUAD_ENABLE   0x35
+#define PSRAM_CMD_READ_ID       0x9f
+#define PSRAM_CMD_RSTEN         0x66
+#define PSRAM_CMD_RST           0x99
+#define PSRAM_CMD_QUAD_READ     0xeb
+#define PSRAM_CMD_QUAD_WRITE    0x38
+#define PSRAM_CMD_NOOP          0xff
+
+#define PSRAM_ID_KGD            0x5d    /* "Known good die" */
+
+#define PSRAM_MAX_HZ            133000000
+#define PSRAM_MAX_SELECT_NS     8000    /* tCEM, for refresh */
+#define PSRAM_MIN_DESELECT_NS   18
+
+static void     __no_inline_not_in_flash_func(psram_wait)(void)
+{
+        while (qmi_hw->direct_csr & QMI_DIRECT_CSR_BUSY_BITS) {
+        }
+}
+
+/* Send an SPI command on its own, in direct mode.  Each is passed as an
+ * immediate, rather than from a table:  a const table would be in flash,
+ * which can't be read while the QMI's in direct mode.
+ */
+static void     __no_inline_not_in_flash_func(psram_cmd)(uint8_t cmd)
+{
+        qmi_hw->direct_csr |= QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+        qmi_hw->direct_tx = cmd;
+        psram_wait();
+        qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+        for (int j = 0; j < 20; j++)
+                __asm volatile("nop");
+        (void)qmi_hw->direct_rx;
+}
+
+/* Returns the ID's EID byte, or -1 if the KGD byte's wrong */
+static int      __no_inline_not_in_flash_func(psram_setup)(uint32_t timing)
+{
+        uint32_t irq = save_and_disable_interrupts();
+        uint8_t kgd = 0, eid = 0;
+
+        /* Direct mode, at a slow clock for the SPI-mode commands */
+        qmi_hw->direct_csr = 10 << QMI_DIRECT_CSR_CLKDIV_LSB |
+                QMI_DIRECT_CSR_EN_BITS | QMI_DIRECT_CSR_AUTO_CS1N_BITS;
+        psram_wait();
+
+        /* Leave QPI mode, in case it's been set up before (sent quad) */
+        qmi_hw->direct_csr |= QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+        qmi_hw->direct_tx = QMI_DIRECT_TX_OE_BITS |
+                QMI_DIRECT_TX_IWIDTH_VALUE_Q << QMI_DIRECT_TX_IWIDTH_LSB |
+                PSRAM_CMD_QUAD_END;
+        psram_wait();
+        (void)qmi_hw->direct_rx;
+        qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+
+        /* Read ID:  the command, 3 address bytes, then MFID, KGD, EID */
+        qmi_hw->direct_csr |= QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+        for (int i = 0; i < 7; i++) {
+                qmi_hw->direct_tx = i == 0 ? PSRAM_CMD_READ_ID : PSRAM_CMD_NOOP;
+                while (!(qmi_hw->direct_csr & QMI_DIRECT_CSR_TXEMPTY_BITS)) {
+                }
+                psram_wait();
+                uint8_t b = qmi_hw->direct_rx;
+                if (i == 5)
+                        kgd = b;
+                else if (i == 6)
+                        eid = b;
+        }
+        qmi_hw->direct_csr &= ~(QMI_DIRECT_CSR_ASSERT_CS1N_BITS | QMI_DIRECT_CSR_EN_BITS);
+
+        if (kgd != PSRAM_ID_KGD) {
+                restore_interrupts(irq);
+                return -1;
+        }
+
+        /* Reset it, and enter QPI mode */
+        qmi_hw->direct_csr = 30 << QMI_DIRECT_CSR_CLKDIV_LSB | QMI_DIRECT_CSR_EN_BITS;
+        psram_wait();
+        psram_cmd(PSRAM_CMD_RSTEN);
+        psram_cmd(PSRAM_CMD_RST);
+        psram_cmd(PSRAM_CMD_QUAD_ENABLE);
+        qmi_hw->direct_csr &= ~(QMI_DIRECT_CSR_ASSERT_CS1N_BITS | QMI_DIRECT_CSR_EN_BITS);
+
+        /* The M1 window:  quad everything, 6 dummy clocks for reads */
+        qmi_hw->m[1].timing = timing;
+        qmi_hw->m[1].rfmt =
+                QMI_M1_RFMT_PREFIX_WIDTH_VALUE_Q << QMI_M1_RFMT_PREFIX_WIDTH_LSB |
+                QMI_M1_RFMT_ADDR_WIDTH_VALUE_Q << QMI_M1_RFMT_ADDR_WIDTH_LSB |
+                QMI_M1_RFMT_SUFFIX_WIDTH_VALUE_Q << QMI_M1_RFMT_SUFFIX_WIDTH_LSB |
+                QMI_M1_RFMT_DUMMY_WIDTH_VALUE_Q << QMI_M1_RFMT_DUMMY_WIDTH_LSB |
+                QMI_M1_RFMT_DATA_WIDTH_VALUE_Q << QMI_M1_RFMT_DATA_WIDTH_LSB |
+                QMI_M1_RFMT_PREFIX_LEN_VALUE_8 << QMI_M1_RFMT_PREFIX_LEN_LSB |
+                6 << QMI_M1_RFMT_DUMMY_LEN_LSB;
+        qmi_hw->m[1].rcmd = PSRAM_CMD_QUAD_READ;
+        qmi_hw->m[1].wfmt =
+                QMI_M1_WFMT_PREFIX_WIDTH_VALUE_Q << QMI_M1_WFMT_PREFIX_WIDTH_LSB |
+                QMI_M1_WFMT_ADDR_WIDTH_VALUE_Q << QMI_M1_WFMT_ADDR_WIDTH_LSB |
+                QMI_M1_WFMT_SUFFIX_WIDTH_VALUE_Q << QMI_M1_WFMT_SUFFIX_WIDTH_LSB |
+                QMI_M1_WFMT_DUMMY_WIDTH_VALUE_Q << QMI_M1_WFMT_DUMMY_WIDTH_LSB |
+                QMI_M1_WFMT_DATA_WIDTH_VALUE_Q << QMI_M1_WFMT_DATA_WIDTH_LSB |
+                QMI_M1_WFMT_PREFIX_LEN_VALUE_8 << QMI_M1_WFMT_PREFIX_LEN_LSB;
+        qmi_hw->m[1].wcmd = PSRAM_CMD_QUAD_WRITE;
+
+        xip_ctrl_hw->ctrl |= XIP_CTRL_WRITABLE_M1_BITS;
+
+        restore_interrupts(irq);
+        return eid;
+}
+
+size_t  psram_init(unsigned int cs_pin)
+{
+        uint32_t sys_hz = clock_get_hz(clk_sys);
+
+        /* The PSRAM's clock is the system clock divided; above 100MHz it
+         * needs an extra cycle of read delay.  The max select time's in
+         * units of 64 system clocks, and the min deselect's in clocks,
+         * less the half of the divided clock that's implicit.
+         */
+        uint32_t div = (sys_hz + PSRAM_MAX_HZ - 1) / PSRAM_MAX_HZ;
+        if (div == 1 && sys_hz > 100000000)
+                div = 2;
+        uint32_t rxdelay = div + (sys_hz / div > 100000000 ? 1 : 0);
+        uint64_t clk_ps = 1000000000000ull / sys_hz;
+        uint32_t max_select = PSRAM_MAX_SELECT_NS * 1000ull / 64 / clk_ps;
+        uint32_t min_deselect = (PSRAM_MIN_DESELECT_NS * 1000ull + clk_ps - 1) / clk_ps -
+                (div + 1) / 2;
+
+        uint32_t timing = 1 << QMI_M1_TIMING_COOLDOWN_LSB |
+                QMI_M1_TIMING_PAGEBREAK_VALUE_1024 << QMI_M1_TIMING_PAGEBREAK_LSB |
+                max_select << QMI_M1_TIMING_MAX_SELECT_LSB |
+                min_deselect << QMI_M1_TIMING_MIN_DESELECT_LSB |
+                rxdelay << QMI_M1_TIMING_RXDELAY_LSB |
+                div << QMI_M1_TIMING_CLKDIV_LSB;
+
+        gpio_set_function(cs_pin, GPIO_FUNC_XIP_CS1);
+
+        int eid = psram_setup(timing);
+        if (eid < 0) {
+                printf("PSRAM: none found on GPIO %u\n", cs_pin);
+                return 0;
+        }
+
+        /* The EID's top 3 bits give the density (and 0x26 is 8MB) */
+        size_t size = 1024 * 1024;
+        unsigned int density = eid >> 5;
+        if (eid == 0x26 || density == 2)
+                size *= 8;
+        else if (density == 0)
+                size *= 2;
+        else if (density == 1)
+                size *= 4;
+        printf("PSRAM: %uKB, at %luMHz\n", (unsigned int)(size / 1024),
+               (unsigned long)(sys_hz / div / 1000000));
+        return size;
+}
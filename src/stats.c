@@ -0,0 +1,102 @@
+/*
+ * pico-umac time accounting
+ *
+ * Sections of the main loops (and the video IRQ) are timed with the
+ * core's SysTick, which free-runs at clk_sys:  a section costs two
+ * register reads and a few adds, so this is always enabled.  Counters are
+ * only written by their own core.  The console (on core 0) resets them by
+ * keeping a snapshot and reporting the difference from it, so neither
+ * core writes the other's.
+ *
+ * The host build (umac_bench) provides stats_clock() from its fake clock.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+stats_acc_t stats_acc[STATS_NUM];
+volatile uint32_t stats_irq_cycles[2];
+
+static const char *stats_names[STATS_NUM] = {
+        [STATS_UMAC] = "umac",
+        [STATS_POLL] = "poll",
+        [STATS_VIDEO_IRQ] = "video IRQ",
+        [STATS_SLEEP] = "sleep",
+        [STATS_USB] = "USB",
+        [STATS_HID] = "HID",
+        [STATS_FBCAP] = "fbcap",
+        [STATS_DEVICES] = "devices",
+};
+
+void    stats_init(void)
+{
+#if !HOST_BUILD
+        systick_hw->rvr = STATS_CLOCK_MASK;
+        systick_hw->cvr = 0;
+#if PICO_RP2350
+        systick_hw->csr = M33_SYST_CSR_CLKSOURCE_BITS | M33_SYST_CSR_ENABLE_BITS;
+#else
+        systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+#endif
+#endif
+}
+
+void    stats_snapshot(stats_acc_t snap[STATS_NUM])
+{
+        memcpy(snap, (const void *)stats_acc, sizeof(stats_acc));
+}
+
+void    stats_report(const stats_acc_t now[STATS_NUM], const stats_acc_t base[STATS_NUM],
+                     uint64_t window_us, uint32_t clk_hz)
+{
+        uint64_t window = window_us * (clk_hz / 1000000);
+        uint64_t used[2] = { 0, 0 };
+
+        if (window == 0)
+                return;
+        printf("%-12s %7s %10s %9s %9s   (%u.%03us)\n", "", "%", "calls", "mean us", "max us*",
+               (unsigned int)(window_us / 1000000), (unsigned int)(window_us / 1000 % 1000));
+        for (int core = 1; core >= 0; core--) {
+                printf("Core %d:\n", core);
+                for (int i = 0; i < STATS_NUM; i++) {
+                        if (STATS_CORE(i) != core)
+                                continue;
+                        uint64_t cycles = now[i].cycles - base[i].cycles;
+                        uint32_t count = now[i].count - base[i].count;
+                        unsigned int pc10 = cycles * 1000 / window;
+                        unsigned int mean_ns = count ? cycles / count * 1000 / (clk_hz / 1000000) : 0;
+
+                        used[core] += cycles;
+                        printf("  %-10s %4u.%u%% %10u %5u.%03u %9u\n", stats_names[i],
+                               pc10 / 10, pc10 % 10, count, mean_ns / 1000, mean_ns % 1000,
+                               (unsigned int)((uint64_t)now[i].max * 1000000 / clk_hz));
+                }
+                unsigned int other10 = used[core] < window ? (window - used[core]) * 1000 / window : 0;
+                printf("  %-10s %4u.%u%%\n", "other", other10 / 10, other10 % 10);
+        }
+        printf("(* since boot)\n");
+}
@@ -0,0 +1,460 @@
+/*
+ * pico-umac native Toolbox traps
+ *
+ * BlockMove, FillRect and CopyBits are done natively when they're simple:
+ * a move within RAM (or from ROM), and fills and srcCopy blits of a
+ * rectangle that's wholly inside the port's bitmap, portRect, and its
+ * (rectangular) visRgn and clipRgn.  Anything else (clipping by a region,
+ * scaling, transfer modes, pictures being recorded, custom grafProcs, or
+ * drawing where the cursor is) is left to the ROM.  The result must be
+ * exactly what the ROM would have made of guest memory:
+ * tools/traptest compares the two.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "m68k.h"
+#include "blit.h"
+#include "opcount.h"
+#include "traps.h"
+
+volatile bool traps_enabled = false;
+
+const uint8_t *traps_ram;
+uint32_t traps_ram_size;
+const uint8_t *traps_rom;
+uint32_t traps_rom_size;
+
+typedef struct {
+        uint16_t        op;
+        const char      *name;
+        uint32_t        native;
+        uint32_t        rom;
+} trap_stat_t;
+
+static trap_stat_t trap_stats[] = {
+        { TRAP_BLOCKMOVE, "BlockMove" },
+        { TRAP_FILLRECT, "FillRect" },
+        { TRAP_COPYBITS, "CopyBits" },
+};
+#define NUM_TRAPS       (sizeof(trap_stats) / sizeof(trap_stats[0]))
+
+/* GrafPort fields */
+#define PORT_SIZE               108
+#define PORT_BITS               2       /* BitMap */
+#define PORT_RECT               16      /* Rect */
+#define PORT_VISRGN             24      /* RgnHandle */
+#define PORT_CLIPRGN            28      /* RgnHandle */
+#define PORT_FILLPAT            40      /* Pattern */
+#define PORT_PNVIS              66      /* Integer */
+#define PORT_COLRBIT            88      /* Integer */
+#define PORT_PICSAVE            92      /* Handle */
+#define PORT_RGNSAVE            96      /* Handle */
+#define PORT_POLYSAVE           100     /* Handle */
+#define PORT_GRAFPROCS          104     /* QDProcsPtr */
+
+#define BITMAP_SIZE             14
+#define RGN_RECT_SIZE           10      /* A rectangular region's rgnSize */
+
+#define MODE_SRCCOPY            0
+
+/* SR's condition codes */
+#define SR_CCR                  0x1f
+#define SR_X                    0x10
+#define SR_Z                    0x04
+
+typedef struct {
+        int16_t top, left, bottom, right;
+} rect_t;
+
+typedef struct {
+        uint32_t base;
+        int16_t row_bytes;
+        rect_t bounds;
+} bitmap_t;
+
+void    traps_init(uint8_t *ram, uint32_t ram_size, const uint8_t *rom, uint32_t rom_size)
+{
+        traps_ram = ram;
+        traps_ram_size = ram_size;
+        traps_rom = rom;
+        traps_rom_size = rom_size;
+        traps_clear();
+        traps_enabled = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Guest memory:  pointers are 24-bit, and anything outside RAM (or the ROM,
+// if reading) means the trap's left to the ROM.
+
+static uint8_t  *ram_at(uint32_t addr, uint32_t len)
+{
+        addr &= 0xffffff;
+        if (addr > traps_ram_size || len > traps_ram_size - addr)
+                return NULL;
+        return (uint8_t *)traps_ram + addr;
+}
+
+static const uint8_t    *mem_at(uint32_t addr, uint32_t len)
+{
+        addr &= 0xffffff;
+        if (addr >= MAC_ROM_BASE) {
+                addr -= MAC_ROM_BASE;
+                if (addr > traps_rom_size || len > traps_rom_size - addr)
+                        return NULL;
+                return traps_rom + addr;
+        }
+        return ram_at(addr, len);
+}
+
+static inline uint32_t  be16(const uint8_t *p)
+{
+        return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t  be32(const uint8_t *p)
+{
+        return (be16(p) << 16) | be16(p + 2);
+}
+
+static bool     rd_rect(uint32_t addr, rect_t *r)
+{
+        const uint8_t *p = mem_at(addr, 8);
+
+        if (!p)
+                return false;
+        r->top = be16(p);
+        r->left = be16(p + 2);
+        r->bottom = be16(p + 4);
+        r->right = be16(p + 6);
+        return true;
+}
+
+static bool     rd_bitmap(uint32_t addr, bitmap_t *bm)
+{
+        const uint8_t *p = mem_at(addr, BITMAP_SIZE);
+
+        if (!p)
+                return false;
+        bm->base = be32(p) & 0xffffff;
+        bm->row_bytes = be16(p + 4);
+        return rd_rect(addr + 6, &bm->bounds);
+}
+
+/* A region's bounding box, if the region is just that rectangle */
+static bool     rd_rgn_rect(uint32_t handle, rect_t *r)
+{
+        const uint8_t *h = ram_at(handle, 4);
+        const uint8_t *rgn = h ? ram_at(be32(h), RGN_RECT_SIZE) : NULL;
+
+        if (!rgn || be16(rgn) != RGN_RECT_SIZE)
+                return false;
+        return rd_rect(be32(h) + 2, r);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// QuickDraw
+
+static inline bool      rect_empty(const rect_t *r)
+{
+        return r->bottom <= r->top || r->right <= r->left;
+}
+
+static inline bool      rect_inside(const rect_t *r, const rect_t *outer)
+{
+        return r->top >= outer->top && r->left >= outer->left &&
+                r->bottom <= outer->bottom && r->right <= outer->right;
+}
+
+static inline bool      rect_overlaps(const rect_t *a, const rect_t *b)
+{
+        return a->top < b->bottom && b->top < a->bottom &&
+                a->left < b->right && b->left < a->right;
+}
+
+/* thePort, the first of the QuickDraw globals that (A5) points to */
+static uint8_t  *the_port(void)
+{
+        const uint8_t *a5 = ram_at(m68k_get_reg(NULL, M68K_REG_A5), 4);
+        const uint8_t *globals = a5 ? ram_at(be32(a5), 4) : NULL;
+
+        return globals ? ram_at(be32(globals), PORT_SIZE) : NULL;
+}
+
+/* A port that draws plainly:  no custom procs, nothing being recorded */
+static bool     port_plain(const uint8_t *port)
+{
+        return be32(port + PORT_GRAFPROCS) == 0 && be32(port + PORT_PICSAVE) == 0 &&
+                be32(port + PORT_RGNSAVE) == 0 && be32(port + PORT_POLYSAVE) == 0 &&
+                (int16_t)be16(port + PORT_PNVIS) >= 0 && be16(port + PORT_COLRBIT) == 0;
+}
+
+/* Drawing r wouldn't be clipped by the port */
+static bool     port_unclipped(const uint8_t *port, const rect_t *r)
+{
+        rect_t pr, vis, clip;
+
+        return rd_rect((port - traps_ram) + PORT_RECT, &pr) && rect_inside(r, &pr) &&
+                rd_rgn_rect(be32(port + PORT_VISRGN), &vis) && rect_inside(r, &vis) &&
+                rd_rgn_rect(be32(port + PORT_CLIPRGN), &clip) && rect_inside(r, &clip);
+}
+
+/* The guest's address of r's first byte in bm, and the number of bytes
+ * from there to its last.  r must be inside bm's bounds.
+ */
+static uint32_t bits_span(const bitmap_t *bm, const rect_t *r, uint32_t *len)
+{
+        uint32_t first = bm->base + (r->top - bm->bounds.top) * bm->row_bytes +
+                ((r->left - bm->bounds.left) >> 3);
+        uint32_t last = bm->base + (r->bottom - 1 - bm->bounds.top) * bm->row_bytes +
+                ((r->right - 1 - bm->bounds.left) >> 3);
+
+        *len = last - first + 1;
+        return first;
+}
+
+/* The ROM hides the cursor while drawing over it on the screen, and it'd
+ * be redrawn on top.  Leave that to the ROM.
+ */
+static bool     clear_of_cursor(const bitmap_t *bm, const rect_t *r)
+{
+        uint32_t scrn = be32(traps_ram + MAC_SCRNBASE) & 0xffffff;
+        uint32_t len;
+        uint32_t first = bits_span(bm, r, &len);
+        rect_t global, crsr;
+
+        if (!traps_ram[MAC_CRSRVIS] ||
+            first + len <= scrn || first >= scrn + DISP_WIDTH * DISP_HEIGHT / 8)
+                return true;
+        if (bm->base != scrn)
+                return false;
+        global.top = r->top - bm->bounds.top;
+        global.left = r->left - bm->bounds.left;
+        global.bottom = r->bottom - bm->bounds.top;
+        global.right = r->right - bm->bounds.left;
+        rd_rect(MAC_CRSRRECT, &crsr);
+        return !rect_overlaps(&global, &crsr);
+}
+
+/* A bitmap that can be drawn in (or read from) for r */
+static bool     bits_ok(const bitmap_t *bm, const rect_t *r, bool write)
+{
+        uint32_t len;
+        uint32_t first;
+
+        if (bm->row_bytes <= 0 || !rect_inside(r, &bm->bounds))
+                return false;
+        first = bits_span(bm, r, &len);
+        return (write ? ram_at(first, len) != NULL : mem_at(first, len) != NULL) &&
+                clear_of_cursor(bm, r);
+}
+
+/* The host's pointer for a bitmap's base (which bits_ok() has checked is
+ * valid for the rows and bytes that are used)
+ */
+static uint8_t  *bits_base(const bitmap_t *bm)
+{
+        if (bm->base >= MAC_ROM_BASE)
+                return (uint8_t *)traps_rom + (bm->base - MAC_ROM_BASE);
+        return (uint8_t *)traps_ram + bm->base;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The traps
+
+/* PROCEDURE BlockMove(src, dst: Ptr; count: Size)
+ * A0 = src, A1 = dst, D0 = count.  The OS trap dispatcher restores the
+ * other registers, and returns D0 = noErr with the CCR set from it.
+ */
+static bool     trap_blockmove(void)
+{
+        uint32_t count = m68k_get_reg(NULL, M68K_REG_D0);
+        const uint8_t *src;
+        uint8_t *dst;
+
+        if ((int32_t)count < 0)
+                return false;
+        src = mem_at(m68k_get_reg(NULL, M68K_REG_A0), count);
+        dst = ram_at(m68k_get_reg(NULL, M68K_REG_A1), count);
+        if (!src || !dst)
+                return false;
+
+        memmove(dst, src, count);
+        m68k_set_reg(M68K_REG_D0, 0);
+        m68k_set_reg(M68K_REG_SR, (m68k_get_reg(NULL, M68K_REG_SR) & ~SR_CCR) |
+                     (m68k_get_reg(NULL, M68K_REG_SR) & SR_X) | SR_Z);
+        return true;
+}
+
+/* PROCEDURE FillRect(r: Rect; pat: Pattern)
+ * On the stack:  pat's address, then r's.  FillRect keeps pat as the
+ * port's fillPat.
+ */
+static bool     trap_fillrect(void)
+{
+        uint32_t sp = m68k_get_reg(NULL, M68K_REG_A7);
+        const uint8_t *args = ram_at(sp, 8);
+        uint8_t *port = the_port();
+        const uint8_t *pat;
+        bitmap_t bm;
+        rect_t r;
+
+        if (!args || !port || !port_plain(port))
+                return false;
+        pat = mem_at(be32(args), 8);
+        if (!pat || !rd_rect(be32(args + 4), &r) ||
+            !rd_bitmap((port - traps_ram) + PORT_BITS, &bm))
+                return false;
+        if (!rect_empty(&r) && (!port_unclipped(port, &r) || !bits_ok(&bm, &r, true)))
+                return false;
+
+        memmove(port + PORT_FILLPAT, pat, 8);
+        if (!rect_empty(&r)) {
+                unsigned int y = r.top - bm.bounds.top;
+
+                blit_fill(bits_base(&bm), bm.row_bytes, r.left - bm.bounds.left, y,
+                          r.right - r.left, r.bottom - r.top, port + PORT_FILLPAT, y);
+        }
+        m68k_set_reg(M68K_REG_A7, sp + 8);
+        return true;
+}
+
+/* PROCEDURE CopyBits(srcBits, dstBits: BitMap; srcRect, dstRect: Rect;
+ *                    mode: INTEGER; maskRgn: RgnHandle)
+ * On the stack:  maskRgn, mode, then the addresses of dstRect, srcRect,
+ * dstBits and srcBits.
+ */
+static bool     trap_copybits(void)
+{
+        uint32_t sp = m68k_get_reg(NULL, M68K_REG_A7);
+        const uint8_t *args = ram_at(sp, 22);
+        uint8_t *port = the_port();
+        bitmap_t src, dst;
+        rect_t sr, dr;
+
+        if (!args || !port || !port_plain(port) ||
+            be32(args) != 0 || be16(args + 4) != MODE_SRCCOPY)
+                return false;
+        if (!rd_rect(be32(args + 6), &dr) || !rd_rect(be32(args + 10), &sr) ||
+            !rd_bitmap(be32(args + 14), &dst) || !rd_bitmap(be32(args + 18), &src))
+                return false;
+        /* Same size (no scaling), and not empty */
+        if (sr.bottom - sr.top != dr.bottom - dr.top || sr.right - sr.left != dr.right - dr.left ||
+            rect_empty(&dr))
+                return false;
+        if (!port_unclipped(port, &dr) || !bits_ok(&dst, &dr, true) || !bits_ok(&src, &sr, false))
+                return false;
+        /* Bitmaps can overlap, if they're the same shape */
+        if (src.row_bytes != dst.row_bytes) {
+                uint32_t slen, dlen;
+                uint32_t s = bits_span(&src, &sr, &slen);
+                uint32_t d = bits_span(&dst, &dr, &dlen);
+
+                if (s < d + dlen && d < s + slen)
+                        return false;
+        }
+
+        if (!blit_copy(bits_base(&dst), dst.row_bytes, dr.left - dst.bounds.left, dr.top - dst.bounds.top,
+                       bits_base(&src), src.row_bytes, sr.left - src.bounds.left, sr.top - src.bounds.top,
+                       dr.right - dr.left, dr.bottom - dr.top))
+                return false;
+        m68k_set_reg(M68K_REG_A7, sp + 22);
+        return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* The trap's dispatch table entry still points at the ROM */
+static bool     trap_in_rom(uint16_t op)
+{
+        uint32_t entry = (op & 0x0800) ? MAC_TBTRAPTABLE + (op & 0x1ff) * 4 :
+                MAC_OSTABLE + (op & 0xff) * 4;
+        uint32_t addr = be32(traps_ram + entry) & 0xffffff;
+
+        return addr >= MAC_ROM_BASE && addr < MAC_ROM_BASE + traps_rom_size;
+}
+
+bool    traps_try(uint32_t pc, uint16_t op)
+{
+        trap_stat_t *t;
+        bool done;
+
+        switch (op) {
+        case TRAP_BLOCKMOVE:
+                t = &trap_stats[0];
+                break;
+        case TRAP_FILLRECT:
+                t = &trap_stats[1];
+                break;
+        case TRAP_COPYBITS:
+                t = &trap_stats[2];
+                break;
+        default:
+                return false;
+        }
+        if (!trap_in_rom(op)) {
+                t->rom++;
+                return false;
+        }
+
+        if (op == TRAP_BLOCKMOVE)
+                done = trap_blockmove();
+        else if (op == TRAP_FILLRECT)
+                done = trap_fillrect();
+        else
+                done = trap_copybits();
+        if (!done) {
+                t->rom++;
+                return false;
+        }
+
+        /* As if the A-line instruction ran (Musashi never sees it, so
+         * it's counted here)
+         */
+        t->native++;
+#if USE_OPCOUNT
+        opcount_op(op);
+#endif
+        m68k_set_reg(M68K_REG_PC, pc + 2);
+        return true;
+}
+
+void    traps_dump(void)
+{
+        printf("traps:  native traps %s\n", traps_enabled ? "on" : "off");
+        for (unsigned int i = 0; i < NUM_TRAPS; i++)
+                printf("  %04x %-10s %10u native %10u ROM\n", trap_stats[i].op, trap_stats[i].name,
+                       (unsigned int)trap_stats[i].native, (unsigned int)trap_stats[i].rom);
+}
+
+void    traps_clear(void)
+{
+        for (unsigned int i = 0; i < NUM_TRAPS; i++) {
+                trap_stats[i].native = 0;
+                trap_stats[i].rom = 0;
+        }
+}
@@ -1,12 +1,21 @@
 /* Video output:
  *
- * Using PIO[1], output the Mac 512x342 1BPP framebuffer to VGA/pins.  This is done
+ * Using PIO[1], output the Mac 512x342 1BPP framebuffer to VGA/pins.  (Other
+ * framebuffer users can build with VIDEO_BPP of 2 or 4, for greyscale.)  This is done
  * directly from the Mac framebuffer (without having to reformat in an intermediate
  * buffer).  The video output is 640x480, with the visible pixel data centred with
  * borders:  for analog VGA this is easy, as it just means increasing the horizontal
  * back porch/front porch (time between syncs and active video) and reducing the
  * display portion of a line.
  *
+ * A 1024x768 mode shows the framebuffer at 2x, without a scaled copy:  PIO
+ * outputs each pixel for two pixel clocks, and the DMA sends each FB line on
+ * two consecutive output lines.
+ *
+ * Building with USE_LCD instead drives a parallel RGB LCD panel (pio_lcd, with a
+ * DE strobe), using the same DMA; the panel's timing comes from a table in
+ * video_timing.c.
+ *
  * [1]: see pio_video.pio
  *
  * Copyright 2024 Matt Evans
@@ -42,93 +51,125 @@
 #include "pio_video.pio.h"
 
 #include "hw.h"
+#include "hud.h"
+#include "stats.h"
+#include "video_scan.h"
+#include "video_timing.h"
 
 ////////////////////////////////////////////////////////////////////////////////
-/* VESA VGA mode 640x480@60 */
-
-/* The pixel clock _should_ be (125/2/25.175) (about 2.483) but that seems to
- * make my VGA-HDMI adapter sample weird, and pixels crawl.  Fudge a little,
- * looks better:
- */
-#define VIDEO_PCLK_MULT         (2.5*2)
-#define VIDEO_HSW               96
-#define VIDEO_HBP               48
-#define VIDEO_HRES              640
-#define VIDEO_HFP               16
-#define VIDEO_H_TOTAL_NOSYNC    (VIDEO_HBP + VIDEO_HRES + VIDEO_HFP)
-#define VIDEO_VSW               2
-#define VIDEO_VBP               33
-#define VIDEO_VRES              480
-#define VIDEO_VFP               10
-#define VIDEO_V_TOTAL           (VIDEO_VSW + VIDEO_VBP + VIDEO_VRES + VIDEO_VFP)
-/* The visible vertical span in the VGA output, [start, end) lines: */
-#define VIDEO_V_VIS_START       (VIDEO_VSW + VIDEO_VBP)
-#define VIDEO_V_VIS_END         (VIDEO_V_VIS_START + VIDEO_VRES)
+/* Output timing: a VGA mode, or an LCD panel (see video_timing.c) */
+
+#if USE_LCD
+#define VIDEO_IS_LCD            true
+#define VIDEO_TIMINGS           video_lcd_panels
+#define VIDEO_DEFAULT_MODE      LCD_PANEL
+#else
+#define VIDEO_IS_LCD            false
+#define VIDEO_TIMINGS           video_vga_modes
+#define VIDEO_DEFAULT_MODE      VIDEO_MODE
+#endif
 
 #define VIDEO_FB_HRES           DISP_WIDTH
 #define VIDEO_FB_VRES           DISP_HEIGHT
 
-/* The lines at which the FB data is actively output: */
-#define VIDEO_FB_V_VIS_START    (VIDEO_V_VIS_START + ((VIDEO_VRES - VIDEO_FB_VRES)/2))
-#define VIDEO_FB_V_VIS_END      (VIDEO_FB_V_VIS_START + VIDEO_FB_VRES)
-
-/* Words of 1BPP pixel data per line; this dictates the length of the
+/* Words of pixel data per line; this dictates the length of the
  * video data DMA transfer:
  */
-#define VIDEO_VISIBLE_WPL       (VIDEO_FB_HRES / 32)
+#define VIDEO_VISIBLE_WPL       VIDEO_SCAN_WPL(VIDEO_FB_HRES, VIDEO_BPP)
 
-#if (VIDEO_HRES & 31)
-#error "VIDEO_HRES: must be a multiple of 32b!"
+/* The scan list has an entry per output line, so is sized for the
+ * tallest mode (1024x768):
+ */
+#ifndef VIDEO_MAX_V_TOTAL
+#define VIDEO_MAX_V_TOTAL       806
+#endif
+
+#if (VIDEO_BPP != 1) && (VIDEO_BPP != 2) && (VIDEO_BPP != 4)
+#error "VIDEO_BPP: must be 1, 2 or 4"
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
 // Video DMA, framebuffer pointers
 
 static uint32_t video_null[VIDEO_VISIBLE_WPL];
-static uint32_t *video_framebuffer;
 
-/* DMA buffer containing 2 pairs of per-line config words, for VS and not-VS: */
-static uint32_t video_dma_cfg[4];
+/* DMA buffer containing 3 pairs of per-line config words, for VS, other
+ * blanking and active lines:
+ */
+static uint32_t video_dma_cfg[6];
+
+/* Geometry is filled in from the timing by video_init(): */
+static video_scan_t video_scan = {
+        .fb_vres = VIDEO_FB_VRES,
+        .wpl = VIDEO_VISIBLE_WPL,
+        .null_line = video_null,
+        .cfg = video_dma_cfg,
+};
+
+static const video_timing_t *video_timing;
+static uint8_t video_dmach_tx;
+
+/* Incremented as each frame's scan-out begins; see video_get_frame_count() */
+static volatile uint32_t video_frame_count = 0;
+
+/* CPU cycles spent in the video IRQ are accounted (see stats.h): */
+#define VIDEO_IRQ_ACCT_START()  stats_mark_t irq_m = stats_begin(STATS_VIDEO_IRQ)
+#define VIDEO_IRQ_ACCT_END()    stats_end_irq(STATS_VIDEO_IRQ, irq_m)
+
+#if USE_VIDEO_SCANLIST
+/* In scan list mode, 2 DMA channels are used.  The first transfers data to
+ * PIO, and the second walks a per-frame list of descriptors for the first.
+ */
+static uint8_t video_dmach_list;
+
+static uintptr_t video_scanlist[VIDEO_SCANLIST_WORDS(VIDEO_MAX_V_TOTAL)];
+
+static void     __not_in_flash_func(video_dma_irq)()
+{
+        /* The scan list ends in a null trigger, which raises this IRQ once
+         * the last line's data has been handed to ch0.  Rewind the list for
+         * the next frame.  The deadline is before the PIO FIFO (8 words) and
+         * the last line's HFP drain, so keep this quick.
+         */
+        VIDEO_IRQ_ACCT_START();
+        if (dma_channel_get_irq0_status(video_dmach_tx)) {
+                dma_channel_acknowledge_irq0(video_dmach_tx);
+                dma_channel_set_read_addr(video_dmach_list, video_scanlist, true);
+                video_scan_latch_list(&video_scan, video_scanlist);
+                video_frame_count++;
+        }
+        VIDEO_IRQ_ACCT_END();
+}
 
+#else
 /* 3 DMA channels are used.  The first to transfer data to PIO, and
  * the other two to transfer descriptors to the first channel.
  */
-static uint8_t video_dmach_tx;
 static uint8_t video_dmach_descr_cfg;
 static uint8_t video_dmach_descr_data;
 
+/* Laid out as a channel's READ_ADDR, WRITE_ADDR, TRANS_COUNT and CTRL_TRIG.
+ * These are register-width (i.e. uintptr_t) so that the layout still matches
+ * when built for the host simulator (tools/vidsim).
+ */
 typedef struct {
         const void *raddr;
         void *waddr;
-        uint32_t count;
-        uint32_t ctrl;
+        uintptr_t count;
+        uintptr_t ctrl;
 } dma_descr_t;
 
 static dma_descr_t video_dmadescr_cfg;
 static dma_descr_t video_dmadescr_data;
 
-static volatile unsigned int video_current_y = 0;
-
-static int      __not_in_flash_func(video_get_visible_y)(unsigned int y) {
-        if ((y >= VIDEO_FB_V_VIS_START) && (y < VIDEO_FB_V_VIS_END)) {
-                return y - VIDEO_FB_V_VIS_START;
-        } else {
-                return -1;
-        }
-}
-
 static const uint32_t   *__not_in_flash_func(video_line_addr)(unsigned int y)
 {
-        int vy = video_get_visible_y(y);
-        if (vy >= 0)
-                return (const uint32_t *)&video_framebuffer[vy * VIDEO_VISIBLE_WPL];
-        else
-                return (const uint32_t *)video_null;
+        return video_scan_line_addr(&video_scan, y);
 }
 
 static const uint32_t   *__not_in_flash_func(video_cfg_addr)(unsigned int y)
 {
-        return &video_dma_cfg[(y < VIDEO_VSW) ? 0 : 2];
+        return video_scan_cfg_addr(&video_scan, y);
 }
 
 static void    __not_in_flash_func(video_dma_prep_new)()
@@ -153,15 +194,14 @@ static void    __not_in_flash_func(video_dma_prep_new)()
          * starts; we have until the end of the video line (when the descriptors
          * are retriggered) to program them.
          *
-         * FIXME: this time could be used for something clever like split-screen
-         * (e.g. info/text lines) constructed on-the-fly.
+         * Lines outside the FB can come from the HUD status strip, if set.
          */
-        video_dmadescr_cfg.raddr = video_cfg_addr(video_current_y);
-        video_dmadescr_data.raddr = video_line_addr(video_current_y);
+        video_dmadescr_cfg.raddr = video_cfg_addr(video_scan.y);
+        video_dmadescr_data.raddr = video_line_addr(video_scan.y);
 
-        /* Frame done */
-        if (++video_current_y >= VIDEO_V_TOTAL)
-                video_current_y = 0;
+        /* Frame done (this latches a new FB, if one's been set) */
+        if (video_scan_next_line(&video_scan))
+                video_frame_count++;
 }
 
 static void     __not_in_flash_func(video_dma_irq)()
@@ -172,27 +212,105 @@ static void     __not_in_flash_func(video_dma_irq)()
          * All we need to do is reconfigure the descriptors; the video DMA will
          * re-trigger the descriptors later.
          */
+        VIDEO_IRQ_ACCT_START();
         if (dma_channel_get_irq0_status(video_dmach_descr_data)) {
                 dma_channel_acknowledge_irq0(video_dmach_descr_data);
                 video_dma_prep_new();
         }
+        VIDEO_IRQ_ACCT_END();
 }
+#endif
 
-static void     video_prep_buffer()
+static void     video_prep_buffer(const video_timing_t *t)
 {
         memset(video_null, 0xff, VIDEO_VISIBLE_WPL * 4);
 
-        unsigned int porch_padding = (VIDEO_HRES - VIDEO_FB_HRES)/2;
-        // FIXME: HBP/HFP are prob off by one or so, check
-        uint32_t timing = ((VIDEO_HSW - 1) << 23) |
-                ((VIDEO_HBP + porch_padding - 3) << 15) |
-                ((VIDEO_HFP + porch_padding - 4) << 7);
-        video_dma_cfg[0] = timing | 0x80000000;
-        video_dma_cfg[1] = VIDEO_FB_HRES - 1;
-        video_dma_cfg[2] = timing;
-        video_dma_cfg[3] = VIDEO_FB_HRES - 1;
+        /* The (scaled) framebuffer is centred vertically in the active
+         * area.  Any HUD strip (which isn't scaled vertically) goes in the
+         * middle of the border below it, if there's room:
+         */
+        video_scan.v_total = video_timing_v_total(t);
+        video_scan.vsw = t->vsw;
+        video_scan.act_start = t->vsw + t->vbp;
+        video_scan.act_lines = t->vres;
+        video_scan.fb_v_start = video_timing_fb_y(t, VIDEO_FB_VRES);
+        video_scan.v_shift = (t->scale == 2) ? 1 : 0;
+#if USE_HUD
+        unsigned int fb_lines = VIDEO_FB_VRES * t->scale;
+        unsigned int act_end = video_scan.act_start + t->vres;
+        unsigned int fb_v_end = video_scan.fb_v_start + fb_lines;
+
+        if (act_end - fb_v_end >= HUD_LINES) {
+                video_scan.hud_start = fb_v_end + (act_end - fb_v_end - HUD_LINES)/2;
+                video_scan.hud_lines = HUD_LINES;
+        } else {
+                printf("Video: no room for HUD below framebuffer\n");
+        }
+#endif
+
+        video_timing_cfg(t, VIDEO_FB_HRES, VIDEO_IS_LCD, video_dma_cfg);
+#if USE_VIDEO_SCANLIST
+        /* The scan list's single tx channel config bswaps everything,
+         * including config, so pre-swap it:
+         */
+        for (int i = 0; i < 6; i++)
+                video_dma_cfg[i] = __builtin_bswap32(video_dma_cfg[i]);
+#endif
+}
+
+#if USE_VIDEO_SCANLIST
+static void     video_init_dma()
+{
+        /* As below, only one channel (ch0) may transfer to PIO.  Here,
+         * ch0's control register is the same for config and data
+         * transfers (both bswap, and config is pre-swapped to match) so
+         * only the transfer count and read address differ per transfer.
+         *
+         * The list channel writes a {count, read address} pair from the
+         * scan list to ch0's alias 3 TRANS_COUNT/READ_ADDR_TRIG registers,
+         * triggering ch0.  When ch0 completes, it chains back to the list
+         * channel, which picks up the next pair.  So, the whole frame runs
+         * without CPU intervention.
+         *
+         * The list ends with a null trigger: with IRQ_QUIET set, ch0 raises
+         * an IRQ for that (and only that), and the IRQ restarts the list.
+         *
+         * The list costs 16 bytes per output line, sized for the tallest
+         * mode (VIDEO_MAX_V_TOTAL lines, about 13KB).
+         */
+        video_dmach_tx = dma_claim_unused_channel(true);
+        video_dmach_list = dma_claim_unused_channel(true);
+
+        dma_channel_config dc_tx = dma_channel_get_default_config(video_dmach_tx);
+        channel_config_set_dreq(&dc_tx, DREQ_PIO0_TX0);
+        channel_config_set_transfer_data_size(&dc_tx, DMA_SIZE_32);
+        channel_config_set_read_increment(&dc_tx, true);
+        channel_config_set_write_increment(&dc_tx, false);
+        channel_config_set_bswap(&dc_tx, true);
+        channel_config_set_irq_quiet(&dc_tx, true);
+        channel_config_set_chain_to(&dc_tx, video_dmach_list);
+        dma_channel_set_irq0_enabled(video_dmach_tx, true);
+        dma_channel_configure(video_dmach_tx, &dc_tx,
+                              &pio0_hw->txf[0],
+                              NULL,             /* From the list */
+                              0,                /* From the list */
+                              false);
+
+        dma_channel_config dc_list = dma_channel_get_default_config(video_dmach_list);
+        channel_config_set_transfer_data_size(&dc_list, DMA_SIZE_32);
+        channel_config_set_read_increment(&dc_list, true);
+        channel_config_set_write_increment(&dc_list, true);
+        /* Writes wrap on an 8-byte/2-word boundary, i.e. count+trigger: */
+        channel_config_set_ring(&dc_list, true, 3);
+        dma_channel_configure(video_dmach_list, &dc_list,
+                              &dma_hw->ch[video_dmach_tx].al3_transfer_count,
+                              video_scanlist,
+                              2 /* Words per list entry */,
+                              false /* Not yet */);
 }
 
+#else
+
 static void     video_init_dma()
 {
         /* pio_video expects each display line to be composed of two words of config
@@ -205,7 +323,7 @@ static void     video_init_dma()
          * transfer the video data from the framebuffer.  (This lets us use a
          * flat, regular FB.)
          *
-         * The PIO side emits 1BPP MSB-first.  The other advantage of
+         * The PIO side emits VIDEO_BPP MSB-first.  The other advantage of
          * using a second DMA transfer is then we can also can
          * byteswap the DMA of the video portion to match the Mac
          * framebuffer layout.
@@ -301,32 +419,131 @@ static void     video_init_dma()
          * to start video.
          */
 }
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 
-/* Initialise PIO, DMA, start sending pixels.  Passed a pointer to a 512x342x1
- * Mac-order framebuffer.
- *
- * FIXME: Add an API to change the FB base after init live, e.g. for bank
- * switching.
+/* Returns a count of frames output so far; a change indicates a new frame
+ * (i.e. a real vsync) has started.  This wraps, so compare differences.
+ */
+uint32_t        video_get_frame_count()
+{
+        return video_frame_count;
+}
+
+/* Change the framebuffer base.  The switch happens at the start of the next
+ * frame, so there's no tearing; the new buffer has the same geometry.
+ */
+void    video_set_framebuffer(uint32_t *framebuffer)
+{
+        video_scan_set_fb(&video_scan, framebuffer);
+}
+
+#if USE_HUD
+/* Display a status strip of HUD_LINES lines (in the FB's format) in the
+ * border below the FB, or remove it if NULL.  Like the FB, this switches at
+ * the next frame boundary; the caller should double-buffer.
+ */
+void    video_set_hud(const uint32_t *strip)
+{
+        video_scan_set_hud(&video_scan, strip);
+}
+
+/* Returns the running total of CPU cycles spent in the video IRQ; this wraps */
+uint32_t        video_get_irq_cycles()
+{
+        return stats_acc[STATS_VIDEO_IRQ].cycles;
+}
+#endif
+
+/* Returns the name of the output mode in use */
+const char      *video_get_mode()
+{
+        return video_timing->name;
+}
+
+/* Look up a mode by name, and check it can show the FB; returns NULL
+ * (having said why) if not.
  */
-void    video_init(uint32_t *framebuffer)
+static const video_timing_t     *video_find_mode(const char *name, uint32_t sys_khz)
 {
-        printf("Video init\n");
+        const video_timing_t *t = video_timing_find(VIDEO_TIMINGS, name);
+        const char *err = "unknown";
+
+        if (t) {
+                err = video_timing_check(t, VIDEO_FB_HRES, VIDEO_FB_VRES, VIDEO_BPP,
+                                         sys_khz, VIDEO_IS_LCD);
+                if (!err && video_timing_v_total(t) > VIDEO_MAX_V_TOTAL)
+                        err = "too many lines";
+        }
+        if (err) {
+                printf("Video: mode %s: %s\n", name, err);
+                return NULL;
+        }
+        return t;
+}
 
+/* Initialise PIO, DMA, start sending pixels.  Passed a pointer to a 512x342
+ * (DISP_WIDTH x DISP_HEIGHT) Mac-order framebuffer of VIDEO_BPP bits per pixel.
+ * An LCD panel's framebuffer is the panel width (and up to its height).
+ *
+ * It's shown in the named mode (from the table in video_timing.c), which
+ * may scale it up.  If mode is NULL, or can't be used, the build's default
+ * (VIDEO_MODE, or LCD_PANEL) is used instead.
+ *
+ * Building with USE_VIDEO_SCANLIST uses a precomputed per-frame DMA list,
+ * taking one IRQ per frame instead of one per line.
+ */
+void    video_init(uint32_t *framebuffer, const char *mode)
+{
+        uint32_t sys_khz = clock_get_hz(clk_sys) / 1000;
+        const video_timing_t *t = NULL;
+
+        if (mode)
+                t = video_find_mode(mode, sys_khz);
+        if (!t)
+                t = video_find_mode(VIDEO_DEFAULT_MODE, sys_khz);
+        if (!t)
+                panic("Video: no usable mode\n");
+        video_timing = t;
+
+        /* PIO runs at 2x the pixel clock: */
+        uint32_t div = video_timing_clkdiv(t, sys_khz, VIDEO_IS_LCD);
+        float clk_div = div / 256.0f;
+
+        uint64_t pclk_hz = sys_khz * 128000ULL / div;
+        unsigned int centi_hz = pclk_hz * 100 /
+                (video_timing_h_total(t) * video_timing_v_total(t));
+        printf("Video init: %s%s, scale %u, %u.%02uHz\n", VIDEO_IS_LCD ? "LCD " : "",
+               t->name, t->scale, centi_hz / 100, centi_hz % 100);
+#if USE_LCD
+        pio_lcd_program_init(pio0, 0,
+                             pio_lcd_add_program(pio0, VIDEO_BPP),
+                             GPIO_VID_DATA, /* Followed by VS, CLK, HS, DE */
+                             VIDEO_BPP,
+                             clk_div);
+#else
         pio_video_program_init(pio0, 0,
-                               pio_add_program(pio0, &pio_video_program),
-                               GPIO_VID_DATA, /* Followed by HS, VS, CLK */
-                               VIDEO_PCLK_MULT);
+                               pio_video_add_program(pio0, VIDEO_BPP, t->scale),
+                               GPIO_VID_DATA, /* Followed by VS, CLK, HS */
+                               VIDEO_BPP,
+                               clk_div);
+#endif
 
-        /* Invert output pins:  HS/VS are active-low, also invert video! */
+        /* Invert output pins:  HS/VS are active-low, also invert video!
+         * (DE, for LCDs, is active-high.)
+         */
         gpio_set_outover(GPIO_VID_HS, GPIO_OVERRIDE_INVERT);
         gpio_set_outover(GPIO_VID_VS, GPIO_OVERRIDE_INVERT);
-        gpio_set_outover(GPIO_VID_DATA, GPIO_OVERRIDE_INVERT);
-        /* Highest drive strength (VGA is current-based, innit) */
-        hw_write_masked(&padsbank0_hw->io[GPIO_VID_DATA],
-                        PADS_BANK0_GPIO0_DRIVE_VALUE_12MA << PADS_BANK0_GPIO0_DRIVE_LSB,
-                        PADS_BANK0_GPIO0_DRIVE_BITS);
+        for (int i = 0; i < VIDEO_BPP; i++) {
+                gpio_set_outover(GPIO_VID_DATA + i, GPIO_OVERRIDE_INVERT);
+#if !USE_LCD
+                /* Highest drive strength (VGA is current-based, innit) */
+                hw_write_masked(&padsbank0_hw->io[GPIO_VID_DATA + i],
+                                PADS_BANK0_GPIO0_DRIVE_VALUE_12MA << PADS_BANK0_GPIO0_DRIVE_LSB,
+                                PADS_BANK0_GPIO0_DRIVE_BITS);
+#endif
+        }
 
         /* IRQ handlers for DMA_IRQ_0: */
         irq_set_exclusive_handler(DMA_IRQ_0, video_dma_irq);
@@ -335,11 +552,17 @@ void    video_init(uint32_t *framebuffer)
         video_init_dma();
 
         /* Init config word buffers */
-        video_current_y = 0;
-        video_framebuffer = framebuffer;
-        video_prep_buffer();
-
+        video_scan.fb = framebuffer;
+        video_scan.fb_next = framebuffer;
+        video_prep_buffer(t);
+
+#if USE_VIDEO_SCANLIST
+        video_scan_build_list(&video_scan, video_scanlist);
+        dma_channel_start(video_dmach_list);
+#else
         /* Set up pointers to first line, and start DMA */
+        video_scan.y = 0;
         video_dma_prep_new();
         dma_channel_start(video_dmach_descr_cfg);
+#endif
 }
@@ -0,0 +1,61 @@
+/*
+ * pico-umac video scan-out geometry
+ *
+ * Generates per-frame DMA scan lists, and packs pixels in the scan-out
+ * format (see video_scan.h).
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "video_scan.h"
+
+void    video_scan_build_list(const video_scan_t *vs, uintptr_t *list)
+{
+        for (unsigned int y = 0; y < vs->v_total; y++) {
+                *list++ = 2;
+                *list++ = (uintptr_t)video_scan_cfg_addr(vs, y);
+                *list++ = vs->wpl;
+                *list++ = (uintptr_t)video_scan_line_addr(vs, y);
+        }
+        /* Null trigger: stops the chain, and raises the end-of-frame IRQ */
+        *list++ = 0;
+        *list++ = 0;
+}
+
+void            video_scan_put_pixel(uint32_t *line, unsigned int x, unsigned int bpp,
+                                     unsigned int v)
+{
+        uint8_t *p = (uint8_t *)line + (x * bpp) / 8;
+        unsigned int shift = 8 - bpp - ((x * bpp) & 7);
+        unsigned int mask = ((1 << bpp) - 1) << shift;
+
+        *p = (*p & ~mask) | ((v << shift) & mask);
+}
+
+unsigned int    video_scan_get_pixel(const uint32_t *line, unsigned int x, unsigned int bpp)
+{
+        const uint8_t *p = (const uint8_t *)line + (x * bpp) / 8;
+        unsigned int shift = 8 - bpp - ((x * bpp) & 7);
+
+        return (*p >> shift) & ((1 << bpp) - 1);
+}
@@ -0,0 +1,262 @@
+/*
+ * pico-umac video timings
+ *
+ * Timing tables, and the config words for pio_video (see video_timing.h).
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "video_timing.h"
+
+/* VGA monitor modes, chosen at boot (see video_init()):
+ *
+ * VESA 640x480@60 shows the Mac screen 1:1 with a border.  The pixel clock
+ * _should_ be 25.175MHz, (125/2/25.175) (about 2.483) but that seems to make
+ * my VGA-HDMI adapter sample weird, and pixels crawl.  Fudge a little, looks
+ * better.
+ *
+ * VGA pixel clocks must divide clk_sys by an integer (see
+ * video_timing_clkdiv()), so the others are fudged too.  800x600@56 (for a
+ * 640x480 FB, or a bigger border) uses 250/7MHz rather than 36MHz.
+ *
+ * 1024x768 shows it doubled (1024x684), which fills a modern monitor rather
+ * better.  VESA's 65MHz clock is replaced by 62.5MHz (clk_sys/4), with the
+ * porches trimmed to keep the line and frame rates at about 48.4kHz/60Hz;
+ * monitors lock on to it as the VESA mode.
+ */
+const video_timing_t video_vga_modes[] = {
+        {
+                .name = "640x480@60", .pclk_khz = 25000,
+                .hsw = 96, .hbp = 48, .hres = 640, .hfp = 16,
+                .vsw = 2, .vbp = 33, .vres = 480, .vfp = 10,
+                .scale = 1,
+        },
+        {
+                .name = "800x600@56", .pclk_khz = 35714,
+                .hsw = 72, .hbp = 128, .hres = 800, .hfp = 24,
+                .vsw = 2, .vbp = 22, .vres = 600, .vfp = 1,
+                .scale = 1,
+        },
+        {
+                .name = "1024x768@60", .pclk_khz = 62500,
+                .hsw = 136, .hbp = 112, .hres = 1024, .hfp = 20,
+                .vsw = 6, .vbp = 29, .vres = 768, .vfp = 3,
+                .scale = 2,
+        },
+        { .name = NULL }
+};
+
+/* Typical timings for cheap parallel RGB TFT panels.  Datasheets give a
+ * range for most of these; these are middle-of-the-road values that work
+ * on the panels I've got, with the refresh around 60Hz.
+ */
+const video_timing_t video_lcd_panels[] = {
+        {       /* e.g. 5.7" VGA panels */
+                .name = "640x480", .pclk_khz = 25000,
+                .hsw = 30, .hbp = 114, .hres = 640, .hfp = 16,
+                .vsw = 3, .vbp = 32, .vres = 480, .vfp = 10,
+                .scale = 1,
+        },
+        {       /* e.g. 5"/7" AT070TN9x-style panels */
+                .name = "800x480", .pclk_khz = 33333,
+                .hsw = 20, .hbp = 26, .hres = 800, .hfp = 210,
+                .vsw = 3, .vbp = 20, .vres = 480, .vfp = 22,
+                .scale = 1,
+        },
+        {       /* e.g. 7" EK9716-style panels */
+                .name = "1024x600", .pclk_khz = 50000,
+                .hsw = 20, .hbp = 140, .hres = 1024, .hfp = 160,
+                .vsw = 3, .vbp = 20, .vres = 600, .vfp = 12,
+                .scale = 1,
+        },
+        { .name = NULL }
+};
+
+/* The PIO programs spend a few cycles of each region reading config, so
+ * the config fields are short by these amounts.  These are in step with the
+ * cycle counts in video_timing_line_pclks().
+ */
+#define VGA_HSW_ADJ     1
+#define VGA_HBP_ADJ     3
+#define VGA_HFP_ADJ     4
+#define LCD_HSW_ADJ     2
+#define LCD_HBP_ADJ     5
+#define LCD_HFP_ADJ     4
+
+#define CFG_VS          0x80000000
+#define CFG_DE          0x00000040
+#define CFG_FIELD_MAX   255
+
+const video_timing_t    *video_timing_find(const video_timing_t *table, const char *name)
+{
+        for (; table->name; table++) {
+                if (!strcmp(table->name, name))
+                        return table;
+        }
+        return NULL;
+}
+
+static bool     field_ok(unsigned int val, unsigned int adj)
+{
+        return (val >= adj) && (val - adj <= CFG_FIELD_MAX);
+}
+
+/* The VGA border left of the FB, in pixel clocks:  the FB is centred, or as
+ * near as HBP's config field allows (the rest goes in HFP).
+ */
+static unsigned int     vga_left_border(const video_timing_t *t, unsigned int fb_w)
+{
+        unsigned int left = (t->hres - fb_w * t->scale)/2;
+
+        if (t->hbp >= CFG_FIELD_MAX + VGA_HBP_ADJ)
+                return 0;
+        if (t->hbp + left > CFG_FIELD_MAX + VGA_HBP_ADJ)
+                left = CFG_FIELD_MAX + VGA_HBP_ADJ - t->hbp;
+        return left;
+}
+
+uint32_t        video_timing_clkdiv(const video_timing_t *t, uint32_t sys_khz, bool lcd)
+{
+        uint32_t div;
+
+        if (t->pclk_khz == 0)
+                return 0;
+        if (lcd) {
+                /* PIO runs at 2x pclk; any 16.8 divider will do */
+                div = ((uint64_t)sys_khz * 256 + t->pclk_khz) / (2 * t->pclk_khz);
+        } else {
+                /* pclk = clk_sys/n, i.e. a PIO divider of n/2 */
+                uint32_t n = (sys_khz + t->pclk_khz/2) / t->pclk_khz;
+                div = n * 128;
+        }
+        if (div < 256 || div > 0xffffff)
+                return 0;
+
+        /* Within 0.5% of the requested clock? */
+        uint64_t pio_hz = (uint64_t)sys_khz * 1000 * 256 / div;
+        uint64_t want_hz = (uint64_t)t->pclk_khz * 2000;
+        if (pio_hz * 200 < want_hz * 199 || pio_hz * 200 > want_hz * 201)
+                return 0;
+        return div;
+}
+
+unsigned int    video_timing_fb_x(const video_timing_t *t, unsigned int fb_w, bool lcd)
+{
+        return t->hsw + t->hbp + (lcd ? 0 : vga_left_border(t, fb_w));
+}
+
+unsigned int    video_timing_fb_y(const video_timing_t *t, unsigned int fb_h)
+{
+        return t->vsw + t->vbp + (t->vres - fb_h * t->scale)/2;
+}
+
+const char      *video_timing_check(const video_timing_t *t, unsigned int fb_w,
+                                    unsigned int fb_h, unsigned int bpp,
+                                    uint32_t sys_khz, bool lcd)
+{
+        if (t->pclk_khz == 0)
+                return "no pixel clock";
+        if (!video_timing_clkdiv(t, sys_khz, lcd))
+                return lcd ? "pixel clock out of range" :
+                        "pixel clock isn't clk_sys divided by an integer";
+        if (t->hres & 31)
+                return "HRES must be a multiple of 32";
+        if ((fb_w * bpp) & 31)
+                return "FB line must be a whole number of words";
+        if (t->scale != 1 && t->scale != 2)
+                return "scale must be 1 or 2";
+        if (fb_w * t->scale > t->hres || fb_h * t->scale > t->vres)
+                return "FB larger than display";
+        if (t->vsw == 0)
+                return "VSW must be at least 1 line";
+
+        if (lcd) {
+                /* DE frames the whole active area, so there's nowhere
+                 * to put a horizontal border:
+                 */
+                if (t->scale != 1)
+                        return "pio_lcd doesn't scale";
+                if (fb_w != t->hres)
+                        return "FB must be the panel width";
+                if (!field_ok(t->hsw, LCD_HSW_ADJ) || !field_ok(t->hbp, LCD_HBP_ADJ) ||
+                    !field_ok(t->hfp, LCD_HFP_ADJ))
+                        return "HSW/HBP/HFP out of range";
+        } else {
+                unsigned int left = vga_left_border(t, fb_w);
+                unsigned int right = t->hres - fb_w * t->scale - left;
+
+                if (!field_ok(t->hsw, VGA_HSW_ADJ) ||
+                    !field_ok(t->hbp + left, VGA_HBP_ADJ) ||
+                    !field_ok(t->hfp + right, VGA_HFP_ADJ))
+                        return "HSW/HBP/HFP out of range";
+        }
+        return NULL;
+}
+
+void    video_timing_cfg(const video_timing_t *t, unsigned int fb_w, bool lcd,
+                         uint32_t cfg[6])
+{
+        uint32_t w;
+
+        if (lcd) {
+                w = ((t->hsw - LCD_HSW_ADJ) << 23) |
+                        ((t->hbp - LCD_HBP_ADJ) << 15) |
+                        ((t->hfp - LCD_HFP_ADJ) << 7);
+                cfg[0] = w | CFG_VS;
+                cfg[2] = w;
+                cfg[4] = w | CFG_DE;
+        } else {
+                // FIXME: HBP/HFP are prob off by one or so, check
+                unsigned int left = vga_left_border(t, fb_w);
+                unsigned int right = t->hres - fb_w * t->scale - left;
+
+                w = ((t->hsw - VGA_HSW_ADJ) << 23) |
+                        ((t->hbp + left - VGA_HBP_ADJ) << 15) |
+                        ((t->hfp + right - VGA_HFP_ADJ) << 7);
+                cfg[0] = w | CFG_VS;
+                cfg[2] = w;
+                cfg[4] = w;
+        }
+        cfg[1] = cfg[3] = cfg[5] = fb_w - 1;
+}
+
+unsigned int    video_timing_line_pclks(const uint32_t cfg[2], unsigned int scale, bool lcd)
+{
+        unsigned int hsw = (cfg[0] >> 23) & CFG_FIELD_MAX;
+        unsigned int hbp = (cfg[0] >> 15) & CFG_FIELD_MAX;
+        unsigned int hfp = (cfg[0] >> 7) & CFG_FIELD_MAX;
+        unsigned int pixels = (cfg[1] + 1) * scale;
+
+        /* Every loop iteration is one pixel clock (2 PIO cycles), or scale
+         * pixel clocks for the pixel loop, and each loop runs for its field
+         * plus one.  The remaining instructions and extra iterations add up
+         * to 20 cycles for pio_video, and 22 for pio_lcd (which also reads
+         * the DE flag).
+         *
+         * Note pio_video's line is 2 pixel clocks longer than its nominal
+         * total (see the FIXME above); monitors are happy enough with that.
+         */
+        return hsw + hbp + hfp + pixels + (lcd ? 11 : 10);
+}
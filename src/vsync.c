@@ -0,0 +1,62 @@
+/*
+ * pico-umac vsync event delivery
+ *
+ * This converts a free-running count of real (scanned-out) frames into
+ * the guest's vsync events.  The guest's VBL interrupt is level-ish (a
+ * second event before the first is serviced is lost) so missed frames are
+ * fed in one per poll rather than in a burst.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vsync.h"
+
+void    vsync_init(vsync_t *v, uint32_t frame_count, unsigned int max_backlog)
+{
+        v->last_frame = frame_count;
+        v->pending = 0;
+        v->max_backlog = max_backlog;
+        v->delivered = 0;
+        v->missed = 0;
+}
+
+bool    vsync_poll(vsync_t *v, uint32_t frame_count)
+{
+        uint32_t elapsed = frame_count - v->last_frame;
+
+        if (elapsed == 0 && v->pending == 0)
+                return false;
+
+        v->last_frame = frame_count;
+        /* Up to max_backlog can be queued, plus the one about to be delivered: */
+        if (elapsed > v->max_backlog + 1 - v->pending) {
+                v->missed += elapsed - (v->max_backlog + 1 - v->pending);
+                v->pending = v->max_backlog + 1;
+        } else {
+                v->pending += elapsed;
+        }
+
+        v->pending--;
+        v->delivered++;
+        return true;
+}
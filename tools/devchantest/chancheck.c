@@ -0,0 +1,179 @@
+/*
+ * chancheck:  the device request channel (devchan.c), between two threads
+ *
+ * A client thread sends requests, each with a buffer, and checks that
+ * every response comes back in order with the result and the data that
+ * the server made from its request.  It sends both synchronous calls
+ * (as core 1's disc ops do) and bursts that fill the channel.  The server
+ * thread sometimes dawdles, so both sides see the channel empty and
+ * full.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devchan.h"
+
+#define BUF_SIZE                64
+
+static devchan_t ch;
+static unsigned int n_reqs = 200000;
+static unsigned int failures = 0;
+static uint8_t bufs[DEVCHAN_SIZE][BUF_SIZE];
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        rnd_state = rnd_state * 1103515245 + 12345;
+        return rnd_state >> 8;
+}
+
+static int32_t  expect(const devchan_req_t *r)
+{
+        return (int32_t)(r->offset * 3 + r->len + r->op + r->unit);
+}
+
+static void     *server(void *arg)
+{
+        uint32_t s = 7;
+        unsigned int served = 0;
+
+        while (served < n_reqs) {
+                devchan_req_t r;
+
+                if (!devchan_take(&ch, &r)) {
+                        devchan_wait();
+                        continue;
+                }
+                s = s * 1103515245 + 12345;
+                if ((s >> 16) % 16 == 0)
+                        for (unsigned int i = 0; i < (s >> 20) % 4; i++)
+                                sched_yield();
+                for (unsigned int i = 0; i < r.len; i++)
+                        r.data[i] = r.offset + i;
+                devchan_resp_t resp = { .result = expect(&r) };
+                devchan_reply(&ch, &resp);
+                served++;
+        }
+        return NULL;
+}
+
+static void     check(const devchan_req_t *r, int32_t result, unsigned int n)
+{
+        if (result != expect(r)) {
+                if (failures++ < 10)
+                        printf("FAIL: request %u:  result %d, not %d\n", n, result, expect(r));
+                return;
+        }
+        for (unsigned int i = 0; i < r->len; i++) {
+                if (r->data[i] != (uint8_t)(r->offset + i)) {
+                        if (failures++ < 10)
+                                printf("FAIL: request %u:  data[%u] is %02x\n", n, i, r->data[i]);
+                        return;
+                }
+        }
+}
+
+static void     make_req(devchan_req_t *r, uint8_t *buf)
+{
+        *r = (devchan_req_t){ .op = 1 + rnd() % 2, .unit = rnd() % 2, .data = buf,
+                              .offset = rnd(), .len = 1 + rnd() % BUF_SIZE };
+        memset(buf, 0, BUF_SIZE);
+}
+
+int     main(int argc, char *argv[])
+{
+        pthread_t t;
+        unsigned int n = 0;
+        unsigned int burst_reqs = 0;
+
+        if (argc > 1)
+                n_reqs = atoi(argv[1]);
+        devchan_init(&ch);
+        if (pthread_create(&t, NULL, server, NULL) != 0) {
+                perror("pthread_create");
+                return 1;
+        }
+
+        while (n < n_reqs) {
+                if (rnd() % 4) {
+                        devchan_req_t r;
+
+                        make_req(&r, bufs[0]);
+                        check(&r, devchan_call(&ch, &r), n++);
+                        continue;
+                }
+                /* A burst:  fill the channel, then collect the responses */
+                devchan_req_t rs[DEVCHAN_SIZE];
+                unsigned int sent = 0;
+                unsigned int want = 1 + rnd() % DEVCHAN_SIZE;
+
+                while (sent < want && n + sent < n_reqs) {
+                        make_req(&rs[sent], bufs[sent]);
+                        if (!devchan_send(&ch, &rs[sent])) {
+                                printf("FAIL: send %u of a burst refused\n", sent);
+                                failures++;
+                                break;
+                        }
+                        sent++;
+                }
+                if (sent == DEVCHAN_SIZE) {
+                        devchan_req_t extra;
+
+                        make_req(&extra, bufs[0]);
+                        /* Full:  none of the burst has been received yet */
+                        if (devchan_send(&ch, &extra)) {
+                                printf("FAIL: a full channel took another request\n");
+                                failures++;
+                        }
+                }
+                for (unsigned int i = 0; i < sent; i++) {
+                        devchan_resp_t resp;
+
+                        while (!devchan_receive(&ch, &resp))
+                                devchan_wait();
+                        check(&rs[i], resp.result, n++);
+                }
+                burst_reqs += sent;
+        }
+        pthread_join(t, NULL);
+
+        devchan_resp_t resp;
+        if (devchan_receive(&ch, &resp) || devchan_pending(&ch)) {
+                printf("FAIL: the channel isn't empty at the end\n");
+                failures++;
+        }
+        if (failures) {
+                printf("chancheck:  %u failures\n", failures);
+                return 1;
+        }
+        printf("chancheck:  %u requests OK (%u in bursts of up to %u, %u calls waited for)\n",
+               n, burst_reqs, DEVCHAN_SIZE, ch.waits);
+        return 0;
+}
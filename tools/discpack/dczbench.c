@@ -0,0 +1,188 @@
+/*
+ * dczbench:  read throughput of a compressed disc
+ *
+ * Packs a disc image (or a synthetic one), then times reads through the
+ * firmware's reader in the patterns a guest makes:  sequential runs of
+ * sectors or large requests, and random sectors.  Each is compared with
+ * reading the unpacked image (a memcpy, as the flash backend does), and
+ * the cache's hit rate is shown.  On a host, it's the ratios that mean
+ * something.
+ *
+ *      dczbench [-b <block size>] [-c <cache KB>] [-m <MB per test>] [disc.bin]
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "discz.h"
+#include "pack.h"
+
+#define TEST_DISC_SIZE          (3 * 1024 * 1024)
+
+static uint8_t  cache[DISCZ_MAX_SLOTS * DISCZ_MAX_BLOCK];
+static uint8_t  buf[65536];
+
+typedef struct {
+        const char      *name;
+        unsigned int    len;            /* Bytes per read */
+        bool            random;
+} pattern_t;
+
+static const pattern_t patterns[] = {
+        { "sequential 512B", 512, false },
+        { "sequential 4KB", 4096, false },
+        { "sequential 64KB", 65536, false },
+        { "random 512B", 512, true },
+        { "random 4KB", 4096, true },
+};
+
+static int      raw_read(void *ctx, uint8_t *data, unsigned int offset, unsigned int len)
+{
+        memcpy(data, (const uint8_t *)ctx + offset, len);
+        return 0;
+}
+
+static double   now(void)
+{
+        struct timespec t;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* MB/s reading total bytes in a pattern */
+static double   run(const pattern_t *p, int (*rd)(void *, uint8_t *, unsigned int, unsigned int),
+                    void *ctx, uint32_t size, uint64_t total)
+{
+        uint32_t s = 1, off = 0;
+        unsigned int sectors = (size - p->len) / 512 + 1;
+        double t0 = now();
+
+        for (uint64_t done = 0; done < total; done += p->len) {
+                if (p->random) {
+                        s = s * 1103515245 + 12345;
+                        off = (s >> 8) % sectors * 512;
+                } else if (off + p->len > size) {
+                        off = 0;
+                }
+                if (rd(ctx, buf, off, p->len) < 0) {
+                        fprintf(stderr, "dczbench: read of %u at %u failed\n", p->len, off);
+                        exit(1);
+                }
+                if (!p->random)
+                        off += p->len;
+        }
+        return total / (now() - t0) / 1e6;
+}
+
+int     main(int argc, char *argv[])
+{
+        unsigned int block_size = 4096, cache_kb = 16, mb = 64;
+        uint8_t *disc;
+        size_t size;
+        int c;
+
+        while ((c = getopt(argc, argv, "b:c:m:")) != -1) {
+                switch (c) {
+                case 'b':
+                        block_size = atoi(optarg);
+                        break;
+                case 'c':
+                        cache_kb = atoi(optarg);
+                        break;
+                case 'm':
+                        mb = atoi(optarg);
+                        break;
+                default:
+                        fprintf(stderr, "Usage: dczbench [-b <block size>] [-c <cache KB>] "
+                                "[-m <MB per test>] [disc.bin]\n");
+                        return 1;
+                }
+        }
+        if (optind < argc) {
+                FILE *f = fopen(argv[optind], "rb");
+                if (!f || fseek(f, 0, SEEK_END) != 0) {
+                        perror(argv[optind]);
+                        return 1;
+                }
+                size = ftell(f);
+                rewind(f);
+                disc = malloc(size);
+                if (!disc || fread(disc, 1, size, f) != size) {
+                        perror(argv[optind]);
+                        return 1;
+                }
+                fclose(f);
+        } else {
+                size = TEST_DISC_SIZE;
+                disc = malloc(size);
+                pack_test_disc(disc, size, 42);
+        }
+        if (size < 65536) {
+                fprintf(stderr, "dczbench: the disc's too small\n");
+                return 1;
+        }
+
+        size_t len;
+        double t0 = now();
+        uint8_t *img = pack_image(disc, size, block_size, &len);
+        double pack_secs = now() - t0;
+        discz_t z;
+        if (!img || discz_open(&z, img, len, cache, cache_kb * 1024) < 0) {
+                fprintf(stderr, "dczbench: can't pack (block size %u, cache %uKB)\n",
+                        block_size, cache_kb);
+                return 1;
+        }
+        printf("dczbench: %zu bytes, packed to %zu (%.1f%%) in %.2fs; %uKB blocks, %u cached\n",
+               size, len, 100.0 * len / size, pack_secs, block_size / 1024, z.slots);
+
+        /* Every block, decompressed whole */
+        t0 = now();
+        uint64_t out = 0;
+        for (unsigned int r = 0; out < (uint64_t)mb * 1000000; r++)
+                for (uint32_t off = 0; off + block_size <= size; off += block_size) {
+                        discz_read(&z, buf, off, block_size);
+                        out += block_size;
+                }
+        printf("  %-18s %8.1fMB/s\n", "whole blocks", out / (now() - t0) / 1e6);
+
+        for (unsigned int i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+                const pattern_t *p = &patterns[i];
+                uint64_t total = (uint64_t)mb * 1000000;
+                uint32_t hits = z.hits, misses = z.misses;
+
+                double raw = run(p, raw_read, disc, size, total);
+                double packed = run(p, discz_read, &z, size, total);
+                hits = z.hits - hits;
+                misses = z.misses - misses;
+                printf("  %-18s %8.1fMB/s, unpacked %8.1fMB/s (%4.1f%%); %.1f%% cache hits\n",
+                       p->name, packed, raw, 100.0 * packed / raw,
+                       hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+        }
+        return 0;
+}
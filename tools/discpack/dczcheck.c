@@ -0,0 +1,302 @@
+/*
+ * dczcheck:  the compressed disc codec and reader
+ *
+ * Round-trips data through the compressor and the firmware's decoder,
+ * checks a hand-made LZ4 block, and that corrupt blocks are refused
+ * without writing past the output.  Then packs a synthetic disc, checks
+ * that random reads (any offset and length) through the reader match it
+ * for each block and cache size, that the cache is LRU, and that bad
+ * images and reads are refused.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discz.h"
+#include "pack.h"
+
+#define MAX_LEN                 65536
+#define GUARD                   64
+#define DISC_SIZE               (3 * 1024 * 1024 + 1536)
+
+static uint8_t  in[MAX_LEN], comp[MAX_LEN + MAX_LEN / 255 + 16], out[MAX_LEN + GUARD];
+static uint8_t  cache[DISCZ_MAX_SLOTS * DISCZ_MAX_BLOCK];
+static unsigned int failures = 0, checks = 0;
+
+#define CHECK(c, ...)   do {                                    \
+                checks++;                                       \
+                if (!(c)) {                                     \
+                        printf("FAIL: " __VA_ARGS__);           \
+                        printf("\n");                           \
+                        failures++;                             \
+                }                                               \
+        } while (0)
+
+static void     fill(uint8_t *b, unsigned int len, unsigned int kind)
+{
+        switch (kind) {
+        case 0:                 /* Noise */
+                for (unsigned int i = 0; i < len; i++)
+                        b[i] = rand();
+                break;
+        case 1:                 /* Zeroes */
+                memset(b, 0, len);
+                break;
+        case 2:                 /* A short repeat (overlapping matches) */
+                for (unsigned int i = 0; i < len; i++)
+                        b[i] = "abc"[i % 3];
+                break;
+        case 3:                 /* Long runs, and matches far back */
+                for (unsigned int i = 0; i < len; i++)
+                        b[i] = (i / 300) % 7 == 3 ? rand() : (i % 4096) / 256;
+                break;
+        default:                /* Disc-like */
+                pack_test_disc(b, len, kind);
+                break;
+        }
+}
+
+/* LZ4's rules for the end of a block:  the last sequence has at least 5
+ * literals (or all of a short block), and no match starts in the last 12
+ * bytes.  So other LZ4 decoders can read it.
+ */
+static bool     end_rules_ok(const uint8_t *c, unsigned int clen, unsigned int len)
+{
+        const uint8_t *ip = c, *iend = c + clen;
+        unsigned int pos = 0, lit = 0;
+
+        while (ip < iend) {
+                unsigned int token = *ip++, b;
+
+                lit = token >> 4;
+                if (lit == 15)
+                        do lit += b = *ip++; while (b == 255);
+                ip += lit;
+                pos += lit;
+                if (ip >= iend)
+                        break;
+                if (pos + 12 > len)
+                        return false;
+                ip += 2;
+                unsigned int m = token & 15;
+                if (m == 15)
+                        do m += b = *ip++; while (b == 255);
+                pos += m + 4;
+        }
+        return lit >= (len < 5 ? len : 5);
+}
+
+static void     check_roundtrip(void)
+{
+        static const unsigned int lens[] = { 1, 5, 12, 13, 17, 100, 511, 4096, 8192, MAX_LEN };
+
+        for (unsigned int kind = 0; kind < 6; kind++) {
+                for (unsigned int l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+                        unsigned int len = lens[l];
+
+                        fill(in, len, kind);
+                        unsigned int c = pack_compress(in, len, comp, sizeof(comp));
+                        CHECK(c, "kind %u len %u didn't compress", kind, len);
+                        if (!c)
+                                continue;
+                        CHECK(end_rules_ok(comp, c, len),
+                              "kind %u len %u breaks LZ4's end rules", kind, len);
+                        memset(out, 0x5a, sizeof(out));
+                        CHECK(discz_decompress(comp, c, out, len) == 0 &&
+                              memcmp(in, out, len) == 0,
+                              "kind %u len %u didn't round-trip", kind, len);
+                        CHECK(out[len] == 0x5a, "kind %u len %u wrote past the end", kind, len);
+                        /* Too small a buffer, or too big, is refused */
+                        CHECK(discz_decompress(comp, c, out, len - 1) < 0,
+                              "kind %u len %u decoded short", kind, len);
+                        CHECK(discz_decompress(comp, c, out, len + 1) < 0,
+                              "kind %u len %u decoded long", kind, len);
+                        /* Compressing into less space than it needs */
+                        if (c > 1)
+                                CHECK(pack_compress(in, len, comp, c - 1) == 0,
+                                      "kind %u len %u overflowed its output", kind, len);
+                }
+        }
+}
+
+static void     check_known(void)
+{
+        /* "abc", then 9 bytes from 3 back, then "xyzzy" */
+        static const uint8_t blk[] = { 0x35, 'a', 'b', 'c', 3, 0, 0x50, 'x', 'y', 'z', 'z', 'y' };
+        static const char want[] = "abcabcabcabcxyzzy";
+
+        CHECK(discz_decompress(blk, sizeof(blk), out, 17) == 0 && memcmp(out, want, 17) == 0,
+              "the known block didn't decode");
+}
+
+static void     check_corrupt(void)
+{
+        unsigned int refused = 0;
+
+        fill(in, 4096, 5);
+        unsigned int c = pack_compress(in, 4096, comp, sizeof(comp));
+        for (unsigned int n = 0; n < 20000; n++) {
+                uint8_t bad[sizeof(comp)];
+                unsigned int len = c;
+
+                memcpy(bad, comp, c);
+                switch (n % 3) {
+                case 0:
+                        len = rand() % c;
+                        break;
+                case 1:
+                        bad[rand() % c] = rand();
+                        break;
+                default:
+                        for (unsigned int i = 0; i < c; i++)
+                                bad[i] = rand();
+                        break;
+                }
+                memset(out, 0x5a, sizeof(out));
+                refused += discz_decompress(bad, len, out, 4096) < 0;
+                for (unsigned int i = 4096; i < 4096 + GUARD; i++) {
+                        if (out[i] != 0x5a) {
+                                CHECK(0, "corrupt block %u wrote past the end", n);
+                                break;
+                        }
+                }
+        }
+        CHECK(refused > 10000, "only %u of 20000 corrupt blocks refused", refused);
+}
+
+static void     check_reads(const uint8_t *disc, uint32_t block_size, unsigned int slots)
+{
+        size_t len;
+        uint8_t *img = pack_image(disc, DISC_SIZE, block_size, &len);
+        discz_t z;
+
+        CHECK(discz_open(&z, img, len, cache, slots * block_size) == 0 &&
+              z.slots == slots && z.size == DISC_SIZE,
+              "%u-byte blocks, %u slots:  didn't open", block_size, slots);
+        for (unsigned int n = 0; n < 3000; n++) {
+                unsigned int rlen = n % 2 ? (1 + rand() % 64) * 512 : rand() % (3 * block_size);
+                unsigned int off = rand() % (DISC_SIZE - rlen + 1);
+                static uint8_t buf[3 * DISCZ_MAX_BLOCK * 64];
+
+                if (n % 2)
+                        off &= ~511;
+                if (discz_read(&z, buf, off, rlen) < 0 || memcmp(buf, disc + off, rlen) != 0) {
+                        CHECK(0, "%u-byte blocks, %u slots:  read of %u at %u is wrong",
+                              block_size, slots, rlen, off);
+                        break;
+                }
+        }
+        /* The last byte, and past the end */
+        uint8_t b;
+        CHECK(discz_read(&z, &b, DISC_SIZE - 1, 1) == 0 && b == disc[DISC_SIZE - 1],
+              "the last byte's wrong");
+        CHECK(discz_read(&z, &b, DISC_SIZE, 1) < 0 && discz_read(&z, &b, 0xffffffff, 2) < 0,
+              "a read past the end succeeded");
+        CHECK(z.errors == 0, "%u read errors", z.errors);
+        free(img);
+}
+
+/* With 2 slots:  A B A C evicts B, so A then hits and B misses */
+static void     check_lru(void)
+{
+        static uint8_t disc[8 * 4096];
+        size_t len;
+        discz_t z;
+        uint8_t b;
+
+        fill(disc, sizeof(disc), 3);
+        uint8_t *img = pack_image(disc, sizeof(disc), 4096, &len);
+        discz_open(&z, img, len, cache, 2 * 4096 + 100);
+        CHECK(z.slots == 2, "%u slots, not 2", z.slots);
+        static const unsigned int seq[] = { 0, 1, 0, 2, 0, 1 };
+        static const unsigned int hits[] = { 0, 0, 1, 1, 2, 2 };
+        for (unsigned int i = 0; i < 6; i++) {
+                discz_read(&z, &b, seq[i] * 4096 + 7, 1);
+                CHECK(z.hits == hits[i] && z.misses == i + 1 - hits[i],
+                      "LRU step %u:  %u hits, %u misses", i, z.hits, z.misses);
+        }
+        /* A whole block's read past the cache */
+        static uint8_t blk[4096];
+        discz_read(&z, blk, 3 * 4096, 4096);
+        CHECK(z.direct == 1 && z.misses == 4 && !memcmp(blk, disc + 3 * 4096, 4096),
+              "a whole-block read went through the cache");
+        free(img);
+}
+
+static void     check_bad_images(void)
+{
+        static uint8_t disc[5 * 4096];
+        size_t len;
+        discz_t z;
+
+        fill(disc, sizeof(disc), 4);
+        uint8_t *img = pack_image(disc, sizeof(disc), 4096, &len);
+        uint8_t *bad = malloc(len);
+
+        CHECK(discz_open(&z, img, len, cache, 4096) == 0, "the good image didn't open");
+        CHECK(discz_open(&z, img, len, cache, 4095) < 0, "opened with no room for a block");
+        CHECK(discz_open(&z, img, 30, cache, 4096) < 0, "a truncated index opened");
+        CHECK(discz_open(&z, img, len - 1, cache, 4096) < 0, "truncated data opened");
+        memcpy(bad, img, len);
+        bad[0] = 'X';
+        CHECK(discz_open(&z, bad, len, cache, 4096) < 0, "a bad magic opened");
+        memcpy(bad, img, len);
+        bad[8] = 0x30;          /* Block size 12KB */
+        CHECK(discz_open(&z, bad, len, cache, 16384) < 0, "a bad block size opened");
+        memcpy(bad, img, len);
+        bad[12] = 9;            /* Too many blocks for the size */
+        CHECK(discz_open(&z, bad, len, cache, 4096) < 0, "a bad block count opened");
+        memcpy(bad, img, len);
+        bad[DISCZ_HDR_SIZE + 11] = 0x7f;        /* Block 2 past the end */
+        CHECK(discz_open(&z, bad, len, cache, 4096) < 0, "a bad index opened");
+        free(bad);
+        free(img);
+}
+
+int     main(int argc, char *argv[])
+{
+        static uint8_t disc[DISC_SIZE];
+
+        srand(1);
+        check_roundtrip();
+        check_known();
+        check_corrupt();
+
+        pack_test_disc(disc, DISC_SIZE, 42);
+        for (unsigned int bs = 4096; bs <= 8192; bs *= 2)
+                for (unsigned int slots = 1; slots <= DISCZ_MAX_SLOTS; slots *= 4)
+                        check_reads(disc, bs, slots);
+        check_lru();
+        check_bad_images();
+
+        if (failures) {
+                printf("dczcheck:  %u of %u checks failed\n", failures, checks);
+                return 1;
+        }
+        printf("dczcheck:  %u checks OK\n", checks);
+        return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * discpack:  pack a disc image as independently-compressed blocks
+ *
+ * For a USE_DISCZ build's flash image (see include/discz.h):
+ *
+ *      discpack [-b <block size>] disc.bin disc.dcz
+ *      discpack -x disc.dcz disc.bin
+ *
+ * -x unpacks, through the firmware's reader, so also checks an image.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "discz.h"
+#include "pack.h"
+
+static uint8_t  *read_file(const char *name, size_t *len)
+{
+        FILE *f = fopen(name, "rb");
+        uint8_t *buf = NULL;
+        long n;
+
+        if (!f || fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) < 0) {
+                perror(name);
+                exit(1);
+        }
+        rewind(f);
+        buf = malloc(n ? n : 1);
+        if (!buf || fread(buf, 1, n, f) != (size_t)n) {
+                perror(name);
+                exit(1);
+        }
+        fclose(f);
+        *len = n;
+        return buf;
+}
+
+static void     write_file(const char *name, const uint8_t *buf, size_t len)
+{
+        FILE *f = fopen(name, "wb");
+
+        if (!f || fwrite(buf, 1, len, f) != len || fclose(f) != 0) {
+                perror(name);
+                exit(1);
+        }
+}
+
+static int      unpack(const char *in, const char *out)
+{
+        static uint8_t cache[DISCZ_MAX_BLOCK];
+        size_t len;
+        uint8_t *img = read_file(in, &len);
+        discz_t z;
+
+        if (discz_open(&z, img, len, cache, sizeof(cache)) < 0) {
+                fprintf(stderr, "%s: not a packed disc image\n", in);
+                return 1;
+        }
+        uint8_t *disc = malloc(z.size ? z.size : 1);
+        if (!disc || discz_read(&z, disc, 0, z.size) < 0) {
+                fprintf(stderr, "%s: corrupt\n", in);
+                return 1;
+        }
+        write_file(out, disc, z.size);
+        printf("%s: %u bytes, in %u %uKB blocks\n", in, (unsigned int)z.size,
+               (unsigned int)z.blocks, (unsigned int)z.block_size / 1024);
+        return 0;
+}
+
+int     main(int argc, char *argv[])
+{
+        unsigned int block_size = 4096;
+        int x = 0, c;
+
+        while ((c = getopt(argc, argv, "b:x")) != -1) {
+                switch (c) {
+                case 'b':
+                        block_size = atoi(optarg);
+                        break;
+                case 'x':
+                        x = 1;
+                        break;
+                default:
+                        goto usage;
+                }
+        }
+        if (argc - optind != 2)
+                goto usage;
+        if (x)
+                return unpack(argv[optind], argv[optind + 1]);
+        if (block_size != 4096 && block_size != 8192) {
+                fprintf(stderr, "discpack: the block size is 4096 or 8192\n");
+                return 1;
+        }
+
+        size_t len, out_len;
+        uint8_t *disc = read_file(argv[optind], &len);
+        if (len > 0xffffffffu - block_size) {
+                fprintf(stderr, "%s: too big\n", argv[optind]);
+                return 1;
+        }
+        uint8_t *img = pack_image(disc, len, block_size, &out_len);
+        if (!img) {
+                perror("discpack");
+                return 1;
+        }
+        write_file(argv[optind + 1], img, out_len);
+
+        /* What became of the blocks: */
+        unsigned int blocks = (len + block_size - 1) / block_size, zero = 0, stored = 0;
+        for (unsigned int b = 0; b < blocks; b++) {
+                const uint8_t *ix = img + DISCZ_HDR_SIZE + b * 4;
+                uint32_t s = ix[0] | ix[1] << 8 | ix[2] << 16 | (uint32_t)ix[3] << 24;
+                uint32_t e = ix[4] | ix[5] << 8 | ix[6] << 16 | (uint32_t)ix[7] << 24;
+                uint32_t blen = len - b * block_size < block_size ? len - b * block_size : block_size;
+                zero += e == s;
+                stored += e - s == blen;
+        }
+        printf("%s: %zu bytes in %u %uKB blocks -> %zu (%.1f%%), %u zero, %u stored\n",
+               argv[optind], len, blocks, block_size / 1024, out_len,
+               len ? 100.0 * out_len / len : 0.0, zero, stored);
+        return 0;
+
+usage:
+        fprintf(stderr, "Usage: discpack [-b <block size>] disc.bin disc.dcz\n"
+                "       discpack -x disc.dcz disc.bin\n");
+        return 1;
+}
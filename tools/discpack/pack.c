@@ -0,0 +1,224 @@
+/*
+ * discpack:  LZ4 block compression, and packing disc images
+ *
+ * The compressor's greedy, finding matches through a hash of the next 4
+ * bytes; that's plenty for disc images, which are mostly zeroes, code and
+ * resources.  It follows LZ4's rules for the end of a block (the last 5
+ * bytes are literals, and no match starts in the last 12), so a standard
+ * LZ4 decoder can read its output too.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pack.h"
+#include "discz.h"
+
+#define MINMATCH        4
+#define LASTLITERALS    5
+#define MFLIMIT         12
+#define HASH_BITS       13
+#define MAX_OFFSET      65535
+
+static uint32_t hash4(const uint8_t *p)
+{
+        uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* An LZ4 length over 15:  255s, then the remainder */
+static unsigned int     put_len(uint8_t *out, unsigned int op, unsigned int len)
+{
+        for (; len >= 255; len -= 255)
+                out[op++] = 255;
+        out[op++] = len;
+        return op;
+}
+
+/* Emit a sequence:  literals [anchor, ip), then (unless last) a match */
+static unsigned int     put_seq(const uint8_t *in, unsigned int anchor, unsigned int ip,
+                                unsigned int off, unsigned int mlen, bool last,
+                                uint8_t *out, unsigned int op, unsigned int out_max)
+{
+        unsigned int lit = ip - anchor;
+
+        /* Worst case:  token, literal length, literals, offset, match length */
+        if (op + 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1 > out_max)
+                return 0;
+        unsigned int token = op++;
+        out[token] = (lit < 15 ? lit : 15) << 4;
+        if (lit >= 15)
+                op = put_len(out, op, lit - 15);
+        memcpy(out + op, in + anchor, lit);
+        op += lit;
+        if (last)
+                return op;
+        out[op++] = off;
+        out[op++] = off >> 8;
+        mlen -= MINMATCH;
+        out[token] |= mlen < 15 ? mlen : 15;
+        if (mlen >= 15)
+                op = put_len(out, op, mlen - 15);
+        return op;
+}
+
+unsigned int    pack_compress(const uint8_t *in, unsigned int len, uint8_t *out, unsigned int out_max)
+{
+        int32_t table[1 << HASH_BITS];
+        unsigned int ip = 0, anchor = 0, op = 0;
+
+        for (unsigned int i = 0; i < (1 << HASH_BITS); i++)
+                table[i] = -1;
+
+        if (len > MFLIMIT) {
+                unsigned int limit = len - MFLIMIT;
+
+                while (ip < limit) {
+                        uint32_t h = hash4(in + ip);
+                        int32_t ref = table[h];
+
+                        table[h] = ip;
+                        if (ref < 0 || ip - ref > MAX_OFFSET || memcmp(in + ref, in + ip, MINMATCH)) {
+                                ip++;
+                                continue;
+                        }
+                        /* Extend it forwards (stopping short of the last
+                         * literals) and back
+                         */
+                        unsigned int mlen = MINMATCH;
+                        unsigned int max = len - LASTLITERALS - ip;
+                        while (mlen < max && in[ref + mlen] == in[ip + mlen])
+                                mlen++;
+                        while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+                                ip--;
+                                ref--;
+                                mlen++;
+                        }
+                        op = put_seq(in, anchor, ip, ip - ref, mlen, false, out, op, out_max);
+                        if (!op)
+                                return 0;
+                        ip += mlen;
+                        anchor = ip;
+                        /* So the next match can follow on */
+                        if (ip - 2 < limit)
+                                table[hash4(in + ip - 2)] = ip - 2;
+                }
+        }
+        return put_seq(in, anchor, len, 0, 0, true, out, op, out_max);
+}
+
+static void     put32(uint8_t *p, uint32_t v)
+{
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+}
+
+uint8_t         *pack_image(const uint8_t *disc, uint32_t size, uint32_t block_size, size_t *out_len)
+{
+        uint32_t blocks = (size + block_size - 1) / block_size;
+        size_t data = DISCZ_HDR_SIZE + ((size_t)blocks + 1) * 4;
+        /* At worst, every block's stored */
+        uint8_t *img = malloc(data + size);
+        size_t op = data;
+
+        if (!img)
+                return NULL;
+        memcpy(img, DISCZ_MAGIC, 4);
+        put32(img + 4, size);
+        put32(img + 8, block_size);
+        put32(img + 12, blocks);
+
+        for (uint32_t b = 0; b < blocks; b++) {
+                const uint8_t *in = disc + (size_t)b * block_size;
+                uint32_t len = size - b * block_size < block_size ? size - b * block_size : block_size;
+                uint32_t i;
+
+                put32(img + DISCZ_HDR_SIZE + b * 4, op);
+                for (i = 0; i < len && !in[i]; i++)
+                        ;
+                if (i == len)
+                        continue;       /* Zeroes:  no data */
+                /* Stored, unless compressing saves something */
+                unsigned int c = pack_compress(in, len, img + op, len - 1);
+                if (!c) {
+                        memcpy(img + op, in, len);
+                        c = len;
+                }
+                op += c;
+        }
+        put32(img + DISCZ_HDR_SIZE + blocks * 4, op);
+        *out_len = op;
+        return img;
+}
+
+void            pack_test_disc(uint8_t *disc, uint32_t size, uint32_t seed)
+{
+        static const struct {
+                const char      *b;
+                unsigned int    len;
+        } words[] = {
+                { "\x4e\x56", 2 }, { "\x4e\x5e\x4e\x75", 4 }, { "\x2f\x0b", 2 },
+                { "\x20\x6e\x00\x08", 4 }, { "\xa9\xf0", 2 }, { "\x48\xe7\x1f\x38", 4 },
+                { "\x70\x00", 2 }, { "\x60\x00", 2 }, { "Macintosh", 9 }, { "System", 6 },
+                { "Finder", 6 }, { "\0\0\0\0\xff\xff", 6 },
+        };
+        uint32_t s = seed;
+
+        for (uint32_t i = 0; i < size; i += 512) {
+                uint32_t n = size - i < 512 ? size - i : 512;
+                uint8_t *p = disc + i;
+
+                s = s * 1103515245 + 12345;
+                switch ((s >> 16) % 5) {
+                case 0:
+                case 1:
+                        memset(p, 0, n);
+                        break;
+                case 2:
+                        for (uint32_t j = 0; j < n; j++) {
+                                s = s * 1103515245 + 12345;
+                                p[j] = s >> 16;
+                        }
+                        break;
+                default:
+                        /* Words, and a random byte in every few */
+                        for (uint32_t j = 0; j < n;) {
+                                s = s * 1103515245 + 12345;
+                                if ((s >> 8) % 4 == 0) {
+                                        p[j++] = s >> 24;
+                                        continue;
+                                }
+                                unsigned int w = (s >> 16) % 12;
+                                for (unsigned int k = 0; k < words[w].len && j < n; k++)
+                                        p[j++] = words[w].b[k];
+                        }
+                        break;
+                }
+        }
+}
@@ -0,0 +1,48 @@
+/*
+ * discpack:  LZ4 block compression, and packing disc images
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compress len bytes (at most 64KB) in LZ4's block format.  Returns the
+ * compressed length, or 0 if it doesn't fit in out_max.
+ */
+unsigned int    pack_compress(const uint8_t *in, unsigned int len, uint8_t *out, unsigned int out_max);
+
+/* Pack a disc image (see include/discz.h) in blocks of block_size.
+ * Returns a malloc()ed image, and its length in *out_len.
+ */
+uint8_t         *pack_image(const uint8_t *disc, uint32_t size, uint32_t block_size, size_t *out_len);
+
+/* A synthetic disc for the tests and benchmark:  sectors of zeroes, of
+ * noise, and of words from a small vocabulary (like code and resources)
+ */
+void            pack_test_disc(uint8_t *disc, uint32_t size, uint32_t seed);
+
+#endif
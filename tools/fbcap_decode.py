@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+#
+# Decode a pico-umac framebuffer capture stream (USE_FBCAP) into images
+#
+# Reads the stdio UART output (from a serial device, a file or stdin),
+# reconstructs the framebuffer from the row updates, and writes it as a PBM
+# after each update.  Other (console) text is passed through to stderr.
+# See include/fbcap.h for the format.
+#
+# Usage: fbcap_decode.py [-b baud] [-o screen.pbm] <device|file|->
+#
+# Copyright 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+SYNC = b'\xfb\xca'
+HDR = 5
+MAX_PAYLOAD = 4096
+
+
+def crc16(data, crc=0xffff):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xffff
+    return crc
+
+
+def unpackbits(data, length):
+    out = bytearray()
+    i = 0
+    while i < len(data) and len(out) < length:
+        n = data[i]
+        i += 1
+        if n < 128:
+            out += data[i:i + n + 1]
+            i += n + 1
+        elif n > 128:
+            out += bytes([data[i]]) * (257 - n)
+            i += 1
+    return bytes(out)
+
+
+class Decoder:
+    def __init__(self, image_path, text_out):
+        self.image_path = image_path
+        self.text_out = text_out
+        self.buf = bytearray()
+        self.width = self.height = 0
+        self.fb = None
+        self.bad = 0
+        self.rows_seen = set()
+        self.t0 = None
+        self.bytes0 = 0
+
+    def feed(self, data):
+        self.buf += data
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                # Keep a possible partial marker
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self.text(self.buf[:len(self.buf) - keep])
+                del self.buf[:len(self.buf) - keep]
+                return
+            if i:
+                self.text(self.buf[:i])
+                del self.buf[:i]
+            if len(self.buf) < HDR:
+                return
+            ptype = self.buf[2]
+            plen = self.buf[3] | (self.buf[4] << 8)
+            if plen > MAX_PAYLOAD:
+                self.resync()
+                continue
+            if len(self.buf) < HDR + plen + 2:
+                return
+            payload = bytes(self.buf[HDR:HDR + plen])
+            crc = self.buf[HDR + plen] | (self.buf[HDR + plen + 1] << 8)
+            if crc != crc16(self.buf[2:HDR + plen]):
+                self.resync()
+                continue
+            del self.buf[:HDR + plen + 2]
+            self.packet(ptype, payload)
+
+    def resync(self):
+        # Not a packet after all (or corrupted by console text)
+        self.bad += 1
+        self.text(self.buf[:1])
+        del self.buf[:1]
+
+    def text(self, data):
+        if data and self.text_out:
+            self.text_out.write(data.decode('latin-1'))
+            self.text_out.flush()
+
+    def packet(self, ptype, payload):
+        if ptype == ord('F'):
+            seq, w, h, flags = struct.unpack('<IHHB', payload)
+            if (w, h) != (self.width, self.height):
+                self.width, self.height = w, h
+                self.fb = [bytes(w // 8) for _ in range(h)]
+                self.rows_seen = set()
+        elif ptype == ord('R') and self.fb is not None:
+            row = payload[0] | (payload[1] << 8)
+            if row < self.height:
+                self.fb[row] = unpackbits(payload[2:], self.width // 8).ljust(self.width // 8, b'\0')
+                self.rows_seen.add(row)
+        elif ptype == ord('E') and self.fb is not None:
+            seq, rows, pending, total, captures, busy_us = struct.unpack('<IHHIII', payload)
+            now = time.time()
+            if self.t0 is None:
+                self.t0, self.bytes0 = now, total
+            rate = (total - self.bytes0) / (now - self.t0) if now > self.t0 else 0
+            sys.stderr.write('[fbcap] update %u: %u rows (%u pending), %u/%u rows known, '
+                             '%.1fKB/s, %uus/capture, %u bad packets\n' %
+                             (seq, rows, pending, len(self.rows_seen), self.height,
+                              rate / 1024, busy_us // max(captures - 1, 1), self.bad))
+            self.write_image()
+
+    def write_image(self):
+        if not self.image_path:
+            return
+        tmp = self.image_path + '.tmp'
+        with open(tmp, 'wb') as f:
+            f.write(b'P4\n%d %d\n' % (self.width, self.height))
+            for row in self.fb:
+                f.write(row)
+        os.replace(tmp, self.image_path)
+
+
+def open_input(path, baud):
+    if path == '-':
+        return sys.stdin.buffer
+    if os.path.exists(path) and not os.path.isfile(path):
+        try:
+            import serial
+            return serial.Serial(path, baud, timeout=0.1)
+        except ImportError:
+            os.system('stty -F %s %d raw -echo' % (path, baud))
+    return open(path, 'rb', buffering=0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Decode a pico-umac framebuffer capture stream')
+    ap.add_argument('input', help='Serial device, capture file, or - for stdin')
+    ap.add_argument('-b', '--baud', type=int, default=115200)
+    ap.add_argument('-o', '--output', default='screen.pbm', help='Image written after each update')
+    args = ap.parse_args()
+
+    dec = Decoder(args.output, sys.stderr)
+    src = open_input(args.input, args.baud)
+    # pyserial returns nothing on a timeout, otherwise it's the end:
+    is_serial = hasattr(src, 'in_waiting')
+    while True:
+        data = src.read(4096)
+        if not data:
+            if is_serial:
+                continue
+            break
+        dec.feed(data)
+
+
+if __name__ == '__main__':
+    main()
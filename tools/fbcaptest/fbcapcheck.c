@@ -0,0 +1,230 @@
+/*
+ * fbcapcheck:  checks of the framebuffer capture encoder
+ *
+ * PackBits rows of the widest capture (FBCAP_MAX_ROW_BYTES) made to be
+ * hard to compress (pairs, e.g. "aab", are the worst for a naive encoder),
+ * and random ones.  Each must unpack to the row, in no more than the
+ * worst case len + ceil(len/128) bytes that the packet budget allows.
+ * Then captures of the widest screens (1024x600, and the tallest) of such
+ * rows must stay within the buffer, and their packets (CRCs checked) must
+ * rebuild the screen.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fbcap.h"
+
+#define WIDTH                   (FBCAP_MAX_ROW_BYTES * 8)
+#define HEIGHT                  FBCAP_MAX_ROWS
+#define GUARD                   256
+
+static unsigned int failures = 0;
+
+/* With guard bytes after it, as its buffer's last */
+static struct {
+        fbcap_t         f;
+        uint8_t         guard[GUARD];
+} cap;
+
+static uint8_t  fb[HEIGHT * FBCAP_MAX_ROW_BYTES], rebuilt[HEIGHT * FBCAP_MAX_ROW_BYTES];
+
+static unsigned int     worst(unsigned int len)
+{
+        return len + (len + 127) / 128;
+}
+
+/* Returns the unpacked length, or -1 if it's malformed or over max */
+static int      unpackbits(const uint8_t *in, unsigned int len, uint8_t *out, unsigned int max)
+{
+        unsigned int i = 0, o = 0;
+
+        while (i < len) {
+                unsigned int h = in[i++];
+
+                if (h < 128) {
+                        if (i + h + 1 > len || o + h + 1 > max)
+                                return -1;
+                        memcpy(&out[o], &in[i], h + 1);
+                        i += h + 1;
+                        o += h + 1;
+                } else if (h > 128) {
+                        if (i >= len || o + 257 - h > max)
+                                return -1;
+                        memset(&out[o], in[i++], 257 - h);
+                        o += 257 - h;
+                } else {
+                        return -1;
+                }
+        }
+        return o;
+}
+
+static void     check_row(const char *what, const uint8_t *row, unsigned int len)
+{
+        uint8_t packed[FBCAP_MAX_ROW_BYTES * 2], out[FBCAP_MAX_ROW_BYTES];
+        unsigned int n = fbcap_packbits(row, len, packed);
+
+        if (n > worst(len)) {
+                printf("FAIL: %s (%u bytes) packed to %u, over %u\n", what, len, n, worst(len));
+                failures++;
+        } else if (unpackbits(packed, n, out, sizeof(out)) != (int)len || memcmp(out, row, len)) {
+                printf("FAIL: %s (%u bytes) didn't unpack\n", what, len);
+                failures++;
+        }
+}
+
+static void     fill_row(uint8_t *row, unsigned int len, unsigned int pattern, unsigned int seed)
+{
+        for (unsigned int i = 0; i < len; i++) {
+                switch (pattern) {
+                case 0:         /* aab aab... */
+                        row[i] = i % 3 == 2 ? 'b' : 'a' + (i / 3) % 2 * 2;
+                        break;
+                case 1:         /* aabbccdd... */
+                        row[i] = i / 2;
+                        break;
+                case 2:         /* x aaa x aaa... */
+                        row[i] = i % 4 ? 0xaa : i;
+                        break;
+                case 3:         /* abab... */
+                        row[i] = i % 2 ? 0x55 : 0xaa;
+                        break;
+                case 4:         /* All the same */
+                        row[i] = 0xff;
+                        break;
+                default:        /* Random, from a small alphabet (lots of pairs) */
+                        row[i] = rand() % (2 + seed % 3);
+                        break;
+                }
+        }
+}
+
+static void     check_packbits(void)
+{
+        uint8_t row[FBCAP_MAX_ROW_BYTES];
+        char what[32];
+
+        for (unsigned int p = 0; p < 5; p++) {
+                for (unsigned int len = 1; len <= FBCAP_MAX_ROW_BYTES; len++) {
+                        fill_row(row, len, p, 0);
+                        snprintf(what, sizeof(what), "pattern %u", p);
+                        check_row(what, row, len);
+                }
+        }
+        for (unsigned int n = 0; n < 100000; n++) {
+                unsigned int len = 1 + rand() % FBCAP_MAX_ROW_BYTES;
+
+                fill_row(row, len, 5, n);
+                snprintf(what, sizeof(what), "random row %u", n);
+                check_row(what, row, len);
+        }
+}
+
+/* Check the packets in the buffer, and apply their rows */
+static unsigned int     apply(const uint8_t *buf, unsigned int len, unsigned int stride,
+                              unsigned int height)
+{
+        unsigned int i = 0, rows = 0;
+
+        while (i < len) {
+                if (len - i < 7 || buf[i] != FBCAP_SYNC0 || buf[i + 1] != FBCAP_SYNC1) {
+                        printf("FAIL: bad packet at %u\n", i);
+                        failures++;
+                        return rows;
+                }
+                unsigned int plen = buf[i + 3] | (buf[i + 4] << 8);
+                const uint8_t *pl = &buf[i + 5];
+                if (i + 5 + plen + 2 > len ||
+                    fbcap_crc16(0xffff, &buf[i + 2], plen + 3) != (pl[plen] | (pl[plen + 1] << 8))) {
+                        printf("FAIL: bad length or CRC at %u\n", i);
+                        failures++;
+                        return rows;
+                }
+                if (buf[i + 2] == FBCAP_PKT_ROW) {
+                        unsigned int r = pl[0] | (pl[1] << 8);
+                        if (r >= height || plen - 2 > worst(stride) ||
+                            unpackbits(pl + 2, plen - 2, &rebuilt[r * stride], stride) != (int)stride) {
+                                printf("FAIL: bad row %u\n", r);
+                                failures++;
+                        }
+                        rows++;
+                }
+                i += 5 + plen + 2;
+        }
+        return rows;
+}
+
+static void     check_capture(unsigned int height)
+{
+        unsigned int stride = WIDTH / 8;
+
+        for (unsigned int r = 0; r < height; r++)
+                fill_row(&fb[r * stride], stride, r % 6, r);
+        memset(rebuilt, 0, sizeof(rebuilt));
+        memset(cap.guard, 0x5a, GUARD);
+        fbcap_init(&cap.f, WIDTH, height);
+
+        /* Partial updates, until every row's been sent */
+        unsigned int sent = 0, captures = 0;
+        while (sent < height && captures < 1000) {
+                unsigned int len = fbcap_capture(&cap.f, fb, 0);
+
+                captures++;
+                if (len > FBCAP_BUF_SIZE) {
+                        printf("FAIL: capture %u is %u bytes, over the buffer\n", captures, len);
+                        failures++;
+                        return;
+                }
+                sent += apply(cap.f.buf, len, stride, height);
+        }
+        for (unsigned int i = 0; i < GUARD; i++) {
+                if (cap.guard[i] != 0x5a) {
+                        printf("FAIL: the capture wrote past its buffer\n");
+                        failures++;
+                        break;
+                }
+        }
+        if (memcmp(rebuilt, fb, stride * height)) {
+                printf("FAIL: %u captures didn't rebuild the screen\n", captures);
+                failures++;
+        }
+        printf("fbcapcheck:  %dx%u screen sent in %u captures\n", WIDTH, height, captures);
+}
+
+int     main(int argc, char *argv[])
+{
+        srand(1);
+        check_packbits();
+        check_capture(600);
+        check_capture(HEIGHT);
+        if (failures) {
+                printf("fbcapcheck:  %u failures\n", failures);
+                return 1;
+        }
+        printf("fbcapcheck:  OK\n");
+        return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * hudcheck:  checks of hud.c's text rendering
+ *
+ * Renders strings of a few glyphs, drawn out here independently of hud.c's
+ * font, and compares the packed strip with the expected pixels:  white on
+ * black, one byte per character, lower-case as upper-case, and undefined
+ * characters blank.  Text longer than the strip must be cut off at its
+ * width, without writing past it.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hud.h"
+
+#define MAX_WPL         8
+#define GUARD           0x5a5a5a5a
+
+static unsigned int failures = 0;
+
+/* Each glyph's 7 rows, X for a lit (white) pixel */
+static const struct {
+        char            c;
+        const char      *rows[7];
+} glyphs[] = {
+        { 'H', { ".X...X..", ".X...X..", ".X...X..", ".XXXXX..", ".X...X..", ".X...X..", ".X...X.." } },
+        { 'I', { "..XXX...", "...X....", "...X....", "...X....", "...X....", "...X....", "..XXX..." } },
+        { '0', { "..XXX...", ".X...X..", ".X..XX..", ".X.X.X..", ".XX..X..", ".X...X..", "..XXX..." } },
+        { '%', { ".XX.....", ".XX..X..", "....X...", "...X....", "..X.....", ".X..XX..", "....XX.." } },
+        { ' ', { "........", "........", "........", "........", "........", "........", "........" } },
+};
+
+/* The expected byte (1 is black) for character c's row of the strip */
+static uint8_t  expect_byte(char c, unsigned int row)
+{
+        if (c >= 'a' && c <= 'z')
+                c -= 'a' - 'A';
+        if (row < 1 || row > 7)
+                return 0xff;
+        for (unsigned int i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); i++) {
+                if (glyphs[i].c == c) {
+                        uint8_t b = 0xff;
+                        for (unsigned int x = 0; x < 8; x++)
+                                if (glyphs[i].rows[row - 1][x] == 'X')
+                                        b &= ~(0x80 >> x);
+                        return b;
+                }
+        }
+        return 0xff;            /* Undefined:  blank */
+}
+
+/* Render text into a strip of wpl words per line, and compare it word by
+ * word with the expected, packed the same way (bytes in screen order).
+ */
+static void     check_text(const char *text, unsigned int wpl)
+{
+        uint32_t strip[HUD_LINES * MAX_WPL + 1];
+        unsigned int len = strlen(text);
+
+        strip[HUD_LINES * wpl] = GUARD;
+        hud_render(text, strip, wpl);
+        for (unsigned int row = 0; row < HUD_LINES; row++) {
+                for (unsigned int w = 0; w < wpl; w++) {
+                        uint8_t b[4];
+                        uint32_t expect;
+
+                        for (unsigned int i = 0; i < 4; i++) {
+                                unsigned int x = w * 4 + i;
+                                b[i] = x < len ? expect_byte(text[x], row) : 0xff;
+                        }
+                        memcpy(&expect, b, 4);
+                        if (strip[row * wpl + w] != expect) {
+                                printf("FAIL: \"%s\", %u words:  row %u word %u is %08x, not %08x\n",
+                                       text, wpl, row, w, strip[row * wpl + w], expect);
+                                failures++;
+                        }
+                }
+        }
+        if (strip[HUD_LINES * wpl] != GUARD) {
+                printf("FAIL: \"%s\", %u words:  wrote past the strip\n", text, wpl);
+                failures++;
+        }
+}
+
+int     main(int argc, char *argv[])
+{
+        /* Known glyphs, a short line, and lower-case: */
+        check_text("HI 0%", 2);
+        check_text("hi", 1);
+        check_text("", 2);
+        /* Undefined characters: */
+        check_text("H{~\x01\x7f\x80\xffI", 2);
+        /* Cut off at the strip's width: */
+        check_text("HI0%HI0%HI0%", 1);
+        check_text("HI0%HI0%HI0%", 2);
+        check_text("HI0% HI0% HI0% HI0% HI0% HI0% HI0% HI0%", MAX_WPL);
+
+        /* hud_render_row() alone, as hud_render() would hide it writing
+         * into the next row:  it's cut off too, and the row below the
+         * glyphs is blank.
+         */
+        for (unsigned int row = 0; row < HUD_FONT_H; row++) {
+                uint32_t line[3] = { 0, 0, GUARD };
+                uint32_t expect[2];
+                uint8_t b[8];
+
+                hud_render_row("HI0%HI0%H", row, line, 2);
+                for (unsigned int i = 0; i < 8; i++)
+                        b[i] = expect_byte("HI0%HI0%"[i], row + 1);
+                memcpy(expect, b, 8);
+                if (line[0] != expect[0] || line[1] != expect[1] || line[2] != GUARD) {
+                        printf("FAIL: hud_render_row, row %u wrong\n", row);
+                        failures++;
+                }
+        }
+
+        if (failures) {
+                printf("hudcheck:  %u failures\n", failures);
+                return 1;
+        }
+        printf("hudcheck:  OK\n");
+        return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * idletest:  checks that skipping the guest's idle loop (USE_IDLE) keeps
+ * the timing the guest sees
+ *
+ * umac boots the ROM (with no disc) for a few seconds, so its interrupts
+ * and trap tables are set up.  Then a program written into RAM does what
+ * an application waiting for something does:  it calls GetNextEvent
+ * until Ticks changes, then logs Ticks and does a little work.
+ * GetNextEvent is replaced with a routine that always returns a null
+ * event.  vsync and the 1Hz interrupt are delivered every so many quanta,
+ * as in umac_bench.  The same run, in a build with USE_IDLE and a build
+ * without, should log the same Ticks (one step per tick, none missed) and
+ * end with the same Time, while the USE_IDLE build runs far fewer
+ * instructions.
+ *
+ *      idletest <rom.bin> [seconds]
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "umac.h"
+#include "m68k.h"
+#include "maclowmem.h"
+#include "idle.h"
+
+#define ROM_SIZE                MAC_ROM_SIZE
+#define MAC_CLOCK_HZ            7833600
+#define QUANTUM                 5000
+#define QUANTA_PER_SEC          (MAC_CLOCK_HZ / QUANTUM)
+#define QUANTA_PER_VSYNC        (QUANTA_PER_SEC / 60)
+#define BOOT_SECONDS            5
+
+#define MAC_TICKS               0x16a   /* Long:  vsyncs since boot */
+#define MAC_TIME                0x20c   /* Long:  seconds, from the 1Hz interrupt */
+
+/* Where the program, its fake GetNextEvent, event record and log go */
+#define CODE                    0x8000
+#define FAKE_GNE                0x8100
+#define EVENT                   0x9000
+#define LOG                     0xa000
+#define LOG_STEPS               1024    /* Each a long of Ticks and of work */
+
+static uint8_t  ram[RAM_SIZE];
+static uint8_t  rom[ROM_SIZE];
+
+/* Counted by Musashi's instruction hook (host_m68kconf.h) */
+uint64_t host_bench_insns = 0;
+
+static uint32_t emit_pc;
+
+static void     emit16(uint16_t v)
+{
+        ram[emit_pc++] = v >> 8;
+        ram[emit_pc++] = v;
+}
+
+static void     emit32(uint32_t v)
+{
+        emit16(v >> 16);
+        emit16(v);
+}
+
+/* A short branch from here to target */
+static void     emit_bra(uint16_t op, uint32_t target)
+{
+        emit16(op | ((target - (emit_pc + 2)) & 0xff));
+}
+
+static uint32_t rd32(uint32_t a)
+{
+        return (ram[a] << 24) | (ram[a + 1] << 16) | (ram[a + 2] << 8) | ram[a + 3];
+}
+
+static void     wr32(uint32_t a, uint32_t v)
+{
+        ram[a] = v >> 24;
+        ram[a + 1] = v >> 16;
+        ram[a + 2] = v >> 8;
+        ram[a + 3] = v;
+}
+
+static void     setup(void)
+{
+        /* GetNextEvent(mask, VAR theEvent):  always a null event */
+        emit_pc = FAKE_GNE;
+        emit16(0x206f);                 /* MOVEA.L 4(A7),A0     theEvent */
+        emit16(0x0004);
+        emit16(0x4250);                 /* CLR.W (A0)           what = nullEvent */
+        emit16(0x205f);                 /* MOVEA.L (A7)+,A0     return address */
+        emit16(0x5c8f);                 /* ADDQ.L #6,A7         pop the arguments */
+        emit16(0x4257);                 /* CLR.W (A7)           FALSE */
+        emit16(0x4ed0);                 /* JMP (A0) */
+        wr32(MAC_TBTRAPTABLE + (TRAP_GETNEXTEVENT & 0x1ff) * 4, FAKE_GNE);
+
+        emit_pc = CODE;
+        emit16(0x46fc);                 /* MOVE.W #$2000,SR     interrupts on */
+        emit16(0x2000);
+        emit16(0x45f9);                 /* LEA LOG.L,A2 */
+        emit32(LOG);
+        emit16(0x7600);                 /* MOVEQ #0,D3 */
+        uint32_t loop = emit_pc;
+        emit16(0x2e38);                 /* MOVE.L Ticks.W,D7 */
+        emit16(MAC_TICKS);
+        uint32_t wait = emit_pc;
+        emit16(0x4267);                 /* CLR.W -(A7)          result */
+        emit16(0x3f3c);                 /* MOVE.W #-1,-(A7)     everyEvent */
+        emit16(0xffff);
+        emit16(0x4879);                 /* PEA EVENT.L */
+        emit32(EVENT);
+        emit16(TRAP_GETNEXTEVENT);      /* _GetNextEvent */
+        emit16(0x101f);                 /* MOVE.B (A7)+,D0 */
+        emit16(0xbeb8);                 /* CMP.L Ticks.W,D7 */
+        emit16(MAC_TICKS);
+        emit_bra(0x6700, wait);         /* BEQ.S wait */
+        emit16(0x24f8);                 /* MOVE.L Ticks.W,(A2)+ */
+        emit16(MAC_TICKS);
+        emit16(0x7863);                 /* MOVEQ #99,D4 */
+        emit16(0xd684);                 /* ADD.L D4,D3 */
+        emit16(0x51cc);                 /* DBRA D4,*-2 */
+        emit16(0xfffc);
+        emit16(0x24c3);                 /* MOVE.L D3,(A2)+ */
+        emit16(0xb5fc);                 /* CMPA.L #end,A2 */
+        emit32(LOG + LOG_STEPS * 8);
+        emit_bra(0x6600, loop);         /* BNE.S loop */
+        emit16(0x60fe);                 /* BRA.S * */
+
+        m68k_set_reg(M68K_REG_PC, CODE);
+}
+
+static void     run(unsigned int quanta)
+{
+        static unsigned int n = 0;
+
+        for (unsigned int i = 0; i < quanta; i++) {
+                umac_loop();
+#if USE_IDLE
+                idle_quantum_end();
+#endif
+                n++;
+                if (n % QUANTA_PER_VSYNC == 0)
+                        umac_vsync_event();
+                if (n % QUANTA_PER_SEC == 0)
+                        umac_1hz_event();
+        }
+}
+
+int     main(int argc, char *argv[])
+{
+        disc_descr_t discs[DISC_NUM_DRIVES] = {0};
+        unsigned int secs = argc > 2 ? atoi(argv[2]) : 10;
+        FILE *f;
+
+        if (argc < 2) {
+                fprintf(stderr, "Usage: %s <rom.bin> [seconds]\n", argv[0]);
+                return 1;
+        }
+        f = fopen(argv[1], "rb");
+        if (!f || fread(rom, 1, ROM_SIZE, f) != ROM_SIZE) {
+                printf("idletest:  SKIP (can't read a %uKB ROM from %s)\n", ROM_SIZE / 1024, argv[1]);
+                return 0;
+        }
+        fclose(f);
+        if (secs * 60 >= LOG_STEPS)
+                secs = LOG_STEPS / 60 - 1;
+
+        umac_init(ram, rom, discs);
+#if USE_IDLE
+        idle_init(ram, RAM_SIZE, rom, ROM_SIZE);
+        idle_enabled = false;
+#endif
+        run(BOOT_SECONDS * QUANTA_PER_SEC);
+
+        setup();
+        host_bench_insns = 0;
+#if USE_IDLE
+        idle_stats = (idle_stats_t){ 0 };
+        idle_enabled = true;
+#endif
+        run(secs * QUANTA_PER_SEC);
+
+        /* One step per tick, and none missed: */
+        uint32_t steps = (m68k_get_reg(NULL, M68K_REG_A2) - LOG) / 8;
+        uint32_t h = 2166136261u;
+        unsigned int bad = 0;
+
+        for (uint32_t i = 0; i < steps; i++) {
+                if (i && rd32(LOG + i * 8) != rd32(LOG + (i - 1) * 8) + 1)
+                        bad++;
+                for (unsigned int j = 0; j < 8; j++)
+                        h = (h ^ ram[LOG + i * 8 + j]) * 16777619u;
+        }
+        printf("idletest (%s):\n", USE_IDLE ? "USE_IDLE" : "no idle detection");
+        printf("  guest:  %u steps, ticks %u to %u, time %u, log %08x\n", steps,
+               steps ? rd32(LOG) : 0, steps ? rd32(LOG + (steps - 1) * 8) : 0,
+               rd32(MAC_TIME), h);
+        printf("  host:  %.2fM instructions", host_bench_insns / 1e6);
+#if USE_IDLE
+        printf(", %u of %u quanta cut short", idle_stats.idle, idle_stats.quanta);
+#endif
+        printf("\n");
+
+        if (steps < secs * 60 - 2 || bad) {
+                printf("FAIL:  %u steps in %us, %u ticks missed or repeated\n", steps, secs, bad);
+                return 1;
+        }
+#if USE_IDLE
+        if (idle_stats.idle == 0) {
+                printf("FAIL:  the guest was never seen idle\n");
+                return 1;
+        }
+#endif
+        return 0;
+}
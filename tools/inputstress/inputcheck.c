@@ -0,0 +1,268 @@
+/*
+ * inputcheck: host-side checks of the input ring's policy, and of the
+ * absolute pointer mapping
+ *
+ * The ring (built with INPUT_RING_SIZE, default 32) is checked with a burst
+ * of presses that overflows it, then with a long random mix of keys,
+ * buttons, motion, wheel and pointer events, consumed at varying rates.
+ * A model of the guest checks that it never sees a release without its
+ * press (or vice versa), and that at the end nothing is stuck down, all
+ * motion and wheel arrived, the pointer is where it was last put, and
+ * every refused press was counted.
+ *
+ * For each Mac screen size (512x342, and 640x480 for USE_VGA_RES), checks
+ * that pointer_map() covers the screen exactly (the ends of the range
+ * reach the edges, it's monotonic, and every coordinate gets an equal
+ * share, +/-1), that pointer_unmap() round-trips every coordinate, and
+ * that pointer_set_lowmem() writes only the cursor globals, big-endian.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input.h"
+#include "pointer.h"
+
+static int errors = 0;
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); errors++; } } while (0)
+
+static void     check_axis(const char *name, unsigned int size)
+{
+        unsigned int share[1024] = {0};
+        int last = 0;
+
+        CHECK(pointer_map(0, size) == 0, "%s: 0 maps to %d", name, pointer_map(0, size));
+        CHECK(pointer_map(POINTER_MAX, size) == (int)size - 1, "%s: max maps to %d",
+              name, pointer_map(POINTER_MAX, size));
+        for (unsigned int p = 0; p <= POINTER_MAX; p++) {
+                int c = pointer_map(p, size);
+
+                CHECK(c >= last && c < (int)size, "%s: %u maps to %d (after %d)", name, p, c, last);
+                if (c < 0 || c >= (int)size)
+                        return;
+                share[c]++;
+                last = c;
+        }
+
+        unsigned int min = share[0], max = share[0];
+        for (unsigned int c = 0; c < size; c++) {
+                min = share[c] < min ? share[c] : min;
+                max = share[c] > max ? share[c] : max;
+                CHECK(pointer_map(pointer_unmap(c, size), size) == (int)c,
+                      "%s: %u unmaps to %u, which maps to %d", name, c,
+                      pointer_unmap(c, size), pointer_map(pointer_unmap(c, size), size));
+        }
+        CHECK(min > 0 && max - min <= 1, "%s: shares %u..%u", name, min, max);
+}
+
+static void     check_lowmem(int x, int y, uint8_t couple)
+{
+        static uint8_t ram[0x1000], ref[0x1000];
+
+        memset(ram, 0xa5, sizeof(ram));
+        ram[MAC_CRSRNEW] = 0;
+        ram[MAC_CRSRCOUPLE] = couple;
+        memcpy(ref, ram, sizeof(ram));
+        ref[MAC_MTEMP] = ref[MAC_RAWMOUSE] = y >> 8;
+        ref[MAC_MTEMP + 1] = ref[MAC_RAWMOUSE + 1] = y;
+        ref[MAC_MTEMP + 2] = ref[MAC_RAWMOUSE + 2] = x >> 8;
+        ref[MAC_MTEMP + 3] = ref[MAC_RAWMOUSE + 3] = x;
+        ref[MAC_CRSRNEW] = couple;
+
+        pointer_set_lowmem(ram, x, y);
+        for (unsigned int a = 0; a < sizeof(ram); a++)
+                CHECK(ram[a] == ref[a], "lowmem (%d, %d): $%03x is %02x, not %02x",
+                      x, y, a, ram[a], ref[a]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Ring policy
+
+static input_ring_t ring;
+
+/* The guest's view, from what's popped */
+static struct {
+        bool            key_down[256];
+        bool            button_down[8];
+        long            dx, dy, wheel;
+        int             x, y;
+        unsigned int    events;
+} guest;
+
+static void     consume(unsigned int max)
+{
+        input_event_t e;
+
+        while (max-- && input_pop(&ring, &e)) {
+                guest.events++;
+                switch (e.type) {
+                case INPUT_KEY:
+                        CHECK(guest.key_down[e.key] != e.down, "key %u %s twice",
+                              e.key, e.down ? "pressed" : "released");
+                        guest.key_down[e.key] = e.down;
+                        break;
+                case INPUT_BUTTON:
+                        CHECK(guest.button_down[e.key] != e.down, "button %u %s twice",
+                              e.key, e.down ? "pressed" : "released");
+                        guest.button_down[e.key] = e.down;
+                        break;
+                case INPUT_MOUSE:
+                        guest.dx += e.dx;
+                        guest.dy += e.dy;
+                        break;
+                case INPUT_WHEEL:
+                        guest.wheel += e.dy;
+                        break;
+                case INPUT_POINTER:
+                        guest.x = e.dx;
+                        guest.y = e.dy;
+                        break;
+                default:
+                        CHECK(0, "event type %u", e.type);
+                }
+        }
+}
+
+static void     check_stuck(void)
+{
+        for (unsigned int k = 0; k < 256; k++)
+                CHECK(!guest.key_down[k], "key %u stuck", k);
+        for (unsigned int b = 0; b < 8; b++)
+                CHECK(!guest.button_down[b], "button %u stuck", b);
+}
+
+static void     check_burst(void)
+{
+        unsigned int accepted = 0;
+
+        memset(&guest, 0, sizeof(guest));
+        input_init(&ring);
+        /* e.g. a macro keyboard, with nothing consuming: */
+        for (unsigned int k = 0; k < 40; k++)
+                accepted += input_key(&ring, k, true, k);
+        CHECK(accepted == (INPUT_RING_SIZE / 2 < 40 ? INPUT_RING_SIZE / 2 : 40), "burst: %u presses accepted", accepted);
+        CHECK(ring.dropped == 40 - accepted, "burst: %u dropped", ring.dropped);
+        for (unsigned int k = 0; k < 40; k++)
+                CHECK(input_key(&ring, k, false, 100 + k), "burst: release %u refused", k);
+        consume(~0);
+        CHECK(guest.events == 2 * accepted, "burst: %u events", guest.events);
+        check_stuck();
+}
+
+static void     check_random(unsigned int steps)
+{
+        bool key_down[16] = {0};
+        bool button_down = false;
+        long dx = 0, dy = 0, wheel = 0;
+        int x = -1, y = -1;
+        unsigned int refused = 0;
+
+        memset(&guest, 0, sizeof(guest));
+        guest.x = guest.y = -1;
+        input_init(&ring);
+        srand(1);
+        for (unsigned int i = 0; i < steps; i++) {
+                unsigned int k = rand() % 16;
+                int a = rand() % 8;
+
+                if (a < 3) {
+                        /* Keys that were refused are still released */
+                        key_down[k] = !key_down[k];
+                        refused += !input_key(&ring, 0x40 + k, key_down[k], i);
+                } else if (a == 3) {
+                        button_down = !button_down;
+                        refused += !input_button(&ring, 0, button_down, i);
+                } else if (a == 4) {
+                        x = rand() % (POINTER_MAX + 1);
+                        y = rand() % (POINTER_MAX + 1);
+                        input_pointer(&ring, x, y, i);
+                } else if (a == 5) {
+                        int z = rand() % 7 - 3;
+                        wheel += z;
+                        input_wheel(&ring, z, i);
+                } else {
+                        int mx = rand() % 4001 - 2000;
+                        int my = rand() % 41 - 20;
+                        dx += mx;
+                        dy += my;
+                        input_motion(&ring, mx, my, i);
+                }
+                /* Phases of slow and fast consumption: */
+                if ((i / 1000) & 1)
+                        consume(rand() % 3);
+                else if (rand() % 8 == 0)
+                        consume(1);
+                if (rand() % 4 == 0)
+                        input_flush(&ring);
+        }
+        for (unsigned int k = 0; k < 16; k++) {
+                if (key_down[k])
+                        input_key(&ring, 0x40 + k, false, steps);
+        }
+        input_button(&ring, 0, false, steps);
+        for (unsigned int i = 0; i < 100; i++) {
+                input_flush(&ring);
+                consume(~0);
+        }
+
+        printf("  %u events, %u presses refused, %u coalesced, max %u used\n",
+               guest.events, refused, ring.coalesced, ring.max_used);
+        check_stuck();
+        CHECK(ring.dropped == refused, "random: %u dropped, %u refused", ring.dropped, refused);
+        CHECK(refused > 0 && ring.coalesced > 0, "random: ring never filled");
+        CHECK(guest.dx == dx && guest.dy == dy, "random: motion %ld,%ld, not %ld,%ld",
+              guest.dx, guest.dy, dx, dy);
+        CHECK(guest.wheel == wheel, "random: wheel %ld, not %ld", guest.wheel, wheel);
+        CHECK(guest.x == x && guest.y == y, "random: pointer %d,%d, not %d,%d",
+              guest.x, guest.y, x, y);
+}
+
+int     main()
+{
+        printf("Ring of %u\n", INPUT_RING_SIZE);
+        check_burst();
+        check_random(200000);
+
+        static const struct { unsigned int w, h; } screens[] = {
+                { 512, 342 },
+                { 640, 480 },
+        };
+
+        for (unsigned int i = 0; i < sizeof(screens) / sizeof(screens[0]); i++) {
+                char name[32];
+
+                printf("%ux%u\n", screens[i].w, screens[i].h);
+                snprintf(name, sizeof(name), "%ux%u x", screens[i].w, screens[i].h);
+                check_axis(name, screens[i].w);
+                snprintf(name, sizeof(name), "%ux%u y", screens[i].w, screens[i].h);
+                check_axis(name, screens[i].h);
+                check_lowmem(screens[i].w - 1, screens[i].h - 1, 0xff);
+                check_lowmem(screens[i].w / 2, 0, 0);
+        }
+        printf("%s\n", errors ? "FAIL" : "PASS");
+        return errors ? 1 : 0;
+}
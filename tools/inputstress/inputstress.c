@@ -0,0 +1,146 @@
+/*
+ * inputstress: host-side stress test of the input event ring
+ *
+ * A producer thread (standing in for core 0) pushes a numbered sequence
+ * of events through input.c's ring, retrying when it's full, while a
+ * consumer thread (core 1) pops them and checks that every event arrives
+ * exactly once, in order and intact.  A torn or early read of a slot, or
+ * a lost/repeated index update, shows up as a mismatch.
+ *
+ * Options:
+ *      -n <events>     Number of events (default 10000000)
+ *      -y              Yield when the ring is full/empty, rather than
+ *                      spinning, to shake up the interleaving
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "input.h"
+
+static input_ring_t ring;
+static uint32_t num_events = 10000000;
+static int yield = 0;
+static uint64_t full_count = 0;
+static uint64_t empty_count = 0;
+
+static void     make_event(uint32_t i, input_event_t *e)
+{
+        e->time_us = i;
+        e->type = (i & 1) ? INPUT_MOUSE : INPUT_KEY;
+        e->down = (i >> 1) & 1;
+        e->key = i >> 2;
+        e->dx = (int16_t)(i * 3);
+        e->dy = (int16_t)~i;
+}
+
+static void     *producer(void *arg)
+{
+        (void)arg;
+        for (uint32_t i = 0; i < num_events; i++) {
+                input_event_t e;
+
+                make_event(i, &e);
+                while (!input_push(&ring, &e)) {
+                        full_count++;
+                        if (yield)
+                                sched_yield();
+                }
+        }
+        return NULL;
+}
+
+static void     *consumer(void *arg)
+{
+        long bad = 0;
+
+        (void)arg;
+        for (uint32_t i = 0; i < num_events; i++) {
+                input_event_t e, x;
+
+                while (!input_pending(&ring) || !input_pop(&ring, &e)) {
+                        empty_count++;
+                        if (yield)
+                                sched_yield();
+                }
+                make_event(i, &x);
+                if (e.time_us != x.time_us || e.type != x.type || e.down != x.down ||
+                    e.key != x.key || e.dx != x.dx || e.dy != x.dy) {
+                        if (bad++ < 10)
+                                fprintf(stderr, "Event %u: got seq %u type %u down %u key %u dx %d dy %d\n",
+                                        i, e.time_us, e.type, e.down, e.key, e.dx, e.dy);
+                }
+        }
+        return (void *)bad;
+}
+
+int     main(int argc, char *argv[])
+{
+        int opt;
+        pthread_t tp, tc;
+        void *bad;
+        struct timespec t0, t1;
+
+        while ((opt = getopt(argc, argv, "n:y")) != -1) {
+                switch (opt) {
+                case 'n':
+                        num_events = strtoul(optarg, NULL, 0);
+                        break;
+                case 'y':
+                        yield = 1;
+                        break;
+                default:
+                        fprintf(stderr, "Usage: %s [-n events] [-y]\n", argv[0]);
+                        return 2;
+                }
+        }
+
+        if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+                yield = 1;
+
+        input_init(&ring);
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        pthread_create(&tc, NULL, consumer, NULL);
+        pthread_create(&tp, NULL, producer, NULL);
+        pthread_join(tp, NULL);
+        pthread_join(tc, &bad);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        printf("%u events in %.2fs (%.1fM/s), ring full %" PRIu64 ", empty %" PRIu64 " times\n",
+               num_events, secs, num_events / secs / 1e6, full_count, empty_count);
+        if (bad || input_pending(&ring)) {
+                printf("FAIL: %ld bad events%s\n", (long)bad,
+                       input_pending(&ring) ? ", ring not empty at end" : "");
+                return 1;
+        }
+        printf("PASS\n");
+        return 0;
+}
@@ -0,0 +1,126 @@
+#
+# Musashi's opcode handlers, from its generated m68kops.c
+#
+# m68kops.c has a table of handlers, each with an opcode mask and match and
+# its cycles per CPU type.  Musashi builds m68ki_instruction_jump_table from
+# it in order, so a later entry overrides an earlier one for the opcodes
+# they both match.  This is used by the tools that take opcode counts
+# (USE_OPCOUNT), to find which handler ran, and so its cycles (for the
+# 68000) and addressing mode.
+#
+# Copyright 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import os
+import re
+
+ENTRY_RE = re.compile(r'\{\s*(m68k_op_\w+)\s*,\s*0x([0-9a-fA-F]+)\s*,\s*0x([0-9a-fA-F]+)\s*,'
+                      r'\s*\{\s*(\d+)')
+# A definition's first line (a prototype ends with ';')
+DEF_RE = re.compile(r'^\s*(?:static\s+)?void\s+(m68k_op_\w+)\s*\([^;]*\)\s*\{?\s*$')
+
+ILLEGAL = 'm68k_op_illegal'
+
+
+class Handlers:
+    def __init__(self, path):
+        self.path = os.path.abspath(path)
+        with open(path) as f:
+            self.lines = f.read().splitlines(keepends=True)
+        self.entries = []       # (name, mask, match, 68000 cycles)
+        self.defs = {}          # name -> line index of its definition
+        for i, line in enumerate(self.lines):
+            m = DEF_RE.match(line)
+            if m:
+                self.defs.setdefault(m.group(1), i)
+            for m in ENTRY_RE.finditer(line):
+                self.entries.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16),
+                                     int(m.group(4))))
+        if not self.entries:
+            raise ValueError('%s: no opcode handler table found' % path)
+        # For each mask, the last entry for each match:
+        self.by_mask = {}
+        for i, (_, mask, match, _) in enumerate(self.entries):
+            self.by_mask.setdefault(mask, {})[match] = i
+        self.cache = {}
+
+    def lookup(self, op):
+        """(handler name, 68000 cycles) for an opcode"""
+        if op not in self.cache:
+            best = -1
+            for mask, matches in self.by_mask.items():
+                i = matches.get(op & mask, -1)
+                if i > best:
+                    best = i
+            self.cache[op] = self.entries[best][0::3] if best >= 0 else (ILLEGAL, 0)
+        return self.cache[op]
+
+    def source_order(self):
+        """Handler names, in the order they're defined"""
+        return sorted(self.defs, key=self.defs.get)
+
+
+# Addressing modes, by the (last) EA in a handler's name, e.g. m68k_op_add_16_er_pi
+EA_FAMILIES = {
+    'd': 'Dn', 'rr': 'Dn', 'a': 'An', 'ai': '(An)', 'pi': '(An)+', 'pi7': '(An)+',
+    'pd': '-(An)', 'pd7': '-(An)', 'mm': '-(An)', 'di': 'd16(An)', 'ix': 'd8(An,Xn)',
+    'aw': 'abs.W', 'al': 'abs.L', 'pcdi': 'd16(PC)', 'pcix': 'd8(PC,Xn)', 'i': '#imm',
+}
+
+
+def mnemonic(name):
+    return name[len('m68k_op_'):].split('_')[0]
+
+
+def ea_family(name):
+    """The source (or only) EA's addressing mode, or None"""
+    for tok in reversed(name[len('m68k_op_'):].split('_')[1:]):
+        if tok in EA_FAMILIES:
+            return EA_FAMILIES[tok]
+    return None
+
+
+def parse_counts(lines, counts=None):
+    """Opcode counts from "opc:" lines (added to counts), and the
+    instructions that weren't counted (overflow).  Stops at "opc: end"."""
+    counts = {} if counts is None else counts
+    overflow = 0
+    for line in lines:
+        m = re.search(r'opc: (\w+)(?: (\w+))?(?: (\w+) (\d+))?', line)
+        if not m:
+            continue
+        if m.group(1) == 'total':
+            overflow += int(m.group(4))
+        elif m.group(1) == 'end':
+            break
+        elif re.fullmatch(r'[0-9a-fA-F]{4}', m.group(1)) and m.group(2):
+            op = int(m.group(1), 16)
+            counts[op] = counts.get(op, 0) + int(m.group(2))
+    return counts, overflow
+
+
+def read_counts(paths):
+    """Opcode counts summed over several dumps, and the overflow"""
+    counts = {}
+    overflow = 0
+    for path in paths:
+        with open(path, errors='replace') as f:
+            overflow += parse_counts(f, counts)[1]
+    return counts, overflow
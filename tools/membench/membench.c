@@ -0,0 +1,172 @@
+/*
+ * membench:  memory-bound 68K loops in umac, with and without USE_MEMMAP
+ *
+ * umac boots the ROM for a moment (so the overlay's off, and RAM's at 0),
+ * then each loop is written into RAM and run, with interrupts masked,
+ * for a fixed number of 68K cycles.  The host time gives the emulated
+ * speed.  The same loops run in a build with and a build without the fast
+ * paths, and a checksum of RAM and the registers after each shows that
+ * they computed the same thing.
+ *
+ *      membench <rom.bin> [Mcycles per loop]
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "umac.h"
+#include "m68k.h"
+#include "maclowmem.h"
+#if USE_MEMMAP
+#include "memmap.h"
+#endif
+
+#define ROM_SIZE                MAC_ROM_SIZE
+#define MAC_CLOCK_HZ            7833600
+#define QUANTUM                 5000
+#define BOOT_LOOPS              (MAC_CLOCK_HZ / QUANTUM)        /* 1s */
+
+/* Where the loops and their buffers go */
+#define CODE                    0x8000
+#define SRC                     0x9000
+#define DST                     0xa000
+#define BUF_LONGS               1024
+
+static uint8_t  ram[RAM_SIZE];
+static uint8_t  rom[ROM_SIZE];
+
+static uint32_t emit_pc;
+
+static void     emit16(uint16_t v)
+{
+        ram[emit_pc++] = v >> 8;
+        ram[emit_pc++] = v;
+}
+
+static void     emit32(uint32_t v)
+{
+        emit16(v >> 16);
+        emit16(v);
+}
+
+/* An outer loop:  LEA src,A0; LEA dst,A1; MOVE.W #count-1,D0; then the
+ * inner loop's instruction, DBRA D0 back to it, and BRA to the start.
+ */
+static void     emit_loop(uint32_t src, uint32_t dst, unsigned int count, uint16_t insn)
+{
+        emit_pc = CODE;
+        emit16(0x41f9);                 /* LEA src.L,A0 */
+        emit32(src);
+        emit16(0x43f9);                 /* LEA dst.L,A1 */
+        emit32(dst);
+        emit16(0x303c);                 /* MOVE.W #count-1,D0 */
+        emit16(count - 1);
+        emit16(insn);
+        emit16(0x51c8);                 /* DBRA D0,insn */
+        emit16(0xfffc);
+        emit16(0x6000 | ((CODE - (emit_pc + 2)) & 0xff));       /* BRA.S start */
+}
+
+typedef struct {
+        const char      *name;
+        uint32_t        src;
+        unsigned int    count;
+        uint16_t        insn;
+} loop_t;
+
+static const loop_t loops[] = {
+        { "copy.l RAM", SRC, BUF_LONGS, 0x22d8 },               /* MOVE.L (A0)+,(A1)+ */
+        { "add.b RAM", SRC, BUF_LONGS * 4, 0xd218 },            /* ADD.B (A0)+,D1 */
+        { "add.l ROM", MAC_ROM_BASE, BUF_LONGS, 0xd298 },       /* ADD.L (A0)+,D1 */
+        { "fill.w RAM", SRC, BUF_LONGS * 2, 0x32c1 },           /* MOVE.W D1,(A1)+ */
+        { NULL },
+};
+
+static uint32_t checksum(void)
+{
+        uint32_t h = 2166136261u;
+
+        for (unsigned int i = 0; i < RAM_SIZE; i++)
+                h = (h ^ ram[i]) * 16777619u;
+        for (int r = M68K_REG_D0; r <= M68K_REG_A7; r++)
+                h = (h ^ m68k_get_reg(NULL, r)) * 16777619u;
+        return h;
+}
+
+static double   now(void)
+{
+        struct timespec t;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int     main(int argc, char *argv[])
+{
+        disc_descr_t discs[DISC_NUM_DRIVES] = {0};
+        unsigned int mcycles = argc > 2 ? atoi(argv[2]) : 200;
+        FILE *f;
+
+        if (argc < 2) {
+                fprintf(stderr, "Usage: %s <rom.bin> [Mcycles per loop]\n", argv[0]);
+                return 1;
+        }
+        f = fopen(argv[1], "rb");
+        if (!f || fread(rom, 1, ROM_SIZE, f) != ROM_SIZE) {
+                printf("membench:  SKIP (can't read a %uKB ROM from %s)\n", ROM_SIZE / 1024, argv[1]);
+                return 0;
+        }
+        fclose(f);
+
+        umac_init(ram, rom, discs);
+#if USE_MEMMAP
+        memmap_init(ram, RAM_SIZE, rom, ROM_SIZE);
+#endif
+        for (unsigned int i = 0; i < BOOT_LOOPS; i++)
+                umac_loop();
+
+        printf("membench (%s):\n", USE_MEMMAP ? "USE_MEMMAP" : "umac's handlers");
+        for (const loop_t *l = loops; l->name; l++) {
+                uint64_t cycles = 0;
+
+                emit_loop(l->src, DST, l->count, l->insn);
+                for (unsigned int i = 0; i < BUF_LONGS * 4; i++)
+                        ram[SRC + i] = i * 7;
+                m68k_set_reg(M68K_REG_SR, 0x2700);
+                m68k_set_reg(M68K_REG_D1, 0);
+                m68k_set_reg(M68K_REG_PC, CODE);
+
+                double t0 = now();
+                while (cycles < (uint64_t)mcycles * 1000000)
+                        cycles += m68k_execute(QUANTUM);
+                double secs = now() - t0;
+
+                printf("  %-12s %7.1f MHz (%.2fx a 68000)   checksum %08x\n", l->name,
+                       cycles / secs / 1e6, cycles / secs / MAC_CLOCK_HZ, checksum());
+        }
+        return 0;
+}
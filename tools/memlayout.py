@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+#
+# Check that each CMake preset's memory layout fits its chip
+#
+# For each configure preset in CMakePresets.json (or those named), this
+# adds up what the firmware puts in SRAM:  the Mac's RAM (unless it's in
+# PSRAM), the buffers and tables that options add, hot code placed in
+# SRAM, and an allowance for the rest.  It checks that the total fits the
+# chip's main SRAM, that the Mac's screen lies within its RAM leaving a
+# usable amount below, and that the stacks fit the scratch banks the SDK
+# puts them in.  -D overrides (or adds) a cache variable, to try a
+# configuration without a preset.  It exits 1 if any doesn't fit.
+#
+# The sizes are those of the arrays in the source, except for the
+# allowance for the SDK, TinyUSB, FatFs and the rest, which is set from
+# RP2040 builds (where 208KB of Mac RAM, with SD, is about the maximum).
+# A configuration near the limit should still be checked by linking it.
+#
+# Usage: memlayout.py [--presets CMakePresets.json] [-D VAR=VALUE ...]
+#            [preset ...]
+#
+# Copyright 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import json
+import os
+import sys
+
+KB = 1024
+
+# Main SRAM, and the two scratch banks the SDK puts the stacks in (core 0's
+# in Y, core 1's in X):
+PLATFORMS = {
+    'rp2040': {'sram': 256 * KB, 'scratch': 4 * KB},
+    'rp2350': {'sram': 512 * KB, 'scratch': 4 * KB},
+}
+
+# PSRAM on boards that have it (APS6404L):
+PSRAM_SIZES = {
+    'pimoroni_pico_plus2_rp2350': 8192 * KB,
+}
+PSRAM_DEFAULT = 8192 * KB
+
+# CMakeLists.txt's defaults:
+DEFAULTS = {
+    'PICO_PLATFORM': 'rp2040',
+    'PICO_BOARD': 'pico',
+    'MEMSIZE': '128',
+    'LCD_PANEL': '800x480',
+    'UMAC_PGO_BUDGET': '16384',
+    'DISCZ_CACHE_KB': '16',
+    'PICO_STACK_SIZE': '0x800',
+    'PICO_CORE1_STACK_SIZE': '0x800',
+}
+
+# The SDK, TinyUSB's host stack, stdio, video and input state, and the heap:
+FIRMWARE_BASE = 36 * KB
+# FatFs and the SD driver:
+SD_SIZE = 8 * KB
+# m68kcpu.c's code (UMAC_CORE_IN_SRAM):
+CORE_SIZE = 12 * KB
+
+# The deepest stack use, of the emulation on core 1 and USB on core 0; the
+# core that talks to the SD card (core 1, or 0 with USE_DEVCHAN) needs
+# more, for FatFs' FIL and its sector buffer.
+STACK_NEED = 1 * KB
+STACK_NEED_SD = 768
+
+# The Mac's screen is at the top of its RAM, under some globals; less than
+# this much RAM below it leaves the Mac nothing useful:
+SCREEN_GAP = 0x380
+GUEST_MIN = 64 * KB
+
+# Sizes the ROM knows; others are patched in by umac:
+NATIVE_MEMSIZES = (128, 512, 1024, 2048, 2560, 4096)
+
+VIDEO_MAX_V_TOTAL = 806
+HUD_LINES = 10
+PROF_BUCKETS = 2048 + (128 * KB >> 6)
+OPCOUNT_SLOTS = 1 << 12
+FBCAP_SIZE = 768 * 4 + 768 // 8 + 4096 + 64
+MEMMAP_PAGES = 0x800000 >> 14
+DISC_READAHEAD = 4096
+
+
+def cache_value(v):
+    if isinstance(v, dict):
+        v = v.get('value', '')
+    if isinstance(v, bool):
+        return 'ON' if v else 'OFF'
+    return str(v)
+
+
+def is_on(v):
+    return v.upper() in ('ON', 'TRUE', 'YES', 'Y', '1')
+
+
+def resolve(presets, name, seen=()):
+    """A preset's cache variables, with those it inherits"""
+    if name in seen:
+        sys.exit('Preset %s inherits itself' % name)
+    p = presets[name]
+    v = {}
+    inherits = p.get('inherits', [])
+    if isinstance(inherits, str):
+        inherits = [inherits]
+    for parent in inherits:
+        v.update(resolve(presets, parent, seen + (name,)))
+    for k, val in p.get('cacheVariables', {}).items():
+        v[k] = cache_value(val)
+    return v
+
+
+def display_size(v):
+    if is_on(v.get('USE_LCD', 'OFF')):
+        w, h = v['LCD_PANEL'].split('x')
+        return int(w), int(h)
+    if is_on(v.get('USE_VGA_RES', 'OFF')):
+        return 640, 480
+    return 512, 342
+
+
+def check(v):
+    """Lines of report, and whether it fits"""
+    out = []
+    ok = True
+
+    def on(k):
+        return is_on(v.get(k, 'OFF'))
+
+    platform = v['PICO_PLATFORM'].split('-')[0]
+    if platform not in PLATFORMS:
+        return ['unknown platform %s' % v['PICO_PLATFORM']], False
+    chip = PLATFORMS[platform]
+    ram = int(v['MEMSIZE']) * KB
+    width, height = display_size(v)
+    psram = on('USE_PSRAM')
+
+    # SRAM:
+    parts = []
+    if not psram:
+        parts.append(('Mac RAM', ram))
+    parts.append(('firmware', FIRMWARE_BASE))
+    if on('USE_SD'):
+        parts.append(('SD', SD_SIZE))
+    if on('USE_VIDEO_SCANLIST'):
+        parts.append(('scanlist', ((VIDEO_MAX_V_TOTAL * 2 + 1) * 2) * 4))
+    if on('USE_HUD'):
+        parts.append(('HUD', 2 * HUD_LINES * (width // 32) * 4))
+    if on('USE_FBCAP'):
+        parts.append(('fbcap', FBCAP_SIZE))
+    if on('USE_PROFILE'):
+        parts.append(('profile', PROF_BUCKETS * 4))
+    if on('USE_OPCOUNT'):
+        parts.append(('opcount', OPCOUNT_SLOTS * 6))
+    if on('USE_MEMMAP'):
+        parts.append(('memmap', MEMMAP_PAGES * 4))
+    if on('USE_DEVCHAN'):
+        parts.append(('read-ahead', DISC_READAHEAD))
+    if on('USE_DISCZ'):
+        parts.append(('disc cache', int(v['DISCZ_CACHE_KB']) * KB))
+    if on('UMAC_CORE_IN_SRAM'):
+        parts.append(('m68kcpu', CORE_SIZE))
+    if v.get('UMAC_PGO_COUNTS') or 'UMAC_PGO_BUDGET' in v.get('_set', ()):
+        parts.append(('PGO', int(v['UMAC_PGO_BUDGET'], 0)))
+    used = sum(n for _, n in parts)
+    fits = used <= chip['sram']
+    ok &= fits
+    out.append('SRAM:    %6.1fKB of %.0fKB, %6.1fKB free  %s' %
+               (used / KB, chip['sram'] / KB, (chip['sram'] - used) / KB,
+                'ok' if fits else 'DOESN\'T FIT'))
+    out.append('         ' + ', '.join('%s %.1fKB' % (n, s / KB) for n, s in parts))
+
+    if psram:
+        if platform != 'rp2350':
+            out.append('PSRAM:   needs an RP2350  DOESN\'T FIT')
+            ok = False
+        else:
+            size = PSRAM_SIZES.get(v['PICO_BOARD'], PSRAM_DEFAULT)
+            fits = ram <= size
+            ok &= fits
+            out.append('PSRAM:   Mac RAM %.0fKB of %.0fKB  %s' %
+                       (ram / KB, size / KB, 'ok' if fits else 'DOESN\'T FIT'))
+
+    # The screen, at the top of the Mac's RAM:
+    fb = width * height // 8
+    fb_base = ram - fb - SCREEN_GAP
+    fits = fb_base >= GUEST_MIN
+    ok &= fits
+    out.append('screen:  %dx%d, 0x%x-0x%x, %.1fKB below it  %s' %
+               (width, height, max(fb_base, 0), ram - SCREEN_GAP, max(fb_base, 0) / KB,
+                'ok' if fits else 'DOESN\'T FIT'))
+
+    # Stacks:
+    stacks = []
+    for core, var, sd in ((0, 'PICO_STACK_SIZE', on('USE_DEVCHAN')),
+                          (1, 'PICO_CORE1_STACK_SIZE', not on('USE_DEVCHAN'))):
+        size = int(v[var], 0)
+        need = STACK_NEED + (STACK_NEED_SD if sd and on('USE_SD') else 0)
+        fits = need <= size <= chip['scratch']
+        ok &= fits
+        stacks.append('core %d %.1fKB (needs %.1fKB)%s' %
+                      (core, size / KB, need / KB, '' if fits else ' DOESN\'T FIT'))
+    out.append('stacks:  ' + ', '.join(stacks))
+
+    if int(v['MEMSIZE']) not in NATIVE_MEMSIZES:
+        out.append('note:    %sKB isn\'t a size the ROM knows; patch it with a umac of the same MEMSIZE'
+                   % v['MEMSIZE'])
+    return out, ok
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser(description='Check presets\' memory layouts')
+    ap.add_argument('--presets', default=os.path.join(here, '..', 'CMakePresets.json'))
+    ap.add_argument('-D', dest='defs', action='append', default=[], metavar='VAR=VALUE',
+                    help='Set a cache variable (for every preset)')
+    ap.add_argument('preset', nargs='*', help='Presets to check (default all)')
+    args = ap.parse_args()
+
+    defs = {}
+    for d in args.defs:
+        k, _, val = d.partition('=')
+        defs[k] = val
+
+    with open(args.presets) as f:
+        presets = {p['name']: p for p in json.load(f).get('configurePresets', [])}
+    names = args.preset or [n for n, p in presets.items() if not p.get('hidden')]
+
+    ok = True
+    for name in names:
+        if name not in presets:
+            sys.exit('No preset %s' % name)
+        v = resolve(presets, name)
+        v.update(defs)
+        if is_on(v.get('HOST_BUILD', 'OFF')):
+            continue
+        v['_set'] = set(v)
+        for k, val in DEFAULTS.items():
+            v.setdefault(k, val)
+        lines, fits = check(v)
+        ok &= fits
+        print('%s (%s, %s):' % (name, v['PICO_PLATFORM'], v['PICO_BOARD']))
+        for line in lines:
+            print('  ' + line)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# Rank Musashi opcode handlers by the 68K time they take
+#
+# Reads opcode counts (the "opc:" lines of the console's ops command with
+# USE_OPCOUNT, or umac_bench's output) from a serial device, which is sent
+# the command, or saved logs or stdin.  Each opcode's handler comes from
+# Musashi's m68kops.c, with its 68000 cycles; cycles that depend on
+# operands (shift counts, MOVEM's registers, taken branches, MULU/DIVU)
+# aren't known, so these are the table's base cycles, an estimate.
+# Handlers are ranked by count x cycles, then totalled by instruction and
+# by addressing mode (of the source, or only, operand).
+#
+# Usage: oprank.py --ops m68kops.c [-b baud] [-n top] <device|file|->...
+#
+# Copyright 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import m68kops
+
+
+def read_input(path, baud, counts):
+    if path == '-':
+        return m68kops.parse_counts(sys.stdin, counts)[1]
+    if os.path.exists(path) and not os.path.isfile(path):
+        # A serial device:  ask for the dump
+        try:
+            import serial
+            dev = serial.Serial(path, baud, timeout=5)
+        except ImportError:
+            os.system('stty -F %s %d raw -echo' % (path, baud))
+            dev = open(path, 'r+b', buffering=0)
+        dev.write(b'ops\r')
+        lines = (l.decode('latin-1') for l in iter(dev.readline, b''))
+        return m68kops.parse_counts(lines, counts)[1]
+    with open(path, errors='replace') as f:
+        return m68kops.parse_counts(f, counts)[1]
+
+
+def table(title, rows, total_n, total_cyc, top):
+    """rows:  (name, executions, cycles), printed by cycles with a running total"""
+    print('%-28s %12s %6s %14s %6s %6s' % (title, 'executed', '%', 'est. cycles', '%', 'cum%'))
+    cum = 0
+    for name, n, cyc in sorted(rows, key=lambda r: (-r[2], r[0]))[:top]:
+        cum += cyc
+        print('%-28s %12u %5.1f%% %14u %5.1f%% %5.1f%%' %
+              (name, n, 100.0 * n / total_n, cyc, 100.0 * cyc / total_cyc, 100.0 * cum / total_cyc))
+    print()
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Rank Musashi opcode handlers by estimated cycles')
+    ap.add_argument('input', nargs='+', help='Serial device, saved logs, or - for stdin')
+    ap.add_argument('--ops', required=True, help="Musashi's generated m68kops.c")
+    ap.add_argument('-b', '--baud', type=int, default=115200)
+    ap.add_argument('-n', '--top', type=int, default=40, help='Handlers listed')
+    args = ap.parse_args()
+
+    handlers = m68kops.Handlers(args.ops)
+    counts = {}
+    overflow = 0
+    for path in args.input:
+        overflow += read_input(path, args.baud, counts)
+    if not counts:
+        sys.exit('No opcode counts')
+
+    by_handler = {}
+    for op, n in counts.items():
+        name, cyc = handlers.lookup(op)
+        h = by_handler.setdefault(name, [0, 0])
+        h[0] += n
+        h[1] += n * cyc
+    by_insn = {}
+    by_ea = {}
+    for name, (n, cyc) in by_handler.items():
+        for d, key in ((by_insn, m68kops.mnemonic(name)), (by_ea, m68kops.ea_family(name) or '(none)')):
+            e = d.setdefault(key, [0, 0])
+            e[0] += n
+            e[1] += cyc
+
+    total_n = sum(counts.values())
+    total_cyc = max(sum(c for _, c in by_handler.values()), 1)
+    print('%u instructions (%u more not counted), %u opcodes, %u handlers, ~%.2f cycles each\n' %
+          (total_n, overflow, len(counts), len(by_handler), total_cyc / total_n))
+    table('handler', [(k[len('m68k_op_'):], n, c) for k, (n, c) in by_handler.items()],
+          total_n, total_cyc, args.top)
+    table('instruction', [(k, n, c) for k, (n, c) in by_insn.items()], total_n, total_cyc, args.top)
+    table('addressing mode', [(k, n, c) for k, (n, c) in by_ea.items()], total_n, total_cyc, args.top)
+
+
+if __name__ == '__main__':
+    main()
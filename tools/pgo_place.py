@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+# Profile-guided placement of Musashi opcode handlers in SRAM
+#
+# Takes opcode counts from a USE_OPCOUNT build (the console's "ops" command,
+# or umac_bench's output), finds the handler each opcode ran, and picks the
+# most-executed handlers that fit in a budget of SRAM bytes.  It writes a
+# copy of m68kops.c with those handlers in .time_critical sections (which
+# the SDK's crt0 copies to SRAM), and a report.  Handler sizes come from nm
+# on an object built from the unmodified m68kops.c.
+#
+# The report estimates the XIP cache misses avoided by simulating the
+# RP2040's XIP cache (16KB, 2-way set-associative, 8-byte lines; modelled
+# as LRU) fetching each handler's code in turn, for a trace of opcodes
+# (umac_bench's UMAC_BENCH_TRACE), with and without the placement.  Each
+# execution is assumed to fetch all of its handler, and only the handlers
+# are modelled, not the rest of the code competing for the cache.
+#
+# Usage: pgo_place.py --ops m68kops.c --counts ops.txt [--counts ...]
+#            (--obj m68kops.o [--nm nm] | --sizes nm-S.txt) [--budget bytes]
+#            [--trace trace.bin] [-o m68kops_pgo.c] [--report report.txt]
+#
+# Copyright 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import array
+import os
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import m68kops
+
+XIP_SETS = 1024
+XIP_WAYS = 2
+XIP_LINE = 8
+ALIGN = 4
+
+
+def read_sizes(text):
+    """Function sizes, from 'nm -S' output"""
+    sizes = {}
+    for line in text.splitlines():
+        f = line.split()
+        if len(f) == 4 and f[2] in 'tT' and f[3].startswith('m68k_op_'):
+            sizes[f[3]] = int(f[1], 16)
+    return sizes
+
+
+def place(hits, sizes, budget):
+    """The most-executed handlers that fit, and the bytes they take"""
+    placed = []
+    used = 0
+    for name, n in sorted(hits.items(), key=lambda x: (-x[1], x[0])):
+        size = (sizes.get(name, 0) + ALIGN - 1) & ~(ALIGN - 1)
+        if size and used + size <= budget:
+            placed.append(name)
+            used += size
+    return placed, used
+
+
+def layout(order, sizes, placed):
+    """Each handler's XIP cache lines, for handlers laid out in flash in
+    source order (except those placed in SRAM, which have none)"""
+    lines = {}
+    addr = 0
+    for name in order:
+        size = sizes.get(name, 0)
+        if name in placed or not size:
+            lines[name] = ()
+            continue
+        lines[name] = tuple(range(addr // XIP_LINE, (addr + size - 1) // XIP_LINE + 1))
+        addr = (addr + size + ALIGN - 1) & ~(ALIGN - 1)
+    return lines
+
+
+def simulate(trace, handlers, lines):
+    """XIP cache misses fetching each traced opcode's handler"""
+    op_lines = {}
+    cache = [[-1] * XIP_WAYS for _ in range(XIP_SETS)]      # Most recent first
+    misses = 0
+    for op in trace:
+        ls = op_lines.get(op)
+        if ls is None:
+            ls = op_lines[op] = lines.get(handlers.lookup(op)[0], ())
+        for line in ls:
+            ways = cache[line % XIP_SETS]
+            tag = line // XIP_SETS
+            if ways[0] == tag:
+                continue
+            if tag in ways:
+                ways.remove(tag)
+            else:
+                ways.pop()
+                misses += 1
+            ways.insert(0, tag)
+    return misses
+
+
+def rewrite(handlers, placed, path):
+    """Write m68kops.c, with the placed handlers' definitions in SRAM"""
+    out = list(handlers.lines)
+    for name in placed:
+        i = handlers.defs.get(name)
+        if i is None or 'section' in out[i] or 'not_in_flash' in out[i]:
+            continue
+        out[i] = '__attribute__((section(".time_critical.%s"))) %s' % (name, out[i].lstrip())
+    with open(path, 'w') as f:
+        f.write('/* Generated by tools/pgo_place.py:  %u handlers in SRAM */\n' % len(placed))
+        f.write('#line 1 "%s"\n' % handlers.path)
+        f.writelines(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Place hot Musashi opcode handlers in SRAM')
+    ap.add_argument('--ops', required=True, help="Musashi's generated m68kops.c")
+    ap.add_argument('--counts', action='append', required=True, help='Opcode counts ("opc:" lines)')
+    ap.add_argument('--obj', help='Object built from m68kops.c, for handler sizes')
+    ap.add_argument('--nm', default='arm-none-eabi-nm')
+    ap.add_argument('--sizes', help="Or, 'nm -S' output for it")
+    ap.add_argument('--budget', type=int, default=16384, help='Bytes of SRAM (default 16384)')
+    ap.add_argument('--trace', help='Opcode trace (16-bit little-endian), for the XIP cache model')
+    ap.add_argument('-o', '--output', help='m68kops.c with the placement')
+    ap.add_argument('--report', help='Also write the report here')
+    args = ap.parse_args()
+
+    handlers = m68kops.Handlers(args.ops)
+    counts, overflow = m68kops.read_counts(args.counts)
+    if args.sizes:
+        with open(args.sizes) as f:
+            sizes = read_sizes(f.read())
+    elif args.obj:
+        sizes = read_sizes(subprocess.run([args.nm, '-S', args.obj], check=True,
+                                          capture_output=True, text=True).stdout)
+    else:
+        sys.exit('Handler sizes are needed:  --obj or --sizes')
+
+    hits = {}
+    for op, n in counts.items():
+        name = handlers.lookup(op)[0]
+        hits[name] = hits.get(name, 0) + n
+    total = sum(counts.values())
+    placed, used = place(hits, sizes, args.budget)
+    covered = sum(hits[n] for n in placed)
+
+    report = []
+    report.append('%u instructions counted (%u not), %u opcodes, %u handlers' %
+                  (total, overflow, len(counts), len(hits)))
+    report.append('Placed %u handlers in SRAM:  %u of %u bytes, running %.1f%% of instructions' %
+                  (len(placed), used, args.budget, 100.0 * covered / max(total, 1)))
+    if args.trace:
+        trace = array.array('H')
+        with open(args.trace, 'rb') as f:
+            trace.frombytes(f.read())
+        if sys.byteorder != 'little':
+            trace.byteswap()
+        order = handlers.source_order()
+        before = simulate(trace, handlers, layout(order, sizes, ()))
+        after = simulate(trace, handlers, layout(order, sizes, set(placed)))
+        n = max(len(trace), 1)
+        report.append('XIP cache model (%uKB, %u-way, %u-byte lines, LRU), %u traced instructions:' %
+                      (XIP_SETS * XIP_WAYS * XIP_LINE // 1024, XIP_WAYS, XIP_LINE, len(trace)))
+        report.append('  all in flash:    %9u misses (%.1f per 1000 instructions)' %
+                      (before, 1000.0 * before / n))
+        report.append('  with placement:  %9u misses (%.1f per 1000 instructions)' %
+                      (after, 1000.0 * after / n))
+        report.append('  avoided:         %9u misses (%.0f%%), so ~%u over the counted run' %
+                      (before - after, 100.0 * (before - after) / max(before, 1),
+                       (before - after) * total // n))
+    else:
+        report.append('No --trace, so no XIP cache model')
+    report.append('')
+    report.append('%12s %6s %6s  %s' % ('executed', '%', 'bytes', 'handler'))
+    for name in placed:
+        report.append('%12u %5.1f%% %6u  %s' % (hits[name], 100.0 * hits[name] / max(total, 1),
+                                               sizes[name], name))
+    missing = [n for n in hits if n not in sizes and n != m68kops.ILLEGAL]
+    if missing:
+        report.append('(no size for %u handlers executed, e.g. %s)' % (len(missing), missing[0]))
+
+    text = '\n'.join(report) + '\n'
+    sys.stdout.write(text)
+    if args.report:
+        with open(args.report, 'w') as f:
+            f.write(text)
+    if args.output:
+        rewrite(handlers, placed, args.output)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+#
+# Symbolise a pico-umac 68K PC profile (USE_PROFILE)
+#
+# Reads the "prof:" lines of the console's prof command (from a serial
+# device, which is sent the command, or from a saved log or stdin), and
+# reports where the 68K spent its time:  ROM samples are named by the
+# Toolbox/OS trap whose routine they follow (from the guest's trap dispatch
+# tables), and RAM samples by the code resource (CODE, DRVR, PTCH...) that
+# they're in, or the trap patch they follow.
+#
+# Usage: profsym.py [-b baud] [-n top] [--buckets] [-s save.txt] <device|file|->
+#
+# Copyright 2024 Matt Evans
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import bisect
+import os
+import re
+import sys
+
+# Trap names, by trap number
+TRAP_NAMES_TEXT = '''
+A000 Open A001 Close A002 Read A003 Write A004 Control A005 Status
+A006 KillIO A007 GetVolInfo A008 Create A009 Delete A00A OpenRF A00B Rename
+A00C GetFileInfo A00D SetFileInfo A00E UnmountVol A00F MountVol
+A010 Allocate A011 GetEOF A012 SetEOF A013 FlushVol A014 GetVol A015 SetVol
+A016 InitQueue A017 Eject A018 GetFPos A019 InitZone A01A GetZone
+A01B SetZone A01C FreeMem A01D MaxMem A01E NewPtr A01F DisposPtr
+A020 SetPtrSize A021 GetPtrSize A022 NewHandle A023 DisposHandle
+A024 SetHandleSize A025 GetHandleSize A026 HandleZone A027 ReallocHandle
+A028 RecoverHandle A029 HLock A02A HUnlock A02B EmptyHandle
+A02C InitApplZone A02D SetApplLimit A02E BlockMove A02F PostEvent
+A030 OSEventAvail A031 GetOSEvent A032 FlushEvents A033 VInstall
+A034 VRemove A035 OffLine A036 MoreMasters A037 ReadParam A038 WriteParam
+A039 ReadDateTime A03A SetDateTime A03B Delay A03C CmpString
+A03D DrvrInstall A03E DrvrRemove A03F InitUtil A040 ResrvMem
+A041 SetFilLock A042 RstFilLock A043 SetFilType A044 SetFPos A045 FlushFile
+A046 GetTrapAddress A047 SetTrapAddress A048 PtrZone A049 HPurge
+A04A HNoPurge A04B SetGrowZone A04C CompactMem A04D PurgeMem A04E AddDrive
+A04F RDrvrInstall A050 RelString A051 ReadXPRam A052 WriteXPRam
+A054 UprString A055 StripAddress A057 SetApplBase A058 InsTime A059 RmvTime
+A05A PrimeTime A060 FSDispatch A061 MaxBlock A062 PurgeSpace
+A063 MaxApplZone A064 MoveHHi A065 StackSpace A066 NewEmptyHandle
+A067 HSetRBit A068 HClrRBit A069 HGetState A06A HSetState
+A80D Count1Resources A80E Get1IxResource A80F Get1IxType A81C Count1Types
+A81F Get1Resource A820 Get1NamedResource
+A850 InitCursor A851 SetCursor A852 HideCursor A853 ShowCursor
+A855 ShieldCursor A856 ObscureCursor A858 BitAnd A859 BitXor A85A BitNot
+A85B BitOr A85C BitShift A85D BitTst A85E BitSet A85F BitClr A860 WaitNextEvent
+A861 Random A862 ForeColor A863 BackColor A864 ColorBit A865 GetPixel
+A866 StuffHex A867 LongMul A868 FixMul A869 FixRatio A86A HiWord A86B LoWord
+A86C FixRound A86D InitPort A86E InitGraf A86F OpenPort A870 LocalToGlobal
+A871 GlobalToLocal A872 GrafDevice A873 SetPort A874 GetPort A875 SetPBits
+A876 PortSize A877 MovePortTo A878 SetOrigin A879 SetClip A87A GetClip
+A87B ClipRect A87C BackPat A87D ClosePort A87E AddPt A87F SubPt A880 SetPt
+A881 EqualPt A882 StdText A883 DrawChar A884 DrawString A885 DrawText
+A886 TextWidth A887 TextFont A888 TextFace A889 TextMode A88A TextSize
+A88B GetFontInfo A88C StringWidth A88D CharWidth A88E SpaceExtra
+A890 StdLine A891 LineTo A892 Line A893 MoveTo A894 Move A896 HidePen
+A897 ShowPen A898 GetPenState A899 SetPenState A89A GetPen A89B PenSize
+A89C PenMode A89D PenPat A89E PenNormal A8A0 StdRect A8A1 FrameRect
+A8A2 PaintRect A8A3 EraseRect A8A4 InverRect A8A5 FillRect A8A6 EqualRect
+A8A7 SetRect A8A8 OffsetRect A8A9 InsetRect A8AA SectRect A8AB UnionRect
+A8AC Pt2Rect A8AD PtInRect A8AE EmptyRect A8AF StdRRect A8B0 FrameRoundRect
+A8B1 PaintRoundRect A8B2 EraseRoundRect A8B3 InverRoundRect
+A8B4 FillRoundRect A8B6 StdOval A8B7 FrameOval A8B8 PaintOval A8B9 EraseOval
+A8BA InvertOval A8BB FillOval A8BC SlopeFromAngle A8BD StdArc A8BE FrameArc
+A8BF PaintArc A8C0 EraseArc A8C1 InvertArc A8C2 FillArc A8C3 PtToAngle
+A8C4 AngleFromSlope A8C5 StdPoly A8C6 FramePoly A8C7 PaintPoly
+A8C8 ErasePoly A8C9 InvertPoly A8CA FillPoly A8CB OpenPoly A8CC ClosePgon
+A8CD KillPoly A8CE OffsetPoly A8CF PackBits A8D0 UnpackBits A8D1 StdRgn
+A8D2 FrameRgn A8D3 PaintRgn A8D4 EraseRgn A8D5 InverRgn A8D6 FillRgn
+A8D8 NewRgn A8D9 DisposRgn A8DA OpenRgn A8DB CloseRgn A8DC CopyRgn
+A8DD SetEmptyRgn A8DE SetRecRgn A8DF RectRgn A8E0 OfsetRgn A8E1 InsetRgn
+A8E2 EmptyRgn A8E3 EqualRgn A8E4 SectRgn A8E5 UnionRgn A8E6 DiffRgn
+A8E7 XorRgn A8E8 PtInRgn A8E9 RectInRgn A8EA SetStdProcs A8EB StdBits
+A8EC CopyBits A8ED StdTxMeas A8EE StdGetPic A8EF ScrollRect A8F0 StdPutPic
+A8F1 StdComment A8F2 PicComment A8F3 OpenPicture A8F4 ClosePicture
+A8F5 KillPicture A8F6 DrawPicture A8F8 ScalePt A8F9 MapPt A8FA MapRect
+A8FB MapRgn A8FC MapPoly A8FE InitFonts A8FF GetFName A900 GetFNum
+A901 FMSwapFont A902 RealFont A903 SetFontLock A904 DrawGrowIcon
+A905 DragGrayRgn A906 NewString A907 SetString A908 ShowHide A909 CalcVis
+A90A CalcVBehind A90B ClipAbove A90C PaintOne A90D PaintBehind A90E SaveOld
+A90F DrawNew A910 GetWMgrPort A911 CheckUpdate A912 InitWindows
+A913 NewWindow A914 DisposWindow A915 ShowWindow A916 HideWindow
+A917 GetWRefCon A918 SetWRefCon A919 GetWTitle A91A SetWTitle
+A91B MoveWindow A91C HiliteWindow A91D SizeWindow A91E TrackGoAway
+A91F SelectWindow A920 BringToFront A921 SendBehind A922 BeginUpdate
+A923 EndUpdate A924 FrontWindow A925 DragWindow A926 DragTheRgn
+A927 InvalRgn A928 InvalRect A929 ValidRgn A92A ValidRect A92B GrowWindow
+A92C FindWindow A92D CloseWindow A92E SetWindowPic A92F GetWindowPic
+A930 InitMenus A931 NewMenu A932 DisposMenu A933 AppendMenu
+A934 ClearMenuBar A935 InsertMenu A936 DeleteMenu A937 DrawMenuBar
+A938 HiliteMenu A939 EnableItem A93A DisableItem A93B GetMenuBar
+A93C SetMenuBar A93D MenuSelect A93E MenuKey A93F GetItmIcon A940 SetItmIcon
+A941 GetItmStyle A942 SetItmStyle A943 GetItmMark A944 SetItmMark
+A945 CheckItem A946 GetItem A947 SetItem A948 CalcMenuSize A949 GetMHandle
+A94A SetMFlash A94B PlotIcon A94C FlashMenuBar A94D AddResMenu A94E PinRect
+A94F DeltaPoint A950 CountMItems A951 InsertResMenu A954 NewControl
+A955 DisposControl A956 KillControls A957 ShowControl A958 HideControl
+A959 MoveControl A95A GetCRefCon A95B SetCRefCon A95C SizeControl
+A95D HiliteControl A95E GetCTitle A95F SetCTitle A960 GetCtlValue
+A961 GetMinCtl A962 GetMaxCtl A963 SetCtlValue A964 SetMinCtl A965 SetMaxCtl
+A966 TestControl A967 DragControl A968 TrackControl A969 DrawControls
+A96A GetCtlAction A96B SetCtlAction A96C FindControl A96E Dequeue
+A96F Enqueue A970 GetNextEvent A971 EventAvail A972 GetMouse A973 StillDown
+A974 Button A975 TickCount A976 GetKeys A977 WaitMouseUp A979 CouldDialog
+A97A FreeDialog A97B InitDialogs A97C GetNewDialog A97D NewDialog
+A97E SelIText A97F IsDialogEvent A980 DialogSelect A981 DrawDialog
+A982 CloseDialog A983 DisposDialog A985 Alert A986 StopAlert A987 NoteAlert
+A988 CautionAlert A989 CouldAlert A98A FreeAlert A98B ParamText
+A98C ErrorSound A98D GetDItem A98E SetDItem A98F SetIText A990 GetIText
+A991 ModalDialog A992 DetachResource A993 SetResPurge A994 CurResFile
+A995 InitResources A996 RsrcZoneInit A997 OpenResFile A998 UseResFile
+A999 UpdateResFile A99A CloseResFile A99B SetResLoad A99C CountResources
+A99D GetIndResource A99E CountTypes A99F GetIndType A9A0 GetResource
+A9A1 GetNamedResource A9A2 LoadResource A9A3 ReleaseResource
+A9A4 HomeResFile A9A5 SizeRsrc A9A6 GetResAttrs A9A7 SetResAttrs
+A9A8 GetResInfo A9A9 SetResInfo A9AA ChangedResource A9AB AddResource
+A9AD RmveResource A9AF ResError A9B0 WriteResource A9B1 CreateResFile
+A9B2 SystemEvent A9B3 SystemClick A9B4 SystemTask A9B5 SystemMenu
+A9B6 OpenDeskAcc A9B7 CloseDeskAcc A9B8 GetPattern A9B9 GetCursor
+A9BA GetString A9BB GetIcon A9BC GetPicture A9BD GetNewWindow
+A9BE GetNewControl A9BF GetRMenu A9C0 GetNewMBar A9C1 UniqueID A9C2 SysEdit
+A9C4 OpenRFPerm A9C5 RsrcMapEntry A9C6 Secs2Date A9C7 Date2Secs A9C8 SysBeep
+A9C9 SysError A9CB TEGetText A9CC TEInit A9CD TEDispose A9CE TextBox
+A9CF TESetText A9D0 TECalText A9D1 TESetSelect A9D2 TENew A9D3 TEUpdate
+A9D4 TEClick A9D5 TECopy A9D6 TECut A9D7 TEDelete A9D8 TEActivate
+A9D9 TEDeactivate A9DA TEIdle A9DB TEPaste A9DC TEKey A9DD TEScroll
+A9DE TEInsert A9DF TESetJust A9E0 Munger A9E1 HandToHand A9E2 PtrToXHand
+A9E3 PtrToHand A9E4 HandAndHand A9E5 InitPack A9E6 InitAllPacks A9E7 Pack0
+A9E8 Pack1 A9E9 Pack2 A9EA Pack3 A9EB Pack4 A9EC Pack5 A9ED Pack6 A9EE Pack7
+A9EF PtrAndHand A9F0 LoadSeg A9F1 UnloadSeg A9F2 Launch A9F3 Chain
+A9F4 ExitToShell A9F5 GetAppParms A9F6 GetResFileAttrs A9F7 SetResFileAttrs
+A9F9 InfoScrap A9FA UnlodeScrap A9FB LodeScrap A9FC ZeroScrap A9FD GetScrap
+A9FE PutScrap A9FF Debugger
+'''
+TRAP_NAMES = {int(n, 16): '_' + name for n, name in
+              zip(TRAP_NAMES_TEXT.split()[::2], TRAP_NAMES_TEXT.split()[1::2])}
+
+# Unimplemented traps all dispatch to one routine
+ALIAS_LIMIT = 8
+# How far past a trap's entry point (in RAM) samples are still attributed
+PATCH_REACH = 0x1000
+
+
+def trap_name(num):
+    return TRAP_NAMES.get(num, '_Trap$%04X' % num)
+
+
+class Profile:
+    def __init__(self):
+        self.samples = self.idle = self.other = self.interval = 0
+        self.ram_size = self.ram_shift = 0
+        self.rom_base, self.rom_size, self.rom_shift = 0x400000, 0x20000, 6
+        self.buckets = []       # (addr, count)
+        self.traps = {}         # addr -> [trap numbers]
+        self.resources = []     # (addr, size, label)
+        self.app = ''
+        self.complete = False
+
+    def parse(self, line):
+        m = re.search(r'prof: (\w+) ?(.*)', line)
+        if not m:
+            return
+        kind, rest = m.group(1), m.group(2).rstrip('\r\n')
+        f = rest.split()
+        if kind == 'samples':
+            self.samples, self.idle, self.other, self.interval = (int(x) for x in f[0::2])
+        elif kind == 'ram':
+            self.ram_size, self.ram_shift = int(f[0], 16), int(f[1])
+        elif kind == 'rom':
+            self.rom_base, self.rom_size, self.rom_shift = int(f[0], 16), int(f[1], 16), int(f[2])
+        elif kind == 'b':
+            self.buckets.append((int(f[0], 16), int(f[1])))
+        elif kind == 'app':
+            self.app = rest
+        elif kind == 'trap':
+            self.traps.setdefault(int(f[1], 16), []).append(int(f[0], 16))
+        elif kind == 'res':
+            rtype, rid, addr, size = rest[:4], f[1], int(f[2], 16), int(f[3], 16)
+            name = rest.split(None, 4)[4] if len(f) > 4 else ''
+            label = '%s %s' % (rtype, rid) + (' "%s"' % name if name else '')
+            self.resources.append((addr, size, label))
+        elif kind == 'end':
+            self.complete = True
+
+    def in_rom(self, addr):
+        return self.rom_base <= addr < self.rom_base + self.rom_size
+
+
+class Symboliser:
+    def __init__(self, prof):
+        self.prof = prof
+        self.entries = []       # Sorted (addr, name) of trap routines
+        for addr, nums in prof.traps.items():
+            if addr == 0:
+                continue
+            if len(nums) > ALIAS_LIMIT:
+                name = '(unimplemented trap)'
+            else:
+                name = '/'.join(trap_name(n) for n in sorted(nums))
+            self.entries.append((addr, name))
+        self.entries.sort()
+        self.addrs = [a for a, _ in self.entries]
+        self.resources = sorted(prof.resources)
+
+    def lookup(self, addr):
+        """(symbol, offset) for a sampled address"""
+        prof = self.prof
+        for base, size, label in self.resources:
+            if base <= addr < base + size:
+                return label, addr - base
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if prof.in_rom(addr):
+            if i >= 0 and prof.in_rom(self.addrs[i]):
+                return self.entries[i][1], addr - self.addrs[i]
+            return 'ROM', addr - prof.rom_base
+        if i >= 0 and not prof.in_rom(self.addrs[i]) and addr - self.addrs[i] < PATCH_REACH:
+            return self.entries[i][1] + ' (patch)', addr - self.addrs[i]
+        return 'RAM', addr
+
+
+def read_dump(path, baud, save):
+    prof = Profile()
+    if path == '-':
+        lines = sys.stdin
+    elif os.path.exists(path) and not os.path.isfile(path):
+        # A serial device:  ask for the dump
+        try:
+            import serial
+            dev = serial.Serial(path, baud, timeout=5)
+        except ImportError:
+            os.system('stty -F %s %d raw -echo' % (path, baud))
+            dev = open(path, 'r+b', buffering=0)
+        dev.write(b'prof\r')
+        lines = (l.decode('latin-1') for l in iter(dev.readline, b''))
+    else:
+        lines = open(path, errors='replace')
+    out = open(save, 'w') if save else None
+    for line in lines:
+        if out and 'prof: ' in line:
+            out.write(line[line.index('prof: '):].rstrip('\r\n') + '\n')
+        prof.parse(line)
+        if prof.complete:
+            break
+    if not prof.complete:
+        sys.stderr.write('warning: no "prof: end" line, the dump is incomplete\n')
+    return prof
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Symbolise a pico-umac 68K PC profile')
+    ap.add_argument('input', help='Serial device, saved log, or - for stdin')
+    ap.add_argument('-b', '--baud', type=int, default=115200)
+    ap.add_argument('-n', '--top', type=int, default=30, help='Symbols listed')
+    ap.add_argument('--buckets', action='store_true', help='Also list the busiest buckets')
+    ap.add_argument('-s', '--save', help='Save the raw dump, to symbolise again later')
+    args = ap.parse_args()
+
+    prof = read_dump(args.input, args.baud, args.save)
+    sym = Symboliser(prof)
+    total = sum(c for _, c in prof.buckets) + prof.other
+    if total == 0:
+        sys.exit('No samples')
+
+    by_sym = {}
+    for addr, count in prof.buckets:
+        name, _ = sym.lookup(addr)
+        by_sym[name] = by_sym.get(name, 0) + count
+    if prof.other:
+        by_sym['(outside RAM and ROM)'] = prof.other
+
+    rom = sum(c for a, c in prof.buckets if prof.in_rom(a))
+    all_samples = total + prof.idle
+    print('Application: %s' % (prof.app or '?'))
+    print('%u samples (~%.1fs), %.1f%% idle; of the 68K time %.1f%% ROM, %.1f%% RAM' %
+          (total, all_samples * prof.interval / 1e6, 100.0 * prof.idle / all_samples,
+           100.0 * rom / total, 100.0 * (total - rom - prof.other) / total))
+    print('Buckets are %u bytes (ROM), %u bytes (RAM):  ROM code is named by the trap'
+          % (1 << prof.rom_shift, 1 << prof.ram_shift))
+    print('routine it follows, which may be a callee or an internal routine.\n')
+    print('%7s %8s  %s' % ('%', 'samples', 'symbol'))
+    for name, count in sorted(by_sym.items(), key=lambda x: -x[1])[:args.top]:
+        print('%6.2f%% %8u  %s' % (100.0 * count / total, count, name))
+
+    if args.buckets:
+        print('\n%7s %8s  %-8s %s' % ('%', 'samples', 'address', 'symbol'))
+        for addr, count in sorted(prof.buckets, key=lambda x: -x[1])[:args.top]:
+            name, off = sym.lookup(addr)
+            print('%6.2f%% %8u  $%06X  %s+$%X' % (100.0 * count / total, count, addr, name, off))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,166 @@
+/*
+ * scancheck:  checks of video_scan's pixel access and video_timing's
+ * per-line config words, at 1, 2 and 4 bits per pixel
+ *
+ * The firmware only builds at 1BPP (the Mac's), so this exercises the
+ * other depths directly.  Pixels set in a line must land in Mac order
+ * (bytes left to right, MSB-first), leave their neighbours alone, and read
+ * back.  For every mode that takes a framebuffer of a depth, the config
+ * words must give the line's timing, VS and DE, and the pixel count, and
+ * a line that isn't whole words must be rejected.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "video_scan.h"
+#include "video_timing.h"
+
+#define SYS_KHZ         250000
+#define LINE_PIXELS     256
+#define LINE_WORDS      VIDEO_SCAN_WPL(LINE_PIXELS, 4)
+
+static unsigned int failures = 0;
+
+/* The line's bytes for pixel values v[], packed here independently */
+static void     pack(const unsigned int *v, unsigned int bpp, uint8_t *out)
+{
+        memset(out, 0, LINE_PIXELS * bpp / 8);
+        for (unsigned int x = 0; x < LINE_PIXELS; x++)
+                out[x / (8 / bpp)] |= v[x] << (8 - bpp * (x % (8 / bpp) + 1));
+}
+
+static void     check_pixels(unsigned int bpp)
+{
+        uint32_t line[LINE_WORDS];
+        unsigned int v[LINE_PIXELS];
+        uint8_t expect[LINE_WORDS * 4];
+        unsigned int max = (1 << bpp) - 1;
+        unsigned int bytes = LINE_PIXELS * bpp / 8;
+
+        /* Each value at each position, on a line of 0s and of max */
+        for (unsigned int bg = 0; bg <= max; bg += max) {
+                for (unsigned int x = 0; x < LINE_PIXELS; x++) {
+                        for (unsigned int val = 0; val <= max; val++) {
+                                for (unsigned int i = 0; i < LINE_PIXELS; i++) {
+                                        v[i] = bg;
+                                        video_scan_put_pixel(line, i, bpp, bg);
+                                }
+                                v[x] = val;
+                                video_scan_put_pixel(line, x, bpp, val);
+                                pack(v, bpp, expect);
+                                if (memcmp(line, expect, bytes) ||
+                                    video_scan_get_pixel(line, x, bpp) != val) {
+                                        printf("FAIL: %ubpp: pixel %u = %u on %u\n", bpp, x, val, bg);
+                                        failures++;
+                                }
+                        }
+                }
+        }
+
+        /* Random lines, and values too big for the depth are masked */
+        for (unsigned int n = 0; n < 1000; n++) {
+                memset(line, rand(), sizeof(line));
+                for (unsigned int i = 0; i < LINE_PIXELS; i++) {
+                        unsigned int r = rand() & 0xff;
+
+                        v[i] = r & max;
+                        video_scan_put_pixel(line, i, bpp, r);
+                }
+                pack(v, bpp, expect);
+                if (memcmp(line, expect, bytes)) {
+                        printf("FAIL: %ubpp: random line %u\n", bpp, n);
+                        failures++;
+                }
+                for (unsigned int i = 0; i < LINE_PIXELS; i++) {
+                        if (video_scan_get_pixel(line, i, bpp) != v[i]) {
+                                printf("FAIL: %ubpp: random line %u, pixel %u reads wrong\n",
+                                       bpp, n, i);
+                                failures++;
+                                break;
+                        }
+                }
+        }
+}
+
+/* Check the config words for each mode of a table that can show an FB
+ * fb_w wide at bpp, and that an FB line of part of a word is rejected.
+ */
+static void     check_timing(const video_timing_t *table, bool lcd, unsigned int bpp)
+{
+        for (const video_timing_t *t = table; t->name; t++) {
+                unsigned int fb_w = lcd ? t->hres : (t->scale == 2 ? 512 : 640);
+                unsigned int fb_h = lcd ? t->vres : t->vres / t->scale;
+                const char *err = video_timing_check(t, fb_w, fb_h, bpp, SYS_KHZ, lcd);
+                uint32_t cfg[6];
+
+                if (err) {
+                        printf("FAIL: %s, %ubpp: %s\n", t->name, bpp, err);
+                        failures++;
+                        continue;
+                }
+                if (VIDEO_SCAN_WPL(fb_w, bpp) * 32 != fb_w * bpp) {
+                        printf("FAIL: %s, %ubpp: words per line\n", t->name, bpp);
+                        failures++;
+                }
+
+                video_timing_cfg(t, fb_w, lcd, cfg);
+                for (unsigned int i = 0; i < 3; i++) {
+                        const uint32_t *c = &cfg[i * 2];
+                        bool vs = (c[0] >> 31) & 1;
+                        bool de = (c[0] >> 6) & 1;
+
+                        if (vs != (i == 0) || de != (lcd && i == 2) || c[1] != fb_w - 1 ||
+                            video_timing_line_pclks(c, t->scale, lcd) !=
+                            video_timing_h_total(t) + (lcd ? 0 : 2)) {
+                                printf("FAIL: %s, %ubpp: config words %u wrong (%08x %08x)\n",
+                                       t->name, bpp, i, c[0], c[1]);
+                                failures++;
+                        }
+                }
+
+                /* A line of fb_w - 4 pixels isn't whole words at any depth */
+                if (!video_timing_check(t, fb_w - 4, fb_h, bpp, SYS_KHZ, lcd)) {
+                        printf("FAIL: %s, %ubpp: part-word line accepted\n", t->name, bpp);
+                        failures++;
+                }
+        }
+}
+
+int     main(int argc, char *argv[])
+{
+        for (unsigned int bpp = 1; bpp <= 4; bpp *= 2) {
+                check_pixels(bpp);
+                check_timing(video_vga_modes, false, bpp);
+                check_timing(video_lcd_panels, true, bpp);
+        }
+        if (failures) {
+                printf("scancheck:  %u failures\n", failures);
+                return 1;
+        }
+        printf("scancheck:  OK\n");
+        return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * screencheck:  checks of the screen buffer that poll_fb_page() follows
+ *
+ * main.c reads VIA port A from umac, and mac_screen_offset() picks the
+ * main or alternate screen buffer from its bit 6.  Here a fake port A is
+ * given every value, for each RAM size, and the offset must be the one
+ * Inside Macintosh gives (e.g. $1A700/$12700 for 128K), whatever the
+ * other bits are.  Both buffers must fit in RAM without overlapping.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "maclowmem.h"
+
+#define SCREEN_BYTES    (512 * 342 / 8)
+
+static const struct {
+        unsigned int    ram_size;
+        unsigned int    main, alt;
+} sizes[] = {
+        { 128 * 1024,   0x1a700,        0x12700 },
+        { 208 * 1024,   0x2e700,        0x26700 },
+        { 512 * 1024,   0x7a700,        0x72700 },
+        { 1024 * 1024,  0xfa700,        0xf2700 },
+        { 4096 * 1024,  0x3fa700,       0x3f2700 },
+};
+
+int     main(int argc, char *argv[])
+{
+        unsigned int failures = 0;
+
+        for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+                unsigned int ram_size = sizes[i].ram_size;
+
+                for (unsigned int bufa = 0; bufa < 256; bufa++) {
+                        unsigned int o = mac_screen_offset(bufa, ram_size);
+                        unsigned int expect = (bufa & 0x40) ? sizes[i].main : sizes[i].alt;
+
+                        if (o != expect) {
+                                printf("FAIL: %uK, port A %02x:  offset %x, not %x\n",
+                                       ram_size / 1024, bufa, o, expect);
+                                failures++;
+                        }
+                }
+                if (sizes[i].main + SCREEN_BYTES > ram_size ||
+                    sizes[i].alt + SCREEN_BYTES > sizes[i].main) {
+                        printf("FAIL: %uK, screen buffers don't fit\n", ram_size / 1024);
+                        failures++;
+                }
+        }
+        if (failures) {
+                printf("screencheck:  %u failures\n", failures);
+                return 1;
+        }
+        printf("screencheck:  OK\n");
+        return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * blitcheck:  checks blit.c's kernels against a pixel-at-a-time model
+ *
+ * Random fills and copies (at every bit alignment, and overlapping in
+ * both directions) are done by the kernels and by the model, and the
+ * whole of each buffer is compared.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blit.h"
+
+#define MAX_ROW_BYTES           (BLIT_MAX_ROW_BYTES + 16)
+#define MAX_ROWS                40
+#define BUF_SIZE                (MAX_ROW_BYTES * MAX_ROWS)
+
+static uint8_t  buf[BUF_SIZE], src_buf[BUF_SIZE], ref[BUF_SIZE], before[BUF_SIZE];
+static unsigned int failures = 0;
+
+static int      get_px(const uint8_t *b, unsigned int rb, unsigned int x, unsigned int y)
+{
+        return (b[y * rb + x / 8] >> (7 - x % 8)) & 1;
+}
+
+static void     set_px(uint8_t *b, unsigned int rb, unsigned int x, unsigned int y, int v)
+{
+        uint8_t m = 0x80 >> (x % 8);
+
+        b[y * rb + x / 8] = v ? (b[y * rb + x / 8] | m) : (b[y * rb + x / 8] & ~m);
+}
+
+static void     randomise(uint8_t *b, unsigned int len)
+{
+        for (unsigned int i = 0; i < len; i++)
+                b[i] = rand();
+}
+
+static void     check(const char *what, unsigned int n, const uint8_t *a, const uint8_t *b)
+{
+        for (unsigned int i = 0; i < BUF_SIZE; i++) {
+                if (a[i] != b[i]) {
+                        printf("FAIL: %s %u:  byte %u is %02x, not %02x\n", what, n, i, a[i], b[i]);
+                        failures++;
+                        return;
+                }
+        }
+}
+
+static void     check_fill(unsigned int n)
+{
+        unsigned int rb = 1 + rand() % 40;
+        unsigned int rows = 1 + rand() % MAX_ROWS;
+        unsigned int x = rand() % (rb * 8);
+        unsigned int y = rand() % rows;
+        unsigned int w = rand() % (rb * 8 - x + 1);
+        unsigned int h = rand() % (rows - y + 1);
+        unsigned int pat_y = rand() % 8;
+        uint8_t pat[8];
+
+        randomise(pat, 8);
+        randomise(buf, BUF_SIZE);
+        memcpy(ref, buf, BUF_SIZE);
+
+        for (unsigned int j = 0; j < h; j++)
+                for (unsigned int i = 0; i < w; i++)
+                        set_px(ref, rb, x + i, y + j, (pat[(pat_y + j) & 7] >> (7 - (x + i) % 8)) & 1);
+        blit_fill(buf, rb, x, y, w, h, pat, pat_y);
+        check("fill", n, buf, ref);
+}
+
+/* overlap:  copy within buf, otherwise from src_buf (whose row bytes differ) */
+static void     check_copy(unsigned int n, bool overlap, unsigned int max_rb)
+{
+        unsigned int rb = 1 + rand() % max_rb;
+        unsigned int srb = overlap ? rb : 1 + rand() % max_rb;
+        unsigned int rows = 1 + rand() % MAX_ROWS;
+        unsigned int w = rand() % (rb < srb ? rb * 8 + 1 : srb * 8 + 1);
+        unsigned int h = rand() % (rows + 1);
+        unsigned int dx = rand() % (rb * 8 - w + 1);
+        unsigned int sx = rand() % (srb * 8 - w + 1);
+        unsigned int dy = rand() % (rows - h + 1);
+        unsigned int sy = rand() % (rows - h + 1);
+        const uint8_t *src = overlap ? buf : src_buf;
+        static uint8_t px[MAX_ROW_BYTES * 8 * MAX_ROWS];
+
+        randomise(buf, BUF_SIZE);
+        randomise(src_buf, BUF_SIZE);
+        memcpy(ref, buf, BUF_SIZE);
+        memcpy(before, buf, BUF_SIZE);
+
+        /* Read all of the source before writing any of the destination */
+        for (unsigned int j = 0; j < h; j++)
+                for (unsigned int i = 0; i < w; i++)
+                        px[j * w + i] = get_px(src, srb, sx + i, sy + j);
+        for (unsigned int j = 0; j < h; j++)
+                for (unsigned int i = 0; i < w; i++)
+                        set_px(ref, rb, dx + i, dy + j, px[j * w + i]);
+
+        bool done = blit_copy(buf, rb, dx, dy, src, srb, sx, sy, w, h);
+        bool wide = (dx & 7) != (sx & 7) && w && h && ((dx + w - 1) / 8 - dx / 8 + 1) > BLIT_MAX_ROW_BYTES;
+
+        if (wide) {
+                if (done) {
+                        printf("FAIL: copy %u:  too wide, but done\n", n);
+                        failures++;
+                }
+                check("copy (too wide)", n, buf, before);
+        } else if (!done) {
+                printf("FAIL: copy %u:  not done\n", n);
+                failures++;
+        } else {
+                check(overlap ? "copy (overlapping)" : "copy", n, buf, ref);
+        }
+}
+
+int     main(int argc, char *argv[])
+{
+        unsigned int n = argc > 1 ? atoi(argv[1]) : 20000;
+
+        srand(1);
+        for (unsigned int i = 0; i < n; i++) {
+                check_fill(i);
+                check_copy(i, false, 40);
+                check_copy(i, true, 40);
+        }
+        /* Rows wider than the staging buffer */
+        for (unsigned int i = 0; i < n / 20; i++)
+                check_copy(i, i & 1, MAX_ROW_BYTES);
+
+        if (failures) {
+                printf("blitcheck: %u failures\n", failures);
+                return 1;
+        }
+        printf("blitcheck: %u fills and %u copies OK\n", n, 2 * n + n / 20);
+        return 0;
+}
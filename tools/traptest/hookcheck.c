@@ -0,0 +1,252 @@
+/*
+ * hookcheck:  runs the instruction hook (hook_m68kconf.h) on a mock CPU
+ *
+ * The mock fetches and executes as Musashi does:  the hook's called with
+ * the PC, and then the instruction's fetched from wherever the PC is
+ * afterwards.  It only knows NOP, BRA.S and ILLEGAL (which stops it); an
+ * A-line instruction it executes is a call to the ROM.  Native traps placed
+ * back to back must all be run by traps.c, each counted once by opcount.c,
+ * and idle.c must see an event call straight after one.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hook_m68kconf.h"
+#include "m68k.h"
+
+#define RAM_SIZE                0x10000
+#define ROM_TRAPS               (MAC_ROM_BASE + 0x100)  /* Where the dispatch table points */
+#define CODE                    0x2000
+#define SRC                     0x4000
+#define DST                     0x5000
+#define STACK                   0x8000
+#define EVENT                   0x9000
+#define TRACE_LEN               64
+
+#define OP_NOP                  0x4e71
+#define OP_ILLEGAL              0x4afc
+#define OP_BRA_S                0x6000
+
+static uint8_t  ram[RAM_SIZE], rom[MAC_ROM_SIZE];
+static unsigned int regs[M68K_REG_NUM];
+static unsigned int rom_calls;
+static bool     stopped;
+static unsigned int failures = 0;
+
+unsigned int m68k_get_reg(void *context, m68k_register_t reg)
+{
+        return regs[reg];
+}
+
+void    m68k_set_reg(m68k_register_t reg, unsigned int value)
+{
+        regs[reg] = value;
+}
+
+void    m68k_end_timeslice(void)
+{
+        stopped = true;
+}
+
+static void     wr16(uint32_t a, uint16_t v)
+{
+        ram[a] = v >> 8;
+        ram[a + 1] = v;
+}
+
+static void     wr32(uint32_t a, uint32_t v)
+{
+        wr16(a, v >> 16);
+        wr16(a + 2, v);
+}
+
+static uint16_t fetch(uint32_t a)
+{
+        a &= 0xffffff;
+        if (a >= MAC_ROM_BASE)
+                return (rom[a - MAC_ROM_BASE] << 8) | rom[a - MAC_ROM_BASE + 1];
+        return (ram[a] << 8) | ram[a + 1];
+}
+
+/* As m68k_execute(), for at most max instructions */
+static void     run(uint32_t pc, unsigned int max)
+{
+        regs[M68K_REG_PC] = pc;
+        stopped = false;
+        for (unsigned int i = 0; i < max && !stopped; i++) {
+                M68K_INSTRUCTION_CALLBACK(regs[M68K_REG_PC]);
+                regs[M68K_REG_IR] = fetch(regs[M68K_REG_PC]);
+                regs[M68K_REG_PC] += 2;
+
+                uint16_t op = regs[M68K_REG_IR];
+                if (op == OP_ILLEGAL)
+                        stopped = true;
+                else if ((op & 0xf000) == 0xa000)
+                        rom_calls++;
+                else if ((op & 0xff00) == OP_BRA_S)
+                        regs[M68K_REG_PC] += (int8_t)op;
+                else if (op != OP_NOP) {
+                        printf("FAIL: mock CPU can't run %04x at %06x\n", op, regs[M68K_REG_PC] - 2);
+                        failures++;
+                        stopped = true;
+                }
+        }
+}
+
+static void     code(const uint16_t *ops, unsigned int n)
+{
+        for (unsigned int i = 0; i < n; i++)
+                wr16(CODE + i * 2, ops[i]);
+}
+
+/* The opcodes counted since opcount_trace_start(), in order */
+static unsigned int traced(uint16_t *ops)
+{
+        FILE *f = tmpfile();
+        unsigned int n = 0;
+        int lo, hi;
+
+        opcount_trace_write(f);
+        rewind(f);
+        while (n < TRACE_LEN && (lo = fgetc(f)) != EOF && (hi = fgetc(f)) != EOF)
+                ops[n++] = lo | (hi << 8);
+        fclose(f);
+        return n;
+}
+
+static void     check_ops(const char *what, const uint16_t *want, unsigned int n)
+{
+        uint16_t ops[TRACE_LEN];
+        unsigned int got = traced(ops);
+
+        if (got != n || memcmp(ops, want, n * sizeof(*ops))) {
+                printf("FAIL: %s:  counted", what);
+                for (unsigned int i = 0; i < got; i++)
+                        printf(" %04x", ops[i]);
+                printf(", not");
+                for (unsigned int i = 0; i < n; i++)
+                        printf(" %04x", want[i]);
+                printf("\n");
+                failures++;
+        }
+}
+
+static void     check_val(const char *what, unsigned int got, unsigned int want)
+{
+        if (got != want) {
+                printf("FAIL: %s is %x, not %x\n", what, got, want);
+                failures++;
+        }
+}
+
+/* BlockMove(A0, A1, D0), for each trap in a row */
+static void     setup_blockmove(int32_t count)
+{
+        memset(regs, 0, sizeof(regs));
+        regs[M68K_REG_A0] = SRC;
+        regs[M68K_REG_A1] = DST;
+        regs[M68K_REG_D0] = count;
+        for (unsigned int i = 0; i < 16; i++) {
+                ram[SRC + i] = 0x10 + i;
+                ram[DST + i] = 0;
+        }
+        rom_calls = 0;
+        opcount_trace_start(TRACE_LEN);
+}
+
+static void     check_back_to_back(void)
+{
+        static const uint16_t ops[] = { OP_NOP, TRAP_BLOCKMOVE, TRAP_BLOCKMOVE, OP_NOP, OP_ILLEGAL };
+        /* The first count is IR before the run (0), and ILLEGAL stops the
+         * CPU before it's counted
+         */
+        static const uint16_t counted[] = { 0, OP_NOP, TRAP_BLOCKMOVE, TRAP_BLOCKMOVE, OP_NOP };
+
+        code(ops, 5);
+
+        /* Both native:  the first moves 16 bytes, and leaves D0 0 */
+        setup_blockmove(16);
+        run(CODE, 10);
+        check_val("native:  ROM calls", rom_calls, 0);
+        check_val("native:  PC", regs[M68K_REG_PC], CODE + 10);
+        check_val("native:  D0", regs[M68K_REG_D0], 0);
+        check_val("native:  moved", memcmp(ram + DST, ram + SRC, 16) == 0, 1);
+        check_ops("native", counted, 5);
+
+        /* Both left to the ROM (a negative count), and counted from IR */
+        setup_blockmove(-1);
+        run(CODE, 10);
+        check_val("ROM:  ROM calls", rom_calls, 2);
+        check_val("ROM:  PC", regs[M68K_REG_PC], CODE + 10);
+        check_ops("ROM", counted, 5);
+}
+
+/* An application's event loop, with a native trap just before its
+ * GetNextEvent:  each call must be seen, so the null events it returns
+ * make the guest idle.
+ */
+static void     check_trap_then_event(void)
+{
+        static const uint16_t ops[] = { TRAP_BLOCKMOVE, TRAP_GETNEXTEVENT, OP_BRA_S | 0xfa };
+
+        code(ops, 3);
+        setup_blockmove(0);
+        /* GetNextEvent's event record, whose what field is 0 (null) */
+        regs[M68K_REG_A7] = STACK;
+        wr32(STACK, EVENT);
+        memset(ram + EVENT, 0, 16);
+        memset(&idle_stats, 0, sizeof(idle_stats));
+        idle_ret = IDLE_NO_RET;
+        idle_hit = false;
+        idle_wake();
+
+        run(CODE, 100);
+        check_val("idle:  event calls", idle_stats.calls, IDLE_NULL_EVENTS + 1);
+        check_val("idle:  null events", idle_stats.nulls, IDLE_NULL_EVENTS);
+        check_val("idle:  hit", idle_hit, 1);
+        /* The last call's still made, before the quantum ends */
+        check_val("idle:  ROM calls", rom_calls, IDLE_NULL_EVENTS + 1);
+        check_val("idle:  PC", regs[M68K_REG_PC], CODE + 4);
+}
+
+int     main(int argc, char *argv[])
+{
+        /* BlockMove's dispatch entry is in the ROM, so it may run natively */
+        wr32(MAC_OSTABLE + (TRAP_BLOCKMOVE & 0xff) * 4, ROM_TRAPS);
+        traps_init(ram, RAM_SIZE, rom, MAC_ROM_SIZE);
+        idle_init(ram, RAM_SIZE, rom, MAC_ROM_SIZE);
+
+        check_back_to_back();
+        check_trap_then_event();
+
+        if (failures) {
+                printf("hookcheck: %u failures\n", failures);
+                return 1;
+        }
+        printf("hookcheck:  OK\n");
+        return 0;
+}
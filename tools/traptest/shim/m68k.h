@@ -0,0 +1,24 @@
+/* hookcheck stand-in for Musashi's m68k.h
+ *
+ * Just the registers and calls that traps.c, opcount.c and idle.c use;
+ * hookcheck.c is the CPU behind them.
+ */
+#ifndef HOOKCHECK_M68K_H
+#define HOOKCHECK_M68K_H
+
+typedef enum {
+        M68K_REG_D0, M68K_REG_D1, M68K_REG_D2, M68K_REG_D3,
+        M68K_REG_D4, M68K_REG_D5, M68K_REG_D6, M68K_REG_D7,
+        M68K_REG_A0, M68K_REG_A1, M68K_REG_A2, M68K_REG_A3,
+        M68K_REG_A4, M68K_REG_A5, M68K_REG_A6, M68K_REG_A7,
+        M68K_REG_PC,
+        M68K_REG_SR,
+        M68K_REG_IR,
+        M68K_REG_NUM
+} m68k_register_t;
+
+unsigned int m68k_get_reg(void *context, m68k_register_t reg);
+void    m68k_set_reg(m68k_register_t reg, unsigned int value);
+void    m68k_end_timeslice(void);
+
+#endif
@@ -0,0 +1,12 @@
+/* hookcheck stand-in for umac's m68kconf.h
+ *
+ * Just what hook_m68kconf.h needs to define the instruction hook.
+ */
+#ifndef HOOKCHECK_M68KCONF_H
+#define HOOKCHECK_M68KCONF_H
+
+#define OPT_OFF                 0
+#define OPT_ON                  1
+#define OPT_SPECIFY_HANDLER     2
+
+#endif
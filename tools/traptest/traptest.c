@@ -0,0 +1,470 @@
+/*
+ * traptest:  compares native traps (traps.c) with the ROM's, in umac
+ *
+ * umac boots the ROM (to the disc prompt, with no disc), and the machine
+ * is saved.  Then each case is set up from it twice, from the same random
+ * seed:  its arguments, and the port, bitmaps and data they refer to, are
+ * written to guest memory, and a stub calls the trap.  The first run has
+ * native traps off, so the ROM does the work, and the second has them on.
+ * Guest RAM must match bit-for-bit afterwards (except the stack the ROM
+ * used below the caller's), as must the registers the trap preserves.
+ * Interrupts are masked, so nothing else runs.
+ *
+ * Cases include ones that traps.c leaves to the ROM (clipping, scaling,
+ * the cursor), to check that it does.
+ *
+ *      traptest <rom.bin> [cases]
+ *
+ * The ROM is umac's patched image, as for the firmware.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "umac.h"
+#include "m68k.h"
+#include "traps.h"
+
+#define ROM_SIZE                MAC_ROM_SIZE
+#define MAC_CLOCK_HZ            7833600
+#define QUANTUM                 5000
+#define BOOT_SECONDS            5
+
+#define MAC_CURRENTA5           0x904   /* Ptr:  the A5 world, QuickDraw's globals */
+#define MAC_HEAPEND             0x114   /* Ptr:  end of the application heap */
+
+/* Scratch memory, just below the stack:  the stub, a port and its
+ * regions, two bitmaps and a buffer.  The stack below the caller's is
+ * left STACK_ROOM for the ROM.
+ */
+#define STACK_ROOM              0x1000
+#define SCRATCH_SIZE            0x2000
+#define S_STUB                  0x000
+#define S_PORT                  0x010
+#define S_VIS_MP                0x080
+#define S_CLIP_MP               0x084
+#define S_VIS_RGN               0x090
+#define S_CLIP_RGN              0x0a0
+#define S_RECT_A                0x0b0
+#define S_RECT_B                0x0b8
+#define S_PAT                   0x0c0
+#define S_SRC_BITMAP            0x0d0
+#define S_DST_BITMAP            0x0e0
+#define S_BITS_1                0x100
+#define S_BITS_2                0x800
+#define S_BUF                   0x1000
+#define S_BUF_SIZE              0x1000
+
+#define BITS_ROW_BYTES          24
+#define BITS_ROWS               64
+
+#define RUN_LIMIT               10000   /* 1000-cycle slices, before giving up */
+
+static uint8_t  ram[RAM_SIZE];
+static uint8_t  rom[ROM_SIZE];
+
+static uint8_t  base_ram[RAM_SIZE];
+static void     *base_ctx;
+static uint32_t scratch;
+static uint32_t sp0;
+
+typedef struct {
+        uint8_t         ram[RAM_SIZE];
+        uint32_t        regs[18];
+} result_t;
+
+static result_t results[2];
+
+static const m68k_register_t result_regs[18] = {
+        M68K_REG_D0, M68K_REG_D1, M68K_REG_D2, M68K_REG_D3,
+        M68K_REG_D4, M68K_REG_D5, M68K_REG_D6, M68K_REG_D7,
+        M68K_REG_A0, M68K_REG_A1, M68K_REG_A2, M68K_REG_A3,
+        M68K_REG_A4, M68K_REG_A5, M68K_REG_A6, M68K_REG_A7,
+        M68K_REG_PC, M68K_REG_SR,
+};
+static const char *result_reg_names[18] = {
+        "D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7",
+        "A0", "A1", "A2", "A3", "A4", "A5", "A6", "A7", "PC", "SR",
+};
+
+/* Toolbox traps may change D0-D2, A0-A1 and the CCR (Pascal's convention) */
+#define TOOLBOX_REGS            0x0001fcf8u     /* D3-D7, A2-A7, PC */
+#define ALL_REGS                0x0003ffffu
+
+static unsigned int cases = 0;
+static unsigned int failures = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t rd32(uint32_t a)
+{
+        return (ram[a] << 24) | (ram[a + 1] << 16) | (ram[a + 2] << 8) | ram[a + 3];
+}
+
+static void     wr16(uint32_t a, uint16_t v)
+{
+        ram[a] = v >> 8;
+        ram[a + 1] = v;
+}
+
+static void     wr32(uint32_t a, uint32_t v)
+{
+        wr16(a, v >> 16);
+        wr16(a + 2, v);
+}
+
+static void     wr_rect(uint32_t a, int top, int left, int bottom, int right)
+{
+        wr16(a, top);
+        wr16(a + 2, left);
+        wr16(a + 4, bottom);
+        wr16(a + 6, right);
+}
+
+static int      rnd(int lo, int hi)
+{
+        if (hi <= lo)
+                return lo;
+        return lo + rand() % (hi - lo + 1);
+}
+
+static void     randomise(uint32_t a, unsigned int len)
+{
+        for (unsigned int i = 0; i < len; i++)
+                ram[a + i] = rand();
+}
+
+static void     push32(uint32_t v)
+{
+        uint32_t sp = m68k_get_reg(NULL, M68K_REG_A7) - 4;
+
+        wr32(sp, v);
+        m68k_set_reg(M68K_REG_A7, sp);
+}
+
+static void     push16(uint16_t v)
+{
+        uint32_t sp = m68k_get_reg(NULL, M68K_REG_A7) - 2;
+
+        wr16(sp, v);
+        m68k_set_reg(M68K_REG_A7, sp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A port, drawing into a bitmap, with rectangular regions
+
+typedef struct {
+        int top, left, bottom, right;
+} trect_t;
+
+static void     wr_bitmap(uint32_t a, uint32_t base, int row_bytes, trect_t b)
+{
+        wr32(a, base);
+        wr16(a + 4, row_bytes);
+        wr_rect(a + 6, b.top, b.left, b.bottom, b.right);
+}
+
+/* Usually the regions are the whole port (so nothing's clipped), but
+ * sometimes they clip.
+ */
+static trect_t  maybe_smaller(trect_t r)
+{
+        if (rnd(0, 3) == 0) {
+                r.top += rnd(0, 8);
+                r.left += rnd(0, 8);
+                r.bottom -= rnd(0, 8);
+                r.right -= rnd(0, 8);
+        }
+        return r;
+}
+
+static void     make_port(uint32_t base, int row_bytes, trect_t bounds)
+{
+        uint32_t port = scratch + S_PORT;
+        trect_t pr = maybe_smaller(bounds);
+        trect_t vis = maybe_smaller(pr);
+        trect_t clip = rnd(0, 3) ? (trect_t){ -32767, -32767, 32767, 32767 } : maybe_smaller(bounds);
+
+        memset(&ram[port], 0, 108);
+        wr_bitmap(port + 2, base, row_bytes, bounds);
+        wr_rect(port + 16, pr.top, pr.left, pr.bottom, pr.right);
+        wr32(port + 24, scratch + S_VIS_MP);
+        wr32(port + 28, scratch + S_CLIP_MP);
+        randomise(port + 32, 8);                /* bkPat */
+        randomise(port + 40, 8);                /* fillPat */
+        wr32(port + 52, 0x00010001);            /* pnSize */
+        wr16(port + 56, 8);                     /* pnMode patCopy */
+        memset(&ram[port + 58], 0xff, 8);       /* pnPat */
+        wr32(port + 80, 33);                    /* fgColor blackColor */
+        wr32(port + 84, 30);                    /* bkColor whiteColor */
+
+        wr32(scratch + S_VIS_MP, scratch + S_VIS_RGN);
+        wr16(scratch + S_VIS_RGN, 10);
+        wr_rect(scratch + S_VIS_RGN + 2, vis.top, vis.left, vis.bottom, vis.right);
+        wr32(scratch + S_CLIP_MP, scratch + S_CLIP_RGN);
+        wr16(scratch + S_CLIP_RGN, 10);
+        wr_rect(scratch + S_CLIP_RGN + 2, clip.top, clip.left, clip.bottom, clip.right);
+
+        /* thePort */
+        wr32(rd32(m68k_get_reg(NULL, M68K_REG_A5)), port);
+}
+
+static trect_t  random_bounds(int rows, int row_bytes)
+{
+        int top = rnd(-40, 40);
+        int left = rnd(-40, 40);
+
+        return (trect_t){ top, left, top + rows, left + row_bytes * 8 };
+}
+
+/* A rectangle in r, usually:  sometimes it pokes out, or is empty */
+static trect_t  random_rect(trect_t r)
+{
+        trect_t o;
+        int slop = rnd(0, 7) ? 0 : 6;
+
+        o.top = rnd(r.top - slop, r.bottom);
+        o.bottom = rnd(o.top, r.bottom + slop);
+        o.left = rnd(r.left - slop, r.right);
+        o.right = rnd(o.left, r.right + slop);
+        if (rnd(0, 15) == 0)
+                o.bottom = o.top - rnd(0, 2);
+        return o;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Cases:  each sets up its trap's arguments, from rand()
+
+static void     setup_blockmove(void)
+{
+        uint32_t buf = scratch + S_BUF;
+        uint32_t src = rnd(0, 7) ? buf + rnd(0, S_BUF_SIZE / 2) : MAC_ROM_BASE + rnd(0, 0x10000);
+        uint32_t dst = buf + rnd(0, S_BUF_SIZE / 2);
+        uint32_t count = rnd(0, 3) ? rnd(0, 64) : rnd(0, S_BUF_SIZE / 2);
+
+        randomise(buf, S_BUF_SIZE);
+        for (int r = M68K_REG_D1; r <= M68K_REG_D7; r++)
+                m68k_set_reg(r, rand());
+        m68k_set_reg(M68K_REG_A0, src);
+        m68k_set_reg(M68K_REG_A1, dst);
+        m68k_set_reg(M68K_REG_D0, count);
+}
+
+static void     setup_fillrect(void)
+{
+        trect_t bounds, r;
+
+        if (rnd(0, 3)) {
+                bounds = random_bounds(BITS_ROWS, BITS_ROW_BYTES);
+                randomise(scratch + S_BITS_1, BITS_ROWS * BITS_ROW_BYTES);
+                make_port(scratch + S_BITS_1, BITS_ROW_BYTES, bounds);
+        } else {
+                /* The screen, and maybe the cursor (as if it's visible) */
+                bounds = (trect_t){ 0, 0, DISP_HEIGHT, DISP_WIDTH };
+                make_port(rd32(MAC_SCRNBASE), DISP_WIDTH / 8, bounds);
+                ram[MAC_CRSRVIS] = rnd(0, 1);
+                int y = rnd(0, DISP_HEIGHT - 16);
+                int x = rnd(0, DISP_WIDTH - 16);
+                wr_rect(MAC_CRSRRECT, y, x, y + 16, x + 16);
+        }
+        r = random_rect(bounds);
+        wr_rect(scratch + S_RECT_A, r.top, r.left, r.bottom, r.right);
+        randomise(scratch + S_PAT, 8);
+
+        push32(scratch + S_RECT_A);
+        push32(scratch + S_PAT);
+}
+
+static void     setup_copybits(void)
+{
+        trect_t db = random_bounds(BITS_ROWS, BITS_ROW_BYTES);
+        bool same = rnd(0, 2) == 0;
+        int src_rb = same ? BITS_ROW_BYTES : rnd(1, 12) * 2;
+        trect_t sb = same ? db : random_bounds(BITS_ROWS, src_rb);
+        uint32_t dst_bitmap = rnd(0, 1) ? scratch + S_PORT + 2 : scratch + S_DST_BITMAP;
+        trect_t sr, dr;
+
+        randomise(scratch + S_BITS_1, S_BUF - S_BITS_1);
+        make_port(scratch + S_BITS_1, BITS_ROW_BYTES, db);
+        wr_bitmap(scratch + S_DST_BITMAP, scratch + S_BITS_1, BITS_ROW_BYTES, db);
+        wr_bitmap(scratch + S_SRC_BITMAP, scratch + (same ? S_BITS_1 : S_BITS_2), src_rb, sb);
+
+        sr = random_rect(sb);
+        dr.top = rnd(db.top, db.bottom - (sr.bottom - sr.top));
+        dr.left = rnd(db.left, db.right - (sr.right - sr.left));
+        dr.bottom = dr.top + (sr.bottom - sr.top);
+        dr.right = dr.left + (sr.right - sr.left);
+        if (rnd(0, 7) == 0)
+                dr.right += rnd(-3, 3);         /* Scaled */
+        wr_rect(scratch + S_RECT_A, sr.top, sr.left, sr.bottom, sr.right);
+        wr_rect(scratch + S_RECT_B, dr.top, dr.left, dr.bottom, dr.right);
+
+        push32(scratch + S_SRC_BITMAP);
+        push32(dst_bitmap);
+        push32(scratch + S_RECT_A);
+        push32(scratch + S_RECT_B);
+        push16(rnd(0, 7) ? 0 : rnd(1, 3));      /* srcCopy, or srcOr etc. */
+        push32(0);                              /* maskRgn */
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* Run the stub (the trap, then a branch to itself) until it's done */
+static bool     run(uint16_t op)
+{
+        uint32_t stub = scratch + S_STUB;
+
+        wr16(stub, op);
+        wr16(stub + 2, 0x60fe);         /* BRA.S * */
+        m68k_set_reg(M68K_REG_PC, stub);
+        for (unsigned int i = 0; i < RUN_LIMIT; i++) {
+                m68k_execute(1000);
+                if ((m68k_get_reg(NULL, M68K_REG_PC) & 0xffffff) == stub + 2)
+                        return true;
+        }
+        return false;
+}
+
+static void     run_case(const char *name, uint16_t op, void (*setup)(void), unsigned int n,
+                         uint32_t regs)
+{
+        for (int pass = 0; pass < 2; pass++) {
+                result_t *res = &results[pass];
+
+                memcpy(ram, base_ram, RAM_SIZE);
+                m68k_set_context(base_ctx);
+                m68k_set_reg(M68K_REG_SR, 0x2700);
+                m68k_set_reg(M68K_REG_A5, rd32(MAC_CURRENTA5));
+                srand(n * 3 + op);
+                setup();
+
+                traps_enabled = pass;
+                if (!run(op)) {
+                        printf("FAIL: %s %u:  %s didn't return\n", name, n, pass ? "native" : "ROM");
+                        failures++;
+                        return;
+                }
+                memcpy(res->ram, ram, RAM_SIZE);
+                for (int i = 0; i < 18; i++)
+                        res->regs[i] = m68k_get_reg(NULL, result_regs[i]);
+        }
+        cases++;
+
+        for (int i = 0; i < 18; i++) {
+                if ((regs & (1 << i)) && results[0].regs[i] != results[1].regs[i]) {
+                        printf("FAIL: %s %u:  %s is %08x, not %08x\n", name, n, result_reg_names[i],
+                               results[1].regs[i], results[0].regs[i]);
+                        failures++;
+                        return;
+                }
+        }
+
+        /* The stack the ROM used is dead */
+        unsigned int diffs = 0;
+        uint32_t first = 0;
+
+        for (uint32_t a = 0; a < RAM_SIZE; a++) {
+                if (a >= scratch + SCRATCH_SIZE && a < sp0)
+                        continue;
+                if (results[0].ram[a] != results[1].ram[a] && diffs++ == 0)
+                        first = a;
+        }
+        if (diffs) {
+                printf("FAIL: %s %u:  %u bytes differ, first at %06x (%02x, not %02x)\n",
+                       name, n, diffs, first, results[1].ram[first], results[0].ram[first]);
+                failures++;
+        }
+}
+
+static bool     boot(void)
+{
+        disc_descr_t discs[DISC_NUM_DRIVES] = {0};
+        unsigned int loops = BOOT_SECONDS * (MAC_CLOCK_HZ / QUANTUM);
+
+        traps_init(ram, RAM_SIZE, rom, ROM_SIZE);
+        traps_enabled = false;
+        umac_init(ram, rom, discs);
+        for (unsigned int i = 1; i <= loops; i++) {
+                umac_loop();
+                if (i % (MAC_CLOCK_HZ / QUANTUM / 60) == 0)
+                        umac_vsync_event();
+                if (i % (MAC_CLOCK_HZ / QUANTUM) == 0)
+                        umac_1hz_event();
+        }
+
+        sp0 = m68k_get_reg(NULL, M68K_REG_A7) & 0xffffff;
+        scratch = (sp0 - STACK_ROOM - SCRATCH_SIZE) & ~0xff;
+        uint32_t a5 = rd32(MAC_CURRENTA5) & 0xffffff;
+        if (a5 == 0 || a5 >= RAM_SIZE || (rd32(a5) & 0xffffff) >= RAM_SIZE) {
+                printf("traptest:  QuickDraw isn't set up after %us\n", BOOT_SECONDS);
+                return false;
+        }
+        if (scratch < (rd32(MAC_HEAPEND) & 0xffffff)) {
+                printf("traptest:  no room between the heap (%06x) and stack (%06x)\n",
+                       rd32(MAC_HEAPEND) & 0xffffff, sp0);
+                return false;
+        }
+
+        memcpy(base_ram, ram, RAM_SIZE);
+        base_ctx = malloc(m68k_context_size());
+        m68k_get_context(base_ctx);
+        return true;
+}
+
+int     main(int argc, char *argv[])
+{
+        unsigned int n = argc > 2 ? atoi(argv[2]) : 500;
+        FILE *f;
+
+        if (argc < 2) {
+                fprintf(stderr, "Usage: %s <rom.bin> [cases]\n", argv[0]);
+                return 1;
+        }
+        f = fopen(argv[1], "rb");
+        if (!f || fread(rom, 1, ROM_SIZE, f) != ROM_SIZE) {
+                printf("traptest:  SKIP (can't read a %uKB ROM from %s)\n", ROM_SIZE / 1024, argv[1]);
+                return 0;
+        }
+        fclose(f);
+
+        if (!boot())
+                return 1;
+        printf("traptest:  booted, stack at %06x, scratch at %06x\n", sp0, scratch);
+
+        for (unsigned int i = 0; i < n; i++) {
+                run_case("BlockMove", TRAP_BLOCKMOVE, setup_blockmove, i, ALL_REGS);
+                run_case("FillRect", TRAP_FILLRECT, setup_fillrect, i, TOOLBOX_REGS);
+                run_case("CopyBits", TRAP_COPYBITS, setup_copybits, i, TOOLBOX_REGS);
+        }
+
+        traps_dump();
+        if (failures) {
+                printf("traptest:  %u failures (of %u cases)\n", failures, cases);
+                return 1;
+        }
+        printf("traptest:  %u cases OK\n", cases);
+        return 0;
+}
@@ -0,0 +1,15 @@
+/* vidsim stand-in: see vidsim_sdk.h */
+#ifndef VIDSIM_HARDWARE_CLOCKS_H
+#define VIDSIM_HARDWARE_CLOCKS_H
+
+#include "vidsim_sdk.h"
+
+enum clock_index { clk_sys };
+
+static inline uint32_t clock_get_hz(enum clock_index clk)
+{
+        (void)clk;
+        return vidsim_sys_hz;
+}
+
+#endif
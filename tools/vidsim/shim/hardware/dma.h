@@ -0,0 +1,180 @@
+/* vidsim stand-in: see vidsim_sdk.h
+ *
+ * The channel registers and CTRL bits are laid out as on the RP2040, so
+ * that a channel can be programmed by another channel writing its
+ * registers.
+ */
+#ifndef VIDSIM_HARDWARE_DMA_H
+#define VIDSIM_HARDWARE_DMA_H
+
+#include "vidsim_sdk.h"
+#include "hardware/irq.h"
+
+#define NUM_DMA_CHANNELS        12
+
+typedef struct {
+        io_rw_32 read_addr;
+        io_rw_32 write_addr;
+        io_rw_32 transfer_count;
+        io_rw_32 ctrl_trig;
+        io_rw_32 al1_ctrl;
+        io_rw_32 al1_read_addr;
+        io_rw_32 al1_write_addr;
+        io_rw_32 al1_transfer_count_trig;
+        io_rw_32 al2_ctrl;
+        io_rw_32 al2_transfer_count;
+        io_rw_32 al2_read_addr;
+        io_rw_32 al2_write_addr_trig;
+        io_rw_32 al3_ctrl;
+        io_rw_32 al3_write_addr;
+        io_rw_32 al3_transfer_count;
+        io_rw_32 al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+        dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+        io_rw_32 ints0;
+        io_rw_32 inte0;
+} dma_hw_t;
+
+extern dma_hw_t vidsim_dma_hw;
+#define dma_hw  (&vidsim_dma_hw)
+
+#define DMA_CH0_CTRL_TRIG_EN_BITS               0x00000001
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB         2
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS        0x0000000c
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS        0x00000010
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS       0x00000020
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_LSB         6
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_BITS        0x000003c0
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS         0x00000400
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB          11
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS         0x00007800
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB          15
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS         0x001f8000
+#define DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS        0x00200000
+#define DMA_CH0_CTRL_TRIG_BSWAP_BITS            0x00400000
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+#define DREQ_PIO0_TX0   0
+#define DREQ_FORCE      0x3f
+
+typedef struct {
+        uint32_t ctrl;
+} dma_channel_config;
+
+static inline uint dma_claim_unused_channel(bool required)
+{
+        static uint next = 0;
+        (void)required;
+        return next++;
+}
+
+static inline void channel_config_set_bits(dma_channel_config *c, uint32_t bits, bool set)
+{
+        c->ctrl = set ? (c->ctrl | bits) : (c->ctrl & ~bits);
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+        channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_INCR_READ_BITS, incr);
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+        channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS, incr);
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+        c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) |
+                (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *c, uint chain_to)
+{
+        c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) |
+                (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size size)
+{
+        c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) |
+                ((uint)size << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits)
+{
+        c->ctrl = (c->ctrl & ~(DMA_CH0_CTRL_TRIG_RING_SIZE_BITS | DMA_CH0_CTRL_TRIG_RING_SEL_BITS)) |
+                (size_bits << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) |
+                (write ? DMA_CH0_CTRL_TRIG_RING_SEL_BITS : 0);
+}
+
+static inline void channel_config_set_bswap(dma_channel_config *c, bool bswap)
+{
+        channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_BSWAP_BITS, bswap);
+}
+
+static inline void channel_config_set_irq_quiet(dma_channel_config *c, bool quiet)
+{
+        channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS, quiet);
+}
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel)
+{
+        dma_channel_config c = { .ctrl = DMA_CH0_CTRL_TRIG_EN_BITS };
+
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, DREQ_FORCE);
+        channel_config_set_chain_to(&c, channel);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        return c;
+}
+
+static inline void dma_channel_start(uint channel)
+{
+        vidsim_dma_trigger(channel);
+}
+
+static inline void dma_channel_configure(uint channel, const dma_channel_config *config,
+                                         volatile void *write_addr, const volatile void *read_addr,
+                                         uint transfer_count, bool trigger)
+{
+        dma_hw->ch[channel].write_addr = (uintptr_t)write_addr;
+        dma_hw->ch[channel].read_addr = (uintptr_t)read_addr;
+        dma_hw->ch[channel].transfer_count = transfer_count;
+        dma_hw->ch[channel].ctrl_trig = config->ctrl;
+        if (trigger)
+                dma_channel_start(channel);
+}
+
+static inline void dma_channel_set_read_addr(uint channel, const volatile void *read_addr,
+                                             bool trigger)
+{
+        dma_hw->ch[channel].read_addr = (uintptr_t)read_addr;
+        if (trigger)
+                dma_channel_start(channel);
+}
+
+static inline void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+        if (enabled)
+                dma_hw->inte0 |= 1u << channel;
+        else
+                dma_hw->inte0 &= ~(1u << channel);
+}
+
+static inline bool dma_channel_get_irq0_status(uint channel)
+{
+        return dma_hw->ints0 & (1u << channel);
+}
+
+static inline void dma_channel_acknowledge_irq0(uint channel)
+{
+        dma_hw->ints0 &= ~(1u << channel);
+}
+
+#endif
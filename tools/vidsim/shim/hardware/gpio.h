@@ -0,0 +1,16 @@
+/* vidsim stand-in: see vidsim_sdk.h */
+#ifndef VIDSIM_HARDWARE_GPIO_H
+#define VIDSIM_HARDWARE_GPIO_H
+
+#include "vidsim_sdk.h"
+
+enum gpio_override { GPIO_OVERRIDE_NORMAL, GPIO_OVERRIDE_INVERT };
+
+/* Pin polarity isn't modelled; the simulator looks at PIO's output */
+static inline void gpio_set_outover(uint gpio, uint value)
+{
+        (void)gpio;
+        (void)value;
+}
+
+#endif
@@ -0,0 +1,24 @@
+/* vidsim stand-in: see vidsim_sdk.h */
+#ifndef VIDSIM_HARDWARE_IRQ_H
+#define VIDSIM_HARDWARE_IRQ_H
+
+#include "vidsim_sdk.h"
+
+#define DMA_IRQ_0       11
+
+typedef void (*irq_handler_t)(void);
+
+static inline void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+        (void)num;
+        vidsim_irq_set_handler(handler);
+}
+
+/* The DMA IRQ is always enabled; inte0 masks it per channel */
+static inline void irq_set_enabled(uint num, bool enabled)
+{
+        (void)num;
+        (void)enabled;
+}
+
+#endif
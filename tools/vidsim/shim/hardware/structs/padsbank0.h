@@ -0,0 +1,19 @@
+/* vidsim stand-in: see vidsim_sdk.h */
+#ifndef VIDSIM_HARDWARE_STRUCTS_PADSBANK0_H
+#define VIDSIM_HARDWARE_STRUCTS_PADSBANK0_H
+
+#include "vidsim_sdk.h"
+
+#define PADS_BANK0_GPIO0_DRIVE_LSB              4
+#define PADS_BANK0_GPIO0_DRIVE_BITS             0x00000030
+#define PADS_BANK0_GPIO0_DRIVE_VALUE_12MA       0x3
+
+typedef struct {
+        io_rw_32 voltage_select;
+        io_rw_32 io[30];
+} padsbank0_hw_t;
+
+extern padsbank0_hw_t vidsim_padsbank0;
+#define padsbank0_hw    (&vidsim_padsbank0)
+
+#endif
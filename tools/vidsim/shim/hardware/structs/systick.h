@@ -0,0 +1,21 @@
+/* vidsim stand-in: see vidsim_sdk.h */
+#ifndef VIDSIM_HARDWARE_STRUCTS_SYSTICK_H
+#define VIDSIM_HARDWARE_STRUCTS_SYSTICK_H
+
+#include "vidsim_sdk.h"
+
+#define M0PLUS_SYST_CSR_ENABLE_BITS     0x00000001
+#define M0PLUS_SYST_CSR_CLKSOURCE_BITS  0x00000004
+
+/* The simulator counts cvr down at clk_sys */
+typedef struct {
+        io_rw_32 csr;
+        io_rw_32 rvr;
+        io_rw_32 cvr;
+        io_rw_32 calib;
+} systick_hw_t;
+
+extern systick_hw_t vidsim_systick;
+#define systick_hw      (&vidsim_systick)
+
+#endif
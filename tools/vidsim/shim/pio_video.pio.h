@@ -0,0 +1,52 @@
+/* vidsim stand-in for the header pioasm generates from pio_video.pio
+ *
+ * The simulator has a cycle model of the two programs (see vidsim_hw.c),
+ * so loading a program just tells it which one, how it's patched, and how
+ * fast.
+ */
+#ifndef VIDSIM_PIO_VIDEO_PIO_H
+#define VIDSIM_PIO_VIDEO_PIO_H
+
+#include "vidsim_sdk.h"
+
+typedef struct {
+        io_wo_32 txf[4];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t vidsim_pio0;
+#define pio0_hw (&vidsim_pio0)
+#define pio0    pio0_hw
+
+static inline uint pio_video_add_program(PIO pio, uint bpp, uint scale)
+{
+        (void)pio;
+        (void)bpp;
+        vidsim_pio_patch(scale);
+        return 0;
+}
+
+static inline void pio_video_program_init(PIO pio, uint sm, uint offset, uint video_pin,
+                                          uint bpp, float clk_div)
+{
+        (void)pio; (void)sm; (void)offset; (void)video_pin;
+        vidsim_pio_load(false, bpp, clk_div);
+}
+
+static inline uint pio_lcd_add_program(PIO pio, uint bpp)
+{
+        (void)pio;
+        (void)bpp;
+        vidsim_pio_patch(1);
+        return 0;
+}
+
+static inline void pio_lcd_program_init(PIO pio, uint sm, uint offset, uint video_pin,
+                                        uint bpp, float clk_div)
+{
+        (void)pio; (void)sm; (void)offset; (void)video_pin;
+        vidsim_pio_load(true, bpp, clk_div);
+}
+
+#endif
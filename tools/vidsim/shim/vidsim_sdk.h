@@ -0,0 +1,59 @@
+/*
+ * vidsim: minimal stand-ins for the Pico SDK, for building video.c on a host
+ *
+ * Only what video.c uses is provided.  Registers are uintptr_t rather than
+ * 32 bits, so that DMA descriptors (which hold pointers) have the same
+ * layout as the registers they're copied to, just as on the RP2040.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VIDSIM_SDK_H
+#define VIDSIM_SDK_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned int uint;
+typedef uintptr_t io_rw_32;
+typedef uint32_t io_wo_32;
+
+#define __not_in_flash_func(f)  f
+
+#define panic(...)      do { printf(__VA_ARGS__); exit(2); } while (0)
+
+static inline void hw_write_masked(io_rw_32 *addr, uint32_t values, uint32_t mask)
+{
+        *addr = (*addr & ~mask) | (values & mask);
+}
+
+/* Provided by the simulator: */
+extern uint64_t vidsim_sys_hz;
+void    vidsim_dma_trigger(uint ch);
+void    vidsim_irq_set_handler(void (*handler)(void));
+void    vidsim_pio_patch(uint scale);
+void    vidsim_pio_load(bool lcd, uint bpp, float clk_div);
+
+#endif
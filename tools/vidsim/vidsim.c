@@ -0,0 +1,645 @@
+/*
+ * vidsim: host-side scan-out simulator for video.c
+ *
+ * Builds video.c against stand-in SDK headers (shim/) and models of the
+ * DMA/PIO hardware (vidsim_hw.c), then runs some frames and checks what comes
+ * out of the PIO program:  line/frame timing, that every line's pixels are
+ * the right framebuffer line (or blank), DE (for LCDs), that framebuffer
+ * switches only happen between frames, and how much slack the video IRQ had
+ * before its deadline.  video_scan.h's line-to-address mapping, and scan list
+ * updates, are also checked directly (for 1x and 2x scaling), as is that a
+ * framebuffer or HUD strip switched at any line is only latched at the end
+ * of the frame.  So are the values video_timing.c derives for each mode in
+ * its tables, and that it rejects some bad ones.  Each frame's sequence of
+ * DMA transfers to PIO must match the scan list video_scan_build_list()
+ * makes for it, whether it came from a list or the per-line IRQ.  The last
+ * frame's active area is written as a PBM (or PGM for >1BPP).
+ *
+ * See the Makefile for build options; these match the firmware's.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "video.h"
+#include "video_scan.h"
+#include "video_timing.h"
+#include "vidsim_hw.h"
+#include "vidsim_sdk.h"
+
+#if USE_LCD
+#define VIDSIM_LCD      true
+#else
+#define VIDSIM_LCD      false
+#endif
+
+#define FB_WPL          VIDEO_SCAN_WPL(DISP_WIDTH, VIDEO_BPP)
+
+static uint32_t fbs[2][FB_WPL * DISP_HEIGHT];
+
+static const video_timing_t *timing;
+static uint32_t cfg[6];
+static unsigned int fb_top;             /* First FB line, from VS */
+static bool opt_flip = false;
+static bool opt_verbose = false;
+
+/* Frame tracking */
+static unsigned int frames = 0;         /* Frames completed */
+static unsigned int y = 0;              /* Line within the current frame */
+static bool in_frame = false;
+static bool prev_vs = false;
+static int fb_cur = 0;                  /* Which FB this frame should show */
+static int fb_next = 0;                 /* ...and the next one */
+
+/* Results */
+static unsigned int err_lines = 0;      /* Lines with the wrong length */
+static unsigned int err_frames = 0;     /* Frames with the wrong line count */
+static unsigned int err_pixels = 0;     /* Lines with wrong pixel data */
+static unsigned int err_de = 0;
+static unsigned int err_x0 = 0;
+static unsigned int stalled_lines = 0;
+static unsigned int x0_first = ~0u;
+static unsigned int line_pclks_min = ~0u, line_pclks_max = 0;
+
+static uint64_t irq_count = 0;
+static int64_t slack_min = INT64_MAX, slack_max = INT64_MIN, slack_sum = 0;
+static unsigned int irq_misses = 0;
+
+static uint8_t *image;                  /* Active area, hres x vres */
+static uint8_t *last_image;             /* ...of the last complete frame */
+
+/* The transfers to PIO, as {count, read address}, like a scan list */
+#define DMA_TRACE_MAX   (2 * 2048 * 8)
+static uintptr_t dma_trace[DMA_TRACE_MAX][2];
+static unsigned int dma_trace_len = 0;
+
+static void     fill_pattern(uint32_t *fb, int which)
+{
+        unsigned int max = (1 << VIDEO_BPP) - 1;
+
+        for (unsigned int py = 0; py < DISP_HEIGHT; py++) {
+                for (unsigned int px = 0; px < DISP_WIDTH; px++) {
+                        /* A border, a checkerboard, and a diagonal; the
+                         * second FB is inverted, so they differ on every
+                         * line:
+                         */
+                        unsigned int v;
+                        if (px == 0 || py == 0 || px == DISP_WIDTH - 1 || py == DISP_HEIGHT - 1 ||
+                            px == py)
+                                v = max;
+                        else if (VIDEO_BPP > 1)
+                                v = ((px / 16) + (py / 16)) & max;
+                        else
+                                v = ((px / 16) ^ (py / 16)) & 1;
+                        if (which)
+                                v = max - v;
+                        video_scan_put_pixel(&fb[py * FB_WPL], px, VIDEO_BPP, v);
+                }
+        }
+}
+
+static void     check_line(const vidsim_line_t *l)
+{
+        unsigned int act_y = y - (timing->vsw + timing->vbp);
+        bool active = act_y < timing->vres;
+        unsigned int scale = timing->scale;
+        unsigned int expect = video_timing_line_pclks(&cfg[active ? 4 : 2], scale, VIDSIM_LCD);
+        unsigned int max = (1 << VIDEO_BPP) - 1;
+
+        if (l->pclks < line_pclks_min)
+                line_pclks_min = l->pclks;
+        if (l->pclks > line_pclks_max)
+                line_pclks_max = l->pclks;
+        if (l->stalls)
+                stalled_lines++;
+        if (l->pclks != expect)
+                err_lines++;
+        if (l->vs != (y < timing->vsw))
+                err_lines++;
+        if (VIDSIM_LCD && l->de != active)
+                err_de++;
+        if (x0_first == ~0u)
+                x0_first = l->x0;
+        else if (l->x0 != x0_first)
+                err_x0++;
+
+        /* Pixel data: the FB line (repeated, if scaled), or black (all ones) */
+        bool bad = (l->npix != DISP_WIDTH);
+        for (unsigned int k = 0; !bad && k < l->npix; k++) {
+                unsigned int v = max;
+                if (y >= fb_top && y < fb_top + DISP_HEIGHT * scale)
+                        v = video_scan_get_pixel(&fbs[fb_cur][(y - fb_top) / scale * FB_WPL],
+                                                 k, VIDEO_BPP);
+                if (l->pix[k] != v)
+                        bad = true;
+        }
+        if (bad)
+                err_pixels++;
+
+        if (active) {
+                /* Place pixels where they appear, relative to the nominal
+                 * start of the active area:
+                 */
+                int x = (int)l->x0 - (int)(timing->hsw + timing->hbp);
+                for (unsigned int k = 0; k < l->npix * scale; k++, x++) {
+                        if (x >= 0 && x < (int)timing->hres)
+                                image[act_y * timing->hres + x] = l->pix[k / scale];
+                }
+        }
+}
+
+void    vidsim_out_line(const vidsim_line_t *l)
+{
+        if (l->vs && !prev_vs) {
+                /* A new frame */
+                if (in_frame) {
+                        if (y != video_timing_v_total(timing))
+                                err_frames++;
+                        frames++;
+                        memcpy(last_image, image, timing->hres * timing->vres);
+                }
+                in_frame = true;
+                y = 0;
+                fb_cur = fb_next;
+                memset(image, (1 << VIDEO_BPP) - 1, timing->hres * timing->vres);
+        }
+        prev_vs = l->vs;
+        if (!in_frame)
+                return;
+
+        check_line(l);
+        y++;
+
+        /* Flip mid-frame; this mustn't be seen until the next frame */
+        if (opt_flip && y == video_timing_v_total(timing) / 2) {
+                fb_next = !fb_cur;
+                video_set_framebuffer(fbs[fb_next]);
+        }
+}
+
+void    vidsim_out_dma(uintptr_t count, uintptr_t read_addr)
+{
+        if (dma_trace_len < DMA_TRACE_MAX) {
+                dma_trace[dma_trace_len][0] = count;
+                dma_trace[dma_trace_len][1] = read_addr;
+                dma_trace_len++;
+        }
+}
+
+void    vidsim_irq_done(uint64_t raised, int64_t slack)
+{
+        irq_count++;
+        if (slack < slack_min)
+                slack_min = slack;
+        if (slack > slack_max)
+                slack_max = slack;
+        slack_sum += slack;
+        if (slack < 0)
+                irq_misses++;
+        if (opt_verbose)
+                printf("irq @%" PRIu64 ": frame %u line %u, slack %" PRId64 " cycles\n",
+                       raised, frames, y, slack);
+}
+
+static int      write_image(const char *path)
+{
+        FILE *f = fopen(path, "wb");
+        unsigned int max = (1 << VIDEO_BPP) - 1;
+
+        if (!f) {
+                perror(path);
+                return -1;
+        }
+        if (VIDEO_BPP == 1) {
+                /* PBM:  1 is black, as for the Mac */
+                fprintf(f, "P4\n%u %u\n", timing->hres, timing->vres);
+                for (unsigned int py = 0; py < timing->vres; py++) {
+                        for (unsigned int px = 0; px < timing->hres; px += 8) {
+                                uint8_t b = 0;
+                                for (unsigned int i = 0; i < 8; i++)
+                                        b |= last_image[py * timing->hres + px + i] << (7 - i);
+                                fputc(b, f);
+                        }
+                }
+        } else {
+                fprintf(f, "P5\n%u %u\n%u\n", timing->hres, timing->vres, max);
+                for (unsigned int i = 0; i < timing->hres * timing->vres; i++)
+                        fputc(max - last_image[i], f);
+        }
+        fclose(f);
+        return 0;
+}
+
+/* Check video_scan's line mapping against the expected, for a frame of the
+ * current timing at 1x/2x scale (where that fits), with a HUD strip below
+ * the FB.  A scan list is built for one FB, then switched to the other, and
+ * must match one built for that from scratch.  Returns the number of lines
+ * wrong.
+ */
+static unsigned int     check_scan_map(void)
+{
+        static uint32_t null_line[FB_WPL], hud[8 * FB_WPL];
+        static uintptr_t list[2][VIDEO_SCANLIST_WORDS(2048)];
+        unsigned int bad = 0;
+
+        for (unsigned int shift = 0; shift < 2; shift++) {
+                unsigned int fb_lines = DISP_HEIGHT << shift;
+                video_scan_t vs = {
+                        .v_total = video_timing_v_total(timing),
+                        .vsw = timing->vsw,
+                        .fb_v_start = timing->vsw + timing->vbp +
+                                (timing->vres - fb_lines) / 2,
+                        .fb_vres = DISP_HEIGHT,
+                        .v_shift = shift,
+                        .wpl = FB_WPL,
+                        .fb = fbs[0],
+                        .null_line = null_line,
+                        .cfg = cfg,
+                        .act_start = timing->vsw + timing->vbp,
+                        .act_lines = timing->vres,
+                        .hud_lines = 8,
+                        .hud = hud,
+                };
+
+                if (fb_lines > timing->vres || vs.v_total > 2048)
+                        continue;
+                vs.hud_start = vs.fb_v_start + fb_lines;
+
+                for (unsigned int ly = 0; ly < vs.v_total; ly++) {
+                        const uint32_t *expect = null_line;
+
+                        if (ly >= vs.fb_v_start && ly < vs.fb_v_start + fb_lines)
+                                expect = &fbs[0][((ly - vs.fb_v_start) >> shift) * FB_WPL];
+                        else if (ly >= vs.hud_start && ly < vs.hud_start + 8)
+                                expect = &hud[(ly - vs.hud_start) * FB_WPL];
+                        if (video_scan_line_addr(&vs, ly) != expect)
+                                bad++;
+                }
+
+                video_scan_build_list(&vs, list[0]);
+                video_scan_set_fb(&vs, fbs[1]);
+                video_scan_set_hud(&vs, hud);
+                video_scan_latch_list(&vs, list[0]);
+                video_scan_build_list(&vs, list[1]);
+                for (unsigned int ly = 0; ly < vs.v_total; ly++) {
+                        if (memcmp(&list[0][ly * 4], &list[1][ly * 4], 4 * sizeof(uintptr_t)))
+                                bad++;
+                }
+        }
+        return bad;
+}
+
+/* Which buffer a line's address is in:  0/1 for fbs[], 2/3 for huds[], or
+ * -1 for the blank line.
+ */
+static int      latch_which(const uint32_t *addr, uint32_t huds[2][8 * FB_WPL])
+{
+        for (int i = 0; i < 2; i++) {
+                if (addr >= fbs[i] && addr < fbs[i] + FB_WPL * DISP_HEIGHT)
+                        return i;
+                if (addr >= huds[i] && addr < huds[i] + 8 * FB_WPL)
+                        return 2 + i;
+        }
+        return -1;
+}
+
+/* Step video_scan's line counter through 3 frames, for the per-line IRQ
+ * (video_scan_next_line()) and for a scan list (latched at each frame's
+ * end, as the IRQ does), switching FB and HUD strip at every line of the
+ * first frame in turn.  The first frame must show only the old buffers,
+ * and the rest only the new.  Returns the number of switch points at which
+ * that wasn't so.
+ */
+static unsigned int     check_latch(void)
+{
+        static uint32_t null_line[FB_WPL], huds[2][8 * FB_WPL];
+        static uintptr_t list[VIDEO_SCANLIST_WORDS(2048)];
+        unsigned int bad = 0;
+        video_scan_t vs = {
+                .v_total = video_timing_v_total(timing),
+                .vsw = timing->vsw,
+                .fb_v_start = timing->vsw + timing->vbp + (timing->vres - DISP_HEIGHT) / 2,
+                .fb_vres = DISP_HEIGHT,
+                .wpl = FB_WPL,
+                .null_line = null_line,
+                .cfg = cfg,
+                .act_start = timing->vsw + timing->vbp,
+                .act_lines = timing->vres,
+                .hud_lines = 8,
+        };
+
+        vs.hud_start = vs.fb_v_start + DISP_HEIGHT;
+        if (vs.v_total > 2048 || vs.hud_start + 8 > vs.v_total)
+                return 1;
+        for (unsigned int use_list = 0; use_list < 2; use_list++) {
+                for (unsigned int k = 0; k < vs.v_total; k++) {
+                        bool wrong = false;
+
+                        vs.fb = vs.fb_next = fbs[0];
+                        vs.hud = vs.hud_next = huds[0];
+                        vs.y = 0;
+                        if (use_list)
+                                video_scan_build_list(&vs, list);
+
+                        for (unsigned int f = 0; f < 3; f++) {
+                                for (unsigned int ly = 0; ly < vs.v_total; ly++) {
+                                        if (f == 0 && ly == k) {
+                                                video_scan_set_fb(&vs, fbs[1]);
+                                                video_scan_set_hud(&vs, huds[1]);
+                                        }
+
+                                        const uint32_t *addr;
+                                        if (use_list) {
+                                                addr = (const uint32_t *)list[ly * 4 + 3];
+                                        } else {
+                                                addr = video_scan_line_addr(&vs, vs.y);
+                                                if (vs.y != ly)
+                                                        wrong = true;
+                                                if (video_scan_next_line(&vs) !=
+                                                    (ly == vs.v_total - 1))
+                                                        wrong = true;
+                                        }
+
+                                        int w = latch_which(addr, huds);
+                                        int expect = -1;
+                                        if (ly >= vs.fb_v_start && ly < vs.fb_v_start + DISP_HEIGHT)
+                                                expect = (f > 0);
+                                        else if (ly >= vs.hud_start && ly < vs.hud_start + 8)
+                                                expect = 2 + (f > 0);
+                                        if (w != expect)
+                                                wrong = true;
+                                }
+                                if (use_list)
+                                        video_scan_latch_list(&vs, list);
+                        }
+                        if (wrong) {
+                                if (opt_verbose)
+                                        printf("latch: %s, switch at line %u seen mid-frame\n",
+                                               use_list ? "scan list" : "per-line", k);
+                                bad++;
+                        }
+                }
+        }
+        return bad;
+}
+
+/* Check each whole frame of the DMA trace against a scan list built for
+ * video.c's geometry, showing the FB that frame started with.  video.c's
+ * config words and blank line are taken from the frame's first line (a VS
+ * line, so blank).  Returns the number of frames wrong.
+ */
+static unsigned int     check_dma_trace(void)
+{
+        static uintptr_t list[VIDEO_SCANLIST_WORDS(2048)];
+        unsigned int v_total = video_timing_v_total(timing);
+        video_scan_t vs = {
+                .v_total = v_total,
+                .vsw = timing->vsw,
+                .fb_v_start = fb_top,
+                .fb_vres = DISP_HEIGHT,
+                .v_shift = (timing->scale == 2) ? 1 : 0,
+                .wpl = FB_WPL,
+                .cfg = (const uint32_t *)dma_trace[0][1],
+                .null_line = (const uint32_t *)dma_trace[1][1],
+                .act_start = timing->vsw + timing->vbp,
+                .act_lines = timing->vres,
+        };
+        unsigned int bad = 0;
+
+        if (dma_trace_len < v_total * 2)
+                return 1;
+        for (unsigned int f = 0; (f + 1) * v_total * 2 <= dma_trace_len; f++) {
+                uintptr_t (*t)[2] = &dma_trace[f * v_total * 2];
+
+                vs.fb = (t[fb_top * 2 + 1][1] == (uintptr_t)fbs[1]) ? fbs[1] : fbs[0];
+                video_scan_build_list(&vs, list);
+                if (memcmp(list, t, v_total * 4 * sizeof(uintptr_t)) ||
+                    list[v_total * 4] || list[v_total * 4 + 1]) {
+                        if (opt_verbose)
+                                printf("DMA trace: frame %u differs from its scan list\n", f);
+                        bad++;
+                }
+        }
+        return bad;
+}
+
+/* Modes that must be rejected for any FB/clock that vidsim uses */
+static const video_timing_t bad_modes[] = {
+        {       /* Too fast */
+                .name = "fast pclk", .pclk_khz = 200000,
+                .hsw = 72, .hbp = 128, .hres = 2048, .hfp = 24,
+                .vsw = 2, .vbp = 22, .vres = 1200, .vfp = 1, .scale = 1,
+        },
+        {       /* Needs a fractional divider (for VGA) */
+                .name = "frac pclk", .pclk_khz = 36000,
+                .hsw = 72, .hbp = 128, .hres = 2048, .hfp = 24,
+                .vsw = 2, .vbp = 22, .vres = 1200, .vfp = 1, .scale = 1,
+        },
+        {
+                .name = "bad hres", .pclk_khz = 25000,
+                .hsw = 96, .hbp = 48, .hres = 2040, .hfp = 16,
+                .vsw = 2, .vbp = 33, .vres = 1200, .vfp = 10, .scale = 1,
+        },
+        {
+                .name = "bad hsw", .pclk_khz = 25000,
+                .hsw = 300, .hbp = 48, .hres = 2048, .hfp = 16,
+                .vsw = 2, .vbp = 33, .vres = 1200, .vfp = 10, .scale = 1,
+        },
+        {
+                .name = "too small", .pclk_khz = 25000,
+                .hsw = 96, .hbp = 48, .hres = 256, .hfp = 16,
+                .vsw = 2, .vbp = 33, .vres = 192, .vfp = 10, .scale = 1,
+        },
+        {
+                .name = "bad scale", .pclk_khz = 25000,
+                .hsw = 96, .hbp = 48, .hres = 2048, .hfp = 16,
+                .vsw = 2, .vbp = 33, .vres = 1200, .vfp = 10, .scale = 3,
+        },
+        { .name = NULL }
+};
+
+/* Check the values derived for each mode in the table (and that the bad
+ * modes are rejected).  For usable modes, the active lines' config must
+ * give the mode's line length (plus pio_video's 2), the FB must be inside
+ * the active area, and VGA dividers must be whole pixel clocks.  Returns
+ * the number of modes wrong.
+ */
+static unsigned int     check_modes(const video_timing_t *table, bool verbose)
+{
+        unsigned int bad = 0;
+        uint32_t sys_khz = vidsim_sys_hz / 1000;
+
+        for (const video_timing_t *t = table; t->name; t++) {
+                const char *err = video_timing_check(t, DISP_WIDTH, DISP_HEIGHT, VIDEO_BPP,
+                                                     sys_khz, VIDSIM_LCD);
+                if (verbose)
+                        printf("  mode %-12s %s\n", t->name, err ? err : "OK");
+                if (table == bad_modes) {
+                        bad += !err;
+                        continue;
+                }
+                if (err)
+                        continue;
+
+                uint32_t c[6];
+                uint32_t div = video_timing_clkdiv(t, sys_khz, VIDSIM_LCD);
+                unsigned int x = video_timing_fb_x(t, DISP_WIDTH, VIDSIM_LCD);
+                unsigned int fy = video_timing_fb_y(t, DISP_HEIGHT);
+
+                video_timing_cfg(t, DISP_WIDTH, VIDSIM_LCD, c);
+                if ((video_timing_line_pclks(&c[4], t->scale, VIDSIM_LCD) !=
+                     video_timing_h_total(t) + (VIDSIM_LCD ? 0 : 2)) ||
+                    (!VIDSIM_LCD && (div & 127)) ||
+                    x < t->hsw + t->hbp ||
+                    x + DISP_WIDTH * t->scale > t->hsw + t->hbp + t->hres ||
+                    fy < t->vsw + t->vbp ||
+                    fy + DISP_HEIGHT * t->scale > t->vsw + t->vbp + t->vres) {
+                        printf("  mode %s: derived values wrong\n", t->name);
+                        bad++;
+                }
+        }
+        return bad;
+}
+
+static void     usage(const char *prog)
+{
+        fprintf(stderr, "Syntax: %s [-m mode] [-f frames] [-l irq_latency_cycles] [-c sys_mhz] "
+                "[-o image.pbm] [-p] [-v]\n"
+                "\t-m\tMode name, as passed to video_init()\n"
+                "\t-p\tSwitch framebuffers mid-frame, each frame\n"
+                "\t-v\tReport each IRQ's slack, and each mode's check\n", prog);
+}
+
+int     main(int argc, char *argv[])
+{
+        unsigned int nframes = 4;
+        const char *out = NULL;
+        const char *mode = NULL;
+        int ch;
+
+        while ((ch = getopt(argc, argv, "m:f:l:c:o:pvh")) != -1) {
+                switch (ch) {
+                case 'm':
+                        mode = optarg;
+                        break;
+                case 'f':
+                        nframes = atoi(optarg);
+                        break;
+                case 'l':
+                        vidsim_irq_latency = atoi(optarg);
+                        break;
+                case 'c':
+                        vidsim_sys_hz = atoi(optarg) * 1000000ULL;
+                        break;
+                case 'o':
+                        out = optarg;
+                        break;
+                case 'p':
+                        opt_flip = true;
+                        break;
+                case 'v':
+                        opt_verbose = true;
+                        break;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+        }
+
+        unsigned int err_modes = check_modes(VIDSIM_LCD ? video_lcd_panels : video_vga_modes,
+                                             opt_verbose);
+        err_modes += check_modes(bad_modes, opt_verbose);
+
+        fill_pattern(fbs[0], 0);
+        fill_pattern(fbs[1], 1);
+        video_init(fbs[0], mode);
+
+        /* The mode video.c chose (it falls back to the default if the
+         * requested one is bad):
+         */
+        timing = video_timing_find(VIDSIM_LCD ? video_lcd_panels : video_vga_modes,
+                                   video_get_mode());
+        if (mode && strcmp(mode, timing->name))
+                printf("Mode %s rejected, using %s\n", mode, timing->name);
+        video_timing_cfg(timing, DISP_WIDTH, VIDSIM_LCD, cfg);
+        fb_top = video_timing_fb_y(timing, DISP_HEIGHT);
+        image = malloc(timing->hres * timing->vres);
+        last_image = calloc(timing->hres, timing->vres);
+        unsigned int err_map = check_scan_map();
+        unsigned int err_latch = check_latch();
+
+        /* video.c claims its channels in order; with the per-line IRQ,
+         * the IRQ must reprogram the descriptors before the descr_cfg
+         * channel (the second) is next triggered:
+         */
+#if USE_VIDEO_SCANLIST
+        vidsim_deadline_ch = -1;
+#else
+        vidsim_deadline_ch = 1;
+#endif
+
+
+        uint64_t limit = (uint64_t)video_timing_h_total(timing) * video_timing_v_total(timing) *
+                (vidsim_sys_hz / (timing->pclk_khz * 1000) + 1) * (nframes + 2);
+        while (frames < nframes && !vidsim_fatal && vidsim_now < limit)
+                vidsim_step();
+
+        unsigned int err_dma = check_dma_trace();
+        unsigned int nominal = video_timing_h_total(timing);
+        printf("%s%s, %ux%u FB at %uBPP x%u, %s, IRQ latency %u cycles\n",
+               VIDSIM_LCD ? "LCD " : "VGA ", timing->name, DISP_WIDTH, DISP_HEIGHT, VIDEO_BPP,
+               timing->scale, USE_VIDEO_SCANLIST ? "scan list" : "per-line IRQ",
+               vidsim_irq_latency);
+        printf("  modes:        %u wrong\n", err_modes);
+        printf("  line map:     %u lines wrong\n", err_map);
+        printf("  latching:     %u switch points wrong\n", err_latch);
+        printf("  DMA sequence: %u frames differ from the scan list\n", err_dma);
+        printf("  frames:       %u (%u with wrong line count)\n", frames, err_frames);
+        printf("  line length:  %u-%u pclks (nominal %u), %u lines wrong, %u stalled\n",
+               line_pclks_min, line_pclks_max, nominal, err_lines, stalled_lines);
+        printf("  pixel 0 at:   %u pclks from HS (nominal %u), %u lines differ\n",
+               x0_first, video_timing_fb_x(timing, DISP_WIDTH, VIDSIM_LCD), err_x0);
+        printf("  pixel data:   %u lines wrong%s\n", err_pixels, opt_flip ? " (flipping FBs)" : "");
+        if (VIDSIM_LCD)
+                printf("  DE:           %u lines wrong\n", err_de);
+        if (irq_count)
+                printf("  IRQs:         %" PRIu64 ", slack %" PRId64 "/%" PRId64 "/%" PRId64
+                       " cycles min/mean/max (%.2fus min), %u missed\n",
+                       irq_count, slack_min, slack_sum / (int64_t)irq_count, slack_max,
+                       slack_min * 1e6 / vidsim_sys_hz, irq_misses);
+        if (vidsim_fatal)
+                printf("  FAILED:       %s\n", vidsim_fatal);
+
+        if (out && write_image(out))
+                return 1;
+
+        bool ok = !vidsim_fatal && frames == nframes && !err_modes && !err_map &&
+                !err_latch && !err_dma && !err_frames && !err_lines && !stalled_lines &&
+                !err_pixels && !err_de && !err_x0 && !irq_misses;
+        printf("%s\n", ok ? "PASS" : "FAIL");
+        return ok ? 0 : 1;
+}
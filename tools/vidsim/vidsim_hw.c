@@ -0,0 +1,421 @@
+/*
+ * vidsim: DMA, PIO and IRQ models
+ *
+ * The DMA model moves one word per clk_sys cycle (round-robin between
+ * channels), honouring TREQ, ring wrapping, bswap, chaining, trigger aliases,
+ * null triggers and IRQ_QUIET.  Channels whose write address is the DMA
+ * register block move register-width (uintptr_t) words, so descriptors and
+ * scan lists work on a 64-bit host.
+ *
+ * The PIO model follows pio_video/pio_lcd cycle by cycle, including autopull
+ * from an 8-entry (joined) TX FIFO, and stalls when the FIFO is empty.  If
+ * either program changes, this must be kept in step!
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "hardware/dma.h"
+#include "hardware/structs/padsbank0.h"
+#include "hardware/structs/systick.h"
+#include "pio_video.pio.h"
+
+#include "vidsim_hw.h"
+
+uint64_t vidsim_sys_hz = 250000000;
+uint64_t vidsim_now = 0;
+unsigned int vidsim_irq_latency = 100;
+int vidsim_deadline_ch = -1;
+const char *vidsim_fatal = NULL;
+
+dma_hw_t vidsim_dma_hw __attribute__((aligned(256)));
+pio_hw_t vidsim_pio0;
+padsbank0_hw_t vidsim_padsbank0;
+systick_hw_t vidsim_systick;
+
+////////////////////////////////////////////////////////////////////////////////
+// PIO
+
+#define FIFO_DEPTH      8
+
+typedef struct {
+        bool            lcd;
+        unsigned int    bpp;
+        unsigned int    scale;          /* pclks per pixel */
+        uint32_t        clkdiv_256;     /* 16.8 fixed point, as the hardware */
+        uint32_t        acc;
+
+        uint32_t        fifo[FIFO_DEPTH];
+        unsigned int    fifo_head;
+        unsigned int    fifo_count;
+
+        /* Line state; lc counts the program's cycles, not including stalls */
+        unsigned int    lc;
+        unsigned int    pull_lc;
+        unsigned int    pix0_lc;
+        unsigned int    len_lc;         /* 0 until the pixel count is read */
+        unsigned int    hfp;
+        uint32_t        osr;
+        unsigned int    osr_bits;
+        uint64_t        cycle;          /* Including stalls */
+        uint64_t        line_cycle;     /* When the previous line ended */
+        unsigned int    stalls0;        /* Stalls waiting for a line to start */
+        bool            started;        /* The first line has started */
+        uint64_t        hs_cycle;
+        bool            dry;            /* No output: see dry_run() */
+        vidsim_line_t   line;
+} pio_model_t;
+
+static pio_model_t pio;
+
+void    vidsim_pio_patch(uint scale)
+{
+        pio.scale = scale;
+}
+
+void    vidsim_pio_load(bool lcd, uint bpp, float clk_div)
+{
+        pio.lcd = lcd;
+        pio.bpp = bpp;
+        pio.clkdiv_256 = (uint32_t)(clk_div * 256.0f + 0.5f);
+        if (pio.clkdiv_256 < 256)
+                panic("vidsim: PIO clock divider %f < 1\n", clk_div);
+}
+
+static bool     fifo_pop(pio_model_t *m, uint32_t *w)
+{
+        if (m->fifo_count == 0)
+                return false;
+        *w = m->fifo[m->fifo_head];
+        m->fifo_head = (m->fifo_head + 1) % FIFO_DEPTH;
+        m->fifo_count--;
+        return true;
+}
+
+/* One PIO cycle.  Returns false if the program stalled on an empty FIFO. */
+static bool     pio_cycle(pio_model_t *m)
+{
+        unsigned int lc = m->lc;
+        uint32_t w;
+
+        if (lc == 0) {
+                /* out X, 1: autopulls the timing word */
+                if (!fifo_pop(m, &w))
+                        goto stall;
+                if (!m->started) {
+                        /* The SM is enabled before the DMA is started, so
+                         * waits for the first line; that's fine.
+                         */
+                        m->started = true;
+                        m->stalls0 = 0;
+                        m->line_cycle = m->cycle;
+                }
+                unsigned int hsw = (w >> 23) & 0xff;
+                unsigned int hbp = (w >> 15) & 0xff;
+                m->hfp = (w >> 7) & 0xff;
+                m->line.vs = !!(w & 0x80000000);
+                m->line.de = m->lcd && (w & 0x40);
+                m->line.stalls = m->stalls0;
+                m->stalls0 = 0;
+                /* The pull for the pixel count follows the HSW and HBP
+                 * loops; pio_lcd has an extra cycle to read DE, and another
+                 * to branch on it:
+                 */
+                m->pull_lc = 2*hsw + 2*hbp + (m->lcd ? 12 : 11);
+                m->pix0_lc = m->pull_lc + (m->lcd ? 4 : 3);
+                m->len_lc = 0;
+        } else if (lc == 2) {
+                m->hs_cycle = m->cycle;
+        } else if (lc == m->pull_lc) {
+                if (!fifo_pop(m, &w))
+                        goto stall;
+                m->line.npix = w + 1;
+                if (m->line.npix > VIDSIM_MAX_PIXELS)
+                        panic("vidsim: line of %u pixels\n", m->line.npix);
+                m->osr_bits = 0;
+                m->len_lc = m->pix0_lc + 2*m->scale*m->line.npix + 2*m->hfp + 6;
+        } else if (lc >= m->pix0_lc && m->len_lc &&
+                   lc < m->pix0_lc + 2*m->scale*m->line.npix &&
+                   !((lc - m->pix0_lc) % (2*m->scale))) {
+                unsigned int k = (lc - m->pix0_lc) / (2*m->scale);
+
+                /* out pins, BPP: autopulls a new word as needed */
+                if (m->osr_bits == 0) {
+                        if (!fifo_pop(m, &w))
+                                goto stall;
+                        m->osr = w;
+                        m->osr_bits = 32;
+                }
+                m->line.pix[k] = m->osr >> (32 - m->bpp);
+                m->osr <<= m->bpp;
+                m->osr_bits -= m->bpp;
+                if (k == 0)
+                        m->line.x0 = (m->cycle - m->hs_cycle) / 2;
+        }
+
+        m->cycle++;
+        m->lc++;
+        if (m->len_lc && m->lc == m->len_lc) {
+                m->line.pclks = (m->cycle - m->line_cycle) / 2;
+                m->line_cycle = m->cycle;
+                if (!m->dry)
+                        vidsim_out_line(&m->line);
+                m->lc = 0;
+        }
+        return true;
+
+stall:
+        m->cycle++;
+        if (lc == 0)
+                m->stalls0++;
+        else
+                m->line.stalls++;
+        return false;
+}
+
+/* Returns the number of clk_sys cycles until PIO would stall, if no more
+ * data arrived.
+ */
+static uint64_t dry_run(void)
+{
+        static pio_model_t m;
+        uint64_t cycles = 0;
+
+        m = pio;
+        m.dry = true;
+        while (pio_cycle(&m) && cycles < 10000000)
+                cycles++;
+        return (pio.clkdiv_256 - pio.acc + cycles * pio.clkdiv_256) / 256;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DMA
+
+typedef struct {
+        bool            busy;
+        uintptr_t       remaining;
+} dma_state_t;
+
+static dma_state_t dma_state[NUM_DMA_CHANNELS];
+static unsigned int dma_rr;
+
+/* IRQ state */
+static void (*irq_handler)(void);
+static bool irq_active;
+static uint64_t irq_raised;
+static uint64_t irq_deadline;           /* 0 if not yet known */
+static bool irq_waiting_deadline;
+static int64_t irq_done_at = -1;        /* When the handler ran, or -1 */
+
+static void     irq_deadline_now(void)
+{
+        if (!irq_waiting_deadline)
+                return;
+        irq_waiting_deadline = false;
+        irq_deadline = vidsim_now;
+        if (irq_done_at < 0)
+                vidsim_fatal = "video IRQ missed its deadline (DMA would use stale descriptors)";
+        else
+                vidsim_irq_done(irq_raised, (int64_t)irq_deadline - irq_done_at);
+}
+
+static void     dma_raise_irq(uint ch)
+{
+        dma_hw->ints0 |= 1u << ch;
+}
+
+void    vidsim_irq_set_handler(void (*handler)(void))
+{
+        irq_handler = handler;
+}
+
+void    vidsim_dma_trigger(uint ch)
+{
+        dma_channel_hw_t *r = &dma_hw->ch[ch];
+
+        if (!(r->ctrl_trig & DMA_CH0_CTRL_TRIG_EN_BITS))
+                return;
+        if (dma_state[ch].busy)
+                panic("vidsim: DMA ch%u triggered while busy\n", ch);
+        dma_state[ch].busy = true;
+        dma_state[ch].remaining = r->transfer_count;
+        if (r->write_addr == (uintptr_t)&pio0_hw->txf[0])
+                vidsim_out_dma(r->transfer_count, r->read_addr);
+        if ((int)ch == vidsim_deadline_ch)
+                irq_deadline_now();
+}
+
+static bool     is_dma_reg(uintptr_t addr)
+{
+        return addr >= (uintptr_t)&dma_hw->ch[0] && addr < (uintptr_t)&dma_hw->ch[NUM_DMA_CHANNELS];
+}
+
+static void     dma_reg_write(uintptr_t addr, uintptr_t val)
+{
+        /* The aliases of each register, in order, in the 4 alias groups: */
+        static const unsigned int canon[16] = { 0, 1, 2, 3,  3, 0, 1, 2,
+                                                3, 2, 0, 1,  3, 1, 2, 0 };
+        uintptr_t off = addr - (uintptr_t)&dma_hw->ch[0];
+        uint ch = off / sizeof(dma_channel_hw_t);
+        unsigned int i = (off % sizeof(dma_channel_hw_t)) / sizeof(io_rw_32);
+        io_rw_32 *regs = &dma_hw->ch[ch].read_addr;
+
+        regs[canon[i]] = val;
+        if ((i & 3) == 3) {
+                if (val == 0) {
+                        /* Null trigger */
+                        if (dma_hw->ch[ch].ctrl_trig & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS)
+                                dma_raise_irq(ch);
+                } else {
+                        vidsim_dma_trigger(ch);
+                }
+        }
+}
+
+static uintptr_t        dma_advance(uintptr_t addr, unsigned int size, uint32_t ctrl, bool write,
+                                    bool reg_width)
+{
+        unsigned int ring = (ctrl & DMA_CH0_CTRL_TRIG_RING_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_RING_SIZE_LSB;
+        bool ring_write = !!(ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS);
+
+        if (!ring || ring_write != write)
+                return addr + size;
+        /* Rings are sized for 32-bit registers: */
+        uintptr_t bytes = (1u << ring) * (reg_width ? sizeof(uintptr_t) / 4 : 1);
+        return (addr & ~(bytes - 1)) | ((addr + size) & (bytes - 1));
+}
+
+static bool     dma_ready(uint ch)
+{
+        uint32_t treq = (dma_hw->ch[ch].ctrl_trig & DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) >>
+                DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB;
+
+        if (!dma_state[ch].busy)
+                return false;
+        if (treq == DREQ_PIO0_TX0)
+                return pio.fifo_count < FIFO_DEPTH;
+        return treq == DREQ_FORCE;
+}
+
+static void     dma_transfer(uint ch)
+{
+        dma_channel_hw_t *r = &dma_hw->ch[ch];
+        uint32_t ctrl = r->ctrl_trig;
+        bool reg_width = is_dma_reg(r->write_addr);
+        unsigned int size = reg_width ? sizeof(uintptr_t) :
+                1u << ((ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+        uintptr_t val;
+
+        if (size == sizeof(uintptr_t)) {
+                memcpy(&val, (void *)r->read_addr, size);
+        } else if (size == 4) {
+                uint32_t v32;
+                memcpy(&v32, (void *)r->read_addr, 4);
+                if (ctrl & DMA_CH0_CTRL_TRIG_BSWAP_BITS)
+                        v32 = __builtin_bswap32(v32);
+                val = v32;
+        } else {
+                panic("vidsim: DMA ch%u: unsupported transfer size %u\n", ch, size);
+        }
+
+        if (r->write_addr == (uintptr_t)&pio0_hw->txf[0]) {
+                if (pio.fifo_count >= FIFO_DEPTH)
+                        panic("vidsim: PIO FIFO overflow\n");
+                pio.fifo[(pio.fifo_head + pio.fifo_count++) % FIFO_DEPTH] = val;
+        } else if (reg_width) {
+                dma_reg_write(r->write_addr, val);
+        } else {
+                panic("vidsim: DMA ch%u: write to unexpected address %p\n", ch, (void *)r->write_addr);
+        }
+
+        if (ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS)
+                r->read_addr = dma_advance(r->read_addr, size, ctrl, false, reg_width);
+        if (ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS)
+                r->write_addr = dma_advance(r->write_addr, size, ctrl, true, reg_width);
+
+        if (--dma_state[ch].remaining == 0) {
+                uint chain = (ctrl & DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB;
+
+                dma_state[ch].busy = false;
+                if (!(ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS))
+                        dma_raise_irq(ch);
+                if (chain != ch)
+                        vidsim_dma_trigger(chain);
+        }
+}
+
+static void     dma_step(void)
+{
+        for (unsigned int i = 0; i < NUM_DMA_CHANNELS; i++) {
+                uint ch = (dma_rr + i) % NUM_DMA_CHANNELS;
+
+                if (dma_ready(ch)) {
+                        dma_transfer(ch);
+                        dma_rr = ch + 1;
+                        return;
+                }
+        }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void     irq_step(void)
+{
+        if (!irq_active && (dma_hw->ints0 & dma_hw->inte0)) {
+                irq_active = true;
+                irq_raised = vidsim_now;
+                irq_done_at = -1;
+                if (vidsim_deadline_ch < 0) {
+                        /* The deadline is PIO running dry: */
+                        irq_deadline = vidsim_now + dry_run();
+                } else {
+                        irq_deadline = 0;
+                        irq_waiting_deadline = true;
+                }
+        }
+        if (irq_active && vidsim_now >= irq_raised + vidsim_irq_latency) {
+                irq_active = false;
+                irq_done_at = vidsim_now;
+                if (irq_handler)
+                        irq_handler();
+                if (irq_deadline)
+                        vidsim_irq_done(irq_raised, (int64_t)irq_deadline - irq_done_at);
+        }
+}
+
+void    vidsim_step(void)
+{
+        vidsim_now++;
+        vidsim_systick.cvr = 0xffffff - (vidsim_now & 0xffffff);
+
+        dma_step();
+        if (pio.clkdiv_256) {
+                pio.acc += 256;
+                while (pio.acc >= pio.clkdiv_256) {
+                        pio.acc -= pio.clkdiv_256;
+                        pio_cycle(&pio);
+                }
+        }
+        irq_step();
+}
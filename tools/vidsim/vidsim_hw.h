@@ -0,0 +1,73 @@
+/*
+ * vidsim: DMA, PIO and IRQ models
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VIDSIM_HW_H
+#define VIDSIM_HW_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define VIDSIM_MAX_PIXELS       2048
+
+/* A line as output by the PIO program.  Positions/lengths are in pixel
+ * clocks, and include any cycles PIO stalled waiting for data.
+ */
+typedef struct {
+        bool            vs;
+        bool            de;             /* LCD: DE asserted for the pixels */
+        unsigned int    npix;
+        unsigned int    x0;             /* First pixel, from the start of HS */
+        unsigned int    pclks;          /* Line length */
+        unsigned int    stalls;         /* PIO cycles stalled on an empty FIFO */
+        uint8_t         pix[VIDSIM_MAX_PIXELS];
+} vidsim_line_t;
+
+/* Time, in clk_sys cycles */
+extern uint64_t vidsim_now;
+
+/* IRQ handler latency:  clk_sys cycles from an IRQ being raised to the
+ * handler having done its work.
+ */
+extern unsigned int vidsim_irq_latency;
+
+/* The channel whose next trigger is the deadline for the video IRQ, or -1
+ * if the deadline is the PIO running out of data.
+ */
+extern int vidsim_deadline_ch;
+
+/* Set if the simulation can't continue (e.g. a missed per-line deadline
+ * would send DMA off into the weeds):
+ */
+extern const char *vidsim_fatal;
+
+void    vidsim_step(void);
+
+/* Provided by the simulator's main: */
+void    vidsim_out_line(const vidsim_line_t *l);
+void    vidsim_out_dma(uintptr_t count, uintptr_t read_addr);
+void    vidsim_irq_done(uint64_t raised, int64_t slack);
+
+#endif
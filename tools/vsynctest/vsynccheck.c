@@ -0,0 +1,160 @@
+/*
+ * vsynccheck:  checks of vsync.c, driven by a fake frame counter
+ *
+ * Frames arriving in step with the polls must each give one vsync.  A
+ * run of missed frames must be delivered late, one per poll, up to the
+ * backlog (plus the one due now); any beyond that must be dropped and
+ * counted in missed.  A random mix of frames and polls is checked
+ * against a simple model, starting near the counter's wrap.
+ *
+ * Copyright 2024 Matt Evans
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vsync.h"
+
+static unsigned int failures = 0;
+
+#define CHECK(cond, ...)        do {                    \
+                if (!(cond)) {                          \
+                        printf("FAIL: " __VA_ARGS__);   \
+                        printf("\n");                   \
+                        failures++;                     \
+                }                                       \
+        } while (0)
+
+/* Polls until no event is given, returning the number given */
+static unsigned int     drain(vsync_t *v, uint32_t frame)
+{
+        unsigned int n = 0;
+
+        while (vsync_poll(v, frame) && n < 1000)
+                n++;
+        return n;
+}
+
+static void     check_in_step(unsigned int backlog)
+{
+        vsync_t v;
+        uint32_t frame = 100;
+
+        vsync_init(&v, frame, backlog);
+        CHECK(!vsync_poll(&v, frame), "backlog %u: vsync before a frame", backlog);
+        for (unsigned int i = 0; i < 1000; i++) {
+                frame++;
+                CHECK(vsync_poll(&v, frame), "backlog %u: frame %u not delivered", backlog, i);
+                CHECK(!vsync_poll(&v, frame), "backlog %u: frame %u delivered twice", backlog, i);
+        }
+        CHECK(v.delivered == 1000 && v.missed == 0,
+              "backlog %u: in step, delivered %u missed %u", backlog, v.delivered, v.missed);
+}
+
+/* A gap of n frames, between polls */
+static void     check_gap(unsigned int backlog, unsigned int n)
+{
+        vsync_t v;
+        uint32_t frame = 0;
+        unsigned int late = n < backlog + 1 ? n : backlog + 1;
+
+        vsync_init(&v, frame, backlog);
+        frame += n;
+        unsigned int got = drain(&v, frame);
+        CHECK(got == late, "backlog %u: gap of %u gave %u vsyncs, not %u", backlog, n, got, late);
+        CHECK(v.missed == n - late, "backlog %u: gap of %u counted %u missed, not %u",
+              backlog, n, v.missed, n - late);
+        CHECK(v.delivered == late, "backlog %u: gap of %u counted %u delivered",
+              backlog, n, v.delivered);
+
+        /* Then it's back in step */
+        frame++;
+        CHECK(drain(&v, frame) == 1, "backlog %u: not in step after a gap of %u", backlog, n);
+}
+
+/* Frames arriving while a backlog is being delivered */
+static void     check_catch_up(unsigned int backlog)
+{
+        vsync_t v;
+        uint32_t frame = 0;
+
+        vsync_init(&v, frame, backlog);
+        frame += backlog + 1;
+        for (unsigned int i = 0; i < 100; i++) {
+                /* One delivered, one more arrives:  still backlog+1 to go */
+                CHECK(vsync_poll(&v, frame), "backlog %u: catching up, poll %u gave none",
+                      backlog, i);
+                frame++;
+        }
+        CHECK(v.missed == 0, "backlog %u: catching up counted %u missed", backlog, v.missed);
+        CHECK(drain(&v, frame) == backlog + 1, "backlog %u: catching up, wrong backlog", backlog);
+}
+
+/* Random frames and polls, against a model, across the counter's wrap */
+static void     check_random(unsigned int backlog)
+{
+        vsync_t v;
+        uint32_t frame = 0xffffff00;
+        unsigned int queued = 0, missed = 0, delivered = 0;
+
+        vsync_init(&v, frame, backlog);
+        for (unsigned int i = 0; i < 200000; i++) {
+                unsigned int n = rand() % 4 == 0 ? rand() % (backlog + 4) : rand() % 2;
+
+                frame += n;
+                queued += n;
+                if (queued > backlog + 1) {
+                        missed += queued - (backlog + 1);
+                        queued = backlog + 1;
+                }
+                bool expect = queued > 0;
+                if (expect) {
+                        queued--;
+                        delivered++;
+                }
+                if (vsync_poll(&v, frame) != expect) {
+                        CHECK(0, "backlog %u: random poll %u wrong", backlog, i);
+                        return;
+                }
+        }
+        CHECK(v.delivered == delivered && v.missed == missed,
+              "backlog %u: random, delivered %u missed %u, not %u/%u", backlog,
+              v.delivered, v.missed, delivered, missed);
+}
+
+int     main(int argc, char *argv[])
+{
+        for (unsigned int backlog = 0; backlog <= 8; backlog++) {
+                check_in_step(backlog);
+                for (unsigned int n = 1; n <= backlog + 10; n++)
+                        check_gap(backlog, n);
+                check_catch_up(backlog);
+                check_random(backlog);
+        }
+        if (failures) {
+                printf("vsynccheck:  %u failures\n", failures);
+                return 1;
+        }
+        printf("vsynccheck:  OK\n");
+        return 0;
+}